@@ -525,6 +525,7 @@ public:
 		}
 
 
+	public:
 		// return the string version of the rule
 		std::string makeShortRule(  ) {
 			// first make a big number
@@ -610,6 +611,7 @@ public:
 		}
 
 
+	private:
 		// turn an int into base 62 version
 		char base62( int in )
 		{
@@ -0,0 +1,37 @@
+#ifndef ARGUMENTS_H
+#define ARGUMENTS_H
+
+// command line numbers for the engine and the tools - stoi and friends throw on garbage and stop quietly
+// at trailing junk, neither of which should start a render or a bake. A bad value names the option,
+// prints the program's usage and exits with status 1
+
+#include <cmath>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <type_traits>
+
+#include "colors.h"
+
+// the whole of text as a number in [ low, high ]
+template < typename T, typename U >
+T numericArgument( const std::string &argument, const std::string &text, T low, T high, U &&usage ) {
+  size_t used = 0;
+  double value = 0.0;
+  try {
+    value = std::stod( text, &used );
+  } catch ( const std::exception & ) {
+    used = 0;
+  }
+  if ( used == 0 || used != text.size() || !( value >= double( low ) && value <= double( high ) )
+    || ( std::is_integral< T >::value && value != std::floor( value ) ) ) {
+    std::cout << T_RED << argument << " expects " << ( std::is_integral< T >::value ? "an integer" : "a number" )
+              << " from " << low << " to " << high << ", got \"" << text << "\"" << RESET << std::endl;
+    usage();
+    exit( 1 );
+  }
+  return T( value );
+}
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef BLUE_NOISE_H
+#define BLUE_NOISE_H
+
+// blue noise bank - a stack of RGBA8 noise slices in a flat file, baked offline by tools/blueNoiseBake.cc
+// and memory mapped at startup, so the texture upload reads straight from the page cache
+//
+// layout: 64 byte header, then slices * height * width * 4 bytes - slice major, rows top to bottom
+// each channel is an independent spatial blue noise mask, advanced through the slices by the golden
+// ratio, so any one pixel's values across slices are well distributed too
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+#include "mapped_file.h"
+
+constexpr char blueNoiseMagic[ 8 ] = { 'B', 'N', 'O', 'I', 'S', 'E', 'B', 'K' };
+constexpr uint32_t blueNoiseVersion = 1;
+
+struct blueNoiseHeader {
+  char magic[ 8 ];
+  uint32_t version;
+  uint32_t width;
+  uint32_t height;
+  uint32_t slices;
+  uint32_t channels;   // always 4 for now
+  uint32_t dataOffset; // from the start of the file
+  uint8_t reserved[ 32 ];
+};
+static_assert( sizeof( blueNoiseHeader ) == 64, "blue noise header is part of the file format" );
+
+inline bool writeBlueNoiseBank( const std::string &filename, uint32_t width, uint32_t height, uint32_t slices, const uint8_t *data ) {
+  blueNoiseHeader header = {};
+  std::memcpy( header.magic, blueNoiseMagic, sizeof( blueNoiseMagic ) );
+  header.version = blueNoiseVersion;
+  header.width = width;
+  header.height = height;
+  header.slices = slices;
+  header.channels = 4;
+  header.dataOffset = sizeof( blueNoiseHeader );
+
+  std::ofstream file( filename, std::ios::binary );
+  file.write( ( const char * ) &header, sizeof( header ) );
+  file.write( ( const char * ) data, size_t( width ) * height * slices * 4 );
+  return file.good();
+}
+
+// read only mapping of a bank - data stays valid for the lifetime of the object
+class blueNoiseBank {
+public:
+  blueNoiseHeader header = {};
+  const uint8_t *data = nullptr;
+  std::string error;
+
+  bool open( const std::string &filename ) {
+    data = nullptr;
+    if ( !file.open( filename ) ) { error = file.error; return false; }
+    if ( file.size < sizeof( blueNoiseHeader ) ) { error = filename + " is too short"; return false; }
+
+    std::memcpy( &header, file.data, sizeof( header ) );
+    size_t bytes = size_t( header.width ) * header.height * header.slices * header.channels;
+    if ( std::memcmp( header.magic, blueNoiseMagic, sizeof( blueNoiseMagic ) ) != 0 )
+      error = filename + " is not a blue noise bank";
+    else if ( header.version != blueNoiseVersion )
+      error = filename + " is version " + std::to_string( header.version ) + ", expected " + std::to_string( blueNoiseVersion );
+    else if ( header.channels != 4 || !header.width || !header.height || !header.slices )
+      error = filename + " has unsupported dimensions";
+    else if ( header.dataOffset < sizeof( blueNoiseHeader ) || header.dataOffset + bytes > file.size )
+      error = filename + " is truncated";
+    if ( !error.empty() ) { file.close(); return false; }
+
+    data = file.data + header.dataOffset;
+    return true;
+  }
+
+private:
+  mappedFile file;
+};
+
+#endif
@@ -0,0 +1,199 @@
+#ifndef DISTRIBUTED_H
+#define DISTRIBUTED_H
+
+// coordinator / worker protocol for distributed tile rendering, over TCP
+//  - a worker connects and says hello, the coordinator replies with the scene as JSON - the render
+//    settings and the SDF nodes and materials, see engine::sceneState()
+//  - a work unit is a tile and a range of sample indices - the worker renders it into a cleared tile
+//    and sends back the means: radiance + sample count, normal + depth, and luminance moments
+//  - the coordinator merges results into its own buffers, weighted by sample count
+//  - a camera or scene change bumps the epoch and resends the scene, results from older epochs are dropped
+// messages are a fixed header plus payload in host byte order, workers are expected to run on the
+// same architecture as the coordinator
+
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+constexpr uint32_t protocolVersion = 2;
+
+enum messageType : uint32_t {
+  MSG_HELLO  = 1, // worker -> coordinator, helloMessage
+  MSG_SCENE  = 2, // coordinator -> worker, uint32 epoch then JSON text
+  MSG_WORK   = 3, // coordinator -> worker, workUnit
+  MSG_RESULT = 4, // worker -> coordinator, workUnit then tile data
+  MSG_DONE   = 5  // coordinator -> worker, no more work
+};
+
+struct messageHeader {
+  uint32_t type;
+  uint32_t length; // payload bytes, not counting the header
+};
+
+struct helloMessage {
+  uint32_t version;
+  int32_t width;
+  int32_t height;
+  int32_t tileSize;
+};
+
+struct workUnit {
+  uint32_t epoch;
+  uint32_t id;
+  int32_t x, y;         // tile offset, as from getTile()
+  uint32_t firstSample; // sample indices [ firstSample, firstSample + sampleCount ) seed the RNG
+  uint32_t sampleCount;
+};
+
+// tile data following a MSG_RESULT's workUnit - full tiles, zero past the image edge
+//  RGBA32F radiance + sample count, RGBA32F normal + depth, RG32F moments, one after the other
+constexpr size_t tileResultFloats( int tileSize ) { return size_t( tileSize ) * tileSize * 10; }
+
+// nothing legitimate comes close - a result tile is a few MB, a scene a few MB of JSON per 10k nodes
+constexpr uint32_t maxMessageBytes = 256u << 20;
+
+// one end of a connection - blocking sends, non blocking receives buffered until a message is complete
+class netConnection {
+public:
+  int fd = -1;
+
+  bool open() const { return fd >= 0; }
+
+  void close() {
+    if ( fd >= 0 ) ::close( fd );
+    fd = -1;
+    incoming.clear();
+  }
+
+  // header plus up to two pieces of payload, so results don't need to be copied together first
+  bool send( uint32_t type, const void *a, size_t aBytes, const void *b = nullptr, size_t bBytes = 0 ) {
+    messageHeader header = { type, uint32_t( aBytes + bBytes ) };
+    return sendAll( &header, sizeof( header ) ) && sendAll( a, aBytes ) && sendAll( b, bBytes );
+  }
+
+  // pull whatever has arrived - false if the other end has gone away
+  bool receive() {
+    uint8_t buffer[ 65536 ];
+    while ( true ) {
+      ssize_t count = recv( fd, buffer, sizeof( buffer ), MSG_DONTWAIT );
+      if ( count > 0 ) {
+        incoming.insert( incoming.end(), buffer, buffer + count );
+      } else if ( count == 0 ) {
+        return false;
+      } else {
+        if ( errno == EINTR ) continue;
+        return errno == EAGAIN || errno == EWOULDBLOCK;
+      }
+    }
+  }
+
+  // wait up to timeout ms for something to read
+  bool wait( int timeout ) {
+    pollfd p = { fd, POLLIN, 0 };
+    return poll( &p, 1, timeout ) > 0;
+  }
+
+  // pop the next complete message, if there is one - a length past maxMessageBytes can only be a
+  // broken or hostile peer, so the connection is dropped rather than buffering toward it
+  bool next( messageHeader &header, std::vector< uint8_t > &payload ) {
+    if ( incoming.size() < sizeof( messageHeader ) ) return false;
+    memcpy( &header, incoming.data(), sizeof( messageHeader ) );
+    if ( header.length > maxMessageBytes ) {
+      close();
+      return false;
+    }
+    size_t total = sizeof( messageHeader ) + header.length;
+    if ( incoming.size() < total ) return false;
+    payload.assign( incoming.begin() + sizeof( messageHeader ), incoming.begin() + total );
+    incoming.erase( incoming.begin(), incoming.begin() + total );
+    return true;
+  }
+
+private:
+  std::vector< uint8_t > incoming;
+
+  bool sendAll( const void *data, size_t bytes ) {
+    const uint8_t *p = ( const uint8_t * ) data;
+    while ( bytes ) {
+      ssize_t count = ::send( fd, p, bytes, MSG_NOSIGNAL );
+      if ( count < 0 ) {
+        if ( errno == EINTR ) continue;
+        if ( errno == EAGAIN || errno == EWOULDBLOCK ) { // non blocking socket with a full buffer
+          pollfd w = { fd, POLLOUT, 0 };
+          poll( &w, 1, 1000 );
+          continue;
+        }
+        return false;
+      }
+      p += count;
+      bytes -= count;
+    }
+    return true;
+  }
+};
+
+inline void netNoDelay( int fd ) {
+  int one = 1;
+  setsockopt( fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof( one ) );
+}
+
+// non blocking listening socket on all interfaces, -1 on failure
+inline int netListen( int port ) {
+  int fd = socket( AF_INET, SOCK_STREAM, 0 );
+  if ( fd < 0 ) return -1;
+  int one = 1;
+  setsockopt( fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof( one ) );
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl( INADDR_ANY );
+  address.sin_port = htons( port );
+  if ( bind( fd, ( sockaddr * ) &address, sizeof( address ) ) < 0 || listen( fd, 64 ) < 0 ) {
+    ::close( fd );
+    return -1;
+  }
+  fcntl( fd, F_SETFL, O_NONBLOCK );
+  return fd;
+}
+
+// pending connection, or -1 if there isn't one
+inline int netAccept( int listenFD ) {
+  int fd = accept( listenFD, nullptr, nullptr );
+  if ( fd >= 0 ) netNoDelay( fd );
+  return fd;
+}
+
+// "host:port" - blocking connect, -1 on failure
+inline int netConnect( const std::string &address ) {
+  size_t colon = address.rfind( ':' );
+  if ( colon == std::string::npos ) return -1;
+  std::string host = address.substr( 0, colon ), port = address.substr( colon + 1 );
+
+  addrinfo hints = {}, *result = nullptr;
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  if ( getaddrinfo( host.c_str(), port.c_str(), &hints, &result ) != 0 ) return -1;
+
+  int fd = -1;
+  for ( addrinfo *a = result; a; a = a->ai_next ) {
+    fd = socket( a->ai_family, a->ai_socktype, a->ai_protocol );
+    if ( fd < 0 ) continue;
+    if ( connect( fd, a->ai_addr, a->ai_addrlen ) == 0 ) break;
+    ::close( fd );
+    fd = -1;
+  }
+  freeaddrinfo( result );
+  if ( fd >= 0 ) netNoDelay( fd );
+  return fd;
+}
+
+#endif
@@ -3,12 +3,24 @@
 
 // initialization of OpenGL, etc
 void engine::init() {
+  auto start = std::chrono::steady_clock::now();
   startMessage();
   createWindowAndContext();
   glDebugEnable();
   displaySetup();
+  lutSetup();
   computeShaderCompile();
+  cacheSetup();
+  checkpointParams.directory = launch.checkpointDirectory;
+  collectStats = launch.stats;
+  if ( !launch.benchConfig.empty() )
+    checkpointParams.enable = false; // benchmark runs leave nothing behind but their results
+  if ( !launch.sceneFile.empty() && sceneFileLoad( launch.sceneFile ) )
+    sceneShaderCompile(); // nothing being edited yet, straight to the generated de()
+  if ( launch.resume ) checkpointLoad();
+  distributedSetup();
   imguiSetup();
+  startupMs = std::chrono::duration< float, std::milli >( std::chrono::steady_clock::now() - start ).count();
 }
 
 // terminate ImGUI
@@ -27,6 +39,19 @@ void engine::SDLQuit() {
 
 // called from destructor
 void engine::quit() {
+  // last checkpoint, and let the writer finish before the mapped buffers go away with the context
+  if ( checkpointParams.enable && mode == renderMode::pathtrace ) {
+    checkpoint();
+    glFinish();
+    checkpointUpdate();
+  }
+  if ( exportFence ) { // an export asked for on the way out still gets written
+    glFinish();
+    accumulatorExportUpdate();
+  }
+  writer.finish();
+  distributedQuit();
+
   imguiQuit();
   SDLQuit();
 }
@@ -4,14 +4,17 @@
 #include "includes.h"
 
 enum class renderMode { none, preview, pathtrace };
+enum class distributedMode { none, coordinator, worker };
+enum class sceneEvaluatorMode { automatic, generated, interpreted };
 
 class engine {
 public:
-	engine()  { init(); }
+	engine( launchParameters launch = launchParameters() ) : launch( launch ) { init(); }
 	~engine() { quit(); }
 
   // called from main()
   bool mainLoop();
+  int benchmark(); // headless run over the --bench scene list, nonzero on error or regression
 
 private:
   // application handles + basic data
@@ -19,17 +22,177 @@ private:
 	SDL_GLContext GLcontext;
 	ImVec4 clearColor;
 
+  // command line options
+  launchParameters launch;
+
   // program control flags
   bool quitConfirm = false;
   bool pQuit       = false;
   bool filter      = false;
   renderMode mode  = renderMode::pathtrace;
 
+  // renderer config
+  coreParameters core;
+  coreParameters previousCore; // camera state and settings the accumulator was rendered with
+  lensParameters previousLens;
+  lensParameters lens;
+  postParameters post;
+
+  // tile scheduler state - shuffled tile origins, and tiles touched since the last postprocess
+  std::vector< glm::ivec2 > tileOffsets;
+  int tileListOffset = 0;
+  std::mt19937 tileRNG{ std::random_device()() };
+  std::vector< bool > tileDirty;
+  std::vector< glm::ivec2 > dirtyTiles;
+  bool fullFrameDirty = true; // postprocess settings changed, or the whole accumulator did
+
+  // async screenshot readback - persistently mapped pack buffer, fenced, encoded on writer's thread
+  GLuint screenshotBuffer;
+  void *screenshotMapping = nullptr;
+  GLsync screenshotFence = 0;
+  std::string screenshotFilename;
+  imageWriter writer;
+  exportParameters exportParams;
+
+  // async accumulator export readback - same scheme, the job waits here for its radiance
+  GLuint exportBuffer;
+  const float *exportMapping = nullptr;
+  GLsync exportFence = 0;
+  imageWriteJob exportJob;
+
+  // progressive render checkpoints - two persistently mapped readback slots, so one can be written
+  // out by the writer thread while the next fills
+  struct checkpointSlot {
+    GLuint buffer = 0;
+    uint8_t *mapping = nullptr;
+    GLsync fence = 0;
+    std::atomic< bool > writing{ false };
+    uint32_t sequence = 0;
+    json state; // everything but the pixels, captured alongside the readback
+  };
+  checkpointSlot checkpointSlots[ 2 ];
+  uint32_t checkpointSequence = 0;
+  std::chrono::steady_clock::time_point lastCheckpoint = std::chrono::steady_clock::now();
+  checkpointParameters checkpointParams;
+
+  // RNG frame index - advanced per pathtrace dispatch, seeds the shader's hash
+  uint32_t frameIndex = 0;
+
+  // per pass timing and per frame counters, shown in the controls window
+  profiler profile;
+  float startupMs = 0.0f; // init(), window creation through shader compilation
+  GLuint pathtraceQueries[ 2 ]; // start / check timestamps for the pathtrace time budget
+
+  // path tracer counters - the shader adds into statsBuffer, which is copied into one half of a
+  // persistently mapped readback buffer each frame and read on the next, once its fence has passed
+  static constexpr int statsCount = 5;
+  bool collectStats = false;
+  GLuint statsBuffer;
+  GLuint statsReadback;
+  const uint32_t *statsMapping = nullptr;
+  GLsync statsFences[ 2 ] = { 0, 0 };
+  int statsSlot = 0;
+  std::chrono::steady_clock::time_point lastStatsReport = std::chrono::steady_clock::now();
+
+  // distributed rendering, see distributed.h - coordinator side
+  struct remoteWorker {
+    netConnection link;
+    bool ready = false;                 // said hello and has the scene
+    std::vector< workUnit > inFlight;   // sent, no result yet
+  };
+  distributedMode distributedRole = distributedMode::none;
+  int listenSocket = -1;
+  std::vector< std::unique_ptr< remoteWorker > > remoteWorkers;
+  std::deque< workUnit > workQueue;
+  uint32_t distributedEpoch = 0;
+  uint32_t nextUnitID = 0;
+  size_t unitsTotal = 0;
+  size_t unitsMerged = 0;
+  bool coordinatorHeld = false;       // scene edits still settling, the broadcast waits for them
+  std::vector< pid_t > localWorkerProcesses;
+    // worker side
+  netConnection coordinatorLink;
+  uint32_t workerEpoch = 0;
+  size_t unitsRendered = 0;
+
+  // scene file - settings are applied on load, the SDF nodes, materials and assets are kept here
+  sceneDescription scene;
+  float sceneLoadMs = 0.0f;
+  sdfCompiler sceneCompiler; // de() generated from the nodes, see sdf_compiler.h
+
+  // de() is either the generated GLSL, fastest to run, or the bytecode interpreter reading the program
+  // from sdfProgramBuffer, which takes edits without a rebuild - automatic interprets while the scene
+  // is being edited, and promotes to the generated GLSL once the edits have settled
+  int sceneEvaluator = int( sceneEvaluatorMode::automatic );
+  bool sceneInterpreted = false;     // which of the two pathtraceShader is
+  bool sceneGeneratedCurrent = true; // pathtraceGeneratedShader is built from the current nodes
+  bool scenePromotionPending = false;
+  float scenePromotionDelay = 1.5f;  // seconds without an edit
+  std::chrono::steady_clock::time_point sceneEditTime;
+  float sceneShaderMs = 0.0f;        // last generated GLSL build, driver compile included
+  GLuint pathtraceGeneratedShader = 0;
+  GLuint pathtraceInterpretedShader = 0;
+  GLuint sdfProgramBuffer;
+  GLuint sdfBVHBuffer;
+  GLuint sdfObjectBuffer;
+
+  // distance cache, see engine_cache.cc - de() baked into a sparse brick map for marching, a slice of
+  // the bake per frame, with de() standing in wherever it hasn't got to yet
+  static constexpr int cacheMaxBricks = 128; // on a side of the region
+  static constexpr size_t cacheAtlasBudget = size_t( 1 ) << 30; // bytes of R32F atlas at most
+  int cacheAtlasLimit = 1;                      // atlas bricks on a side the device and the budget allow
+  cacheParameters cacheParams;
+  glm::vec3 cacheMin = glm::vec3( 0.0f );       // layout of the current bake
+  float cacheCell = 1.0f;
+  glm::ivec3 cacheBrickCount = glm::ivec3( 0 );
+  int cacheAtlasBricks = 0;
+  int cacheClassified = 0;                      // bake progress, in bricks
+  int cacheAllocated = 0;
+  int cacheFilled = 0;
+  bool cacheFull = false;                       // band bricks past the atlas capacity, left to de()
+  bool cacheBaking = false;
+  bool cacheShaderCurrent = false;              // cacheBakeGeneratedShader is built from the current nodes
+  std::chrono::steady_clock::time_point cacheBakeStartTime;
+  float cacheBakeMs = 0.0f;
+  GLuint cacheBrickBuffer;                      // slot and center distance per brick
+  GLuint cacheWorkBuffer;                       // allocation count, then the bricks waiting on a fill
+  GLuint cacheCountReadback;                    // allocation count copied out after classifying, persistently mapped
+  const uint32_t *cacheCountMapping = nullptr;
+  GLsync cacheCountFence = 0;                   // pending copy into cacheCountReadback, polled per frame
+  GLuint cacheAtlasTexture = 0;
+  GLuint cacheBakeGeneratedShader = 0;
+  GLuint cacheBakeInterpretedShader = 0;
+
+  // VAT terrain, see engine_vat.cc - cells on the CPU for regenerating the field, textures for tracing
+  vatParameters vatParams;
+  std::vector< uint8_t > vatCells; // vatSize^3, x fastest
+  int vatSize = 0;
+  size_t vatSolidCells = 0;
+  float vatGenerateMs = 0.0f;
+  float vatFieldMs = 0.0f;
+  GLuint vatCellTexture = 0;
+  GLuint vatFieldTexture = 0;
+  GLuint vatTreeBuffer = 0;        // 64-tree nodes, see vat_tree.h
+  uint32_t vatTreeRoot = 0;
+  int vatTreeDepth = 0;
+  size_t vatTreeBytes = 0;
+  float vatTreeMs = 0.0f;
+  GLuint vatJFAShader;
+
+  // palette for Oklab dithering, sRGB
+  std::vector< glm::vec3 > palette;
+
+  // denoiser + reprojection config
+  denoiseParameters denoiseParams;
+  reprojectParameters reprojectParams;
+
   // initialization
   void init();
   void startMessage();
 	void createWindowAndContext();
   void displaySetup();
+  void lutSetup();
+  void paletteUpdate();
   void computeShaderCompile();
   void imguiSetup();
 
@@ -41,15 +204,65 @@ private:
   void imguiFrameEnd();
   void controlsWindow();
   void drawTextEditor();
-  void screenShot();
+  void screenShot();       // queue a readback of the presented image
+  void screenShotUpdate(); // hand off a finished readback to the writer thread
+  void accumulatorExport(); // queue a float dump of the accumulator, radiance + sample count
+  void accumulatorExportUpdate(); // hand off a finished dump readback to the writer thread
+  void checkpoint();        // queue a readback of the render state into a free slot
+  json benchScene( const json &scene, const json &defaults ); // one benchmark scene, returns its results
+  void statsUpdate();       // queue this frame's counters for readback, collect last frame's
+  void checkpointUpdate();  // periodic trigger, hand off finished readbacks to the writer thread
+  json sceneState();        // render parameters as JSON
+  void sceneLoad( const json &state );
+  bool sceneFileLoad( const std::string &filename ); // scene.h description, cached or parsed
+  void sceneEdited( bool settling = false ); // nodes changed - recompile, upload the bytecode, restart accumulation
+  void sceneEvaluatorSelect( bool settling = false ); // switch de() to what sceneEvaluator asks for, settling
+                                                      // holds off a generated GLSL rebuild until edits stop
+  void sceneEvaluatorUpdate(); // per frame, promotes to generated GLSL once edits settle
+  void sceneShaderCompile();   // rebuild the path tracer around the scene's generated de()
+  bool sceneNodeEditor( int index ); // inspector for a node and its children, true on an edit
+  void sceneUniforms( GLuint shader ); // what the interpreter and the BVH read, for any de() user
+  void cacheSetup();
+  void cacheBakeStart();       // new layout from cacheParams, bake from scratch
+  void cacheInvalidate();      // scene changed
+  void cacheBakeUpdate();      // per frame, the next slice of the bake
+  void cacheUniforms( GLuint shader );
+  void vatGenerate();          // run the automaton, upload the cells, build the field
+  void vatFieldUpdate();       // distance field from vatCells, jump flood or CPU EDT
+  void vatTreeUpdate();        // 64-tree from vatCells
+  void vatUniforms( GLuint shader );
+  json checkpointState();   // parameters, RNG frame index and tile scheduler state
+  bool checkpointLoad();    // --resume, restore the last complete checkpoint
   void quitConf( bool *open );
 
   // rendering functions
   void render();        // wrapper
+  void updateBasis();   // basis vectors from the rotation parameters
+  void accumulationRestart(); // clear the accumulator, for scene changes the history can't survive
+  bool cameraMoved();   // compare the camera against previousCore
+  bool renderSettingsChanged(); // anything else in previousCore / previousLens that the samples depend on
+  void reproject();     // carry accumulator history into the new view
   void raymarch();      // preview render
   void pathtrace();     // accumulate samples
-  void postprocess();   // tonemap, dither
+  void pathtraceUniforms();
+  void noiseUniforms( uint32_t sampleIndex );
+  void denoise();       // edge-aware à-trous filter
+  void postprocess();   // tonemap, dither into displayTexture
+  void sendPostUniforms( GLuint shader );
+  bool denoiseActive();
+  bool fusedPresent();  // blit does the postprocess work, displayTexture only on demand
   glm::ivec2 getTile(); // tile renderer offset
+  void markTileDirty( glm::ivec2 tile );
+
+  // distributed rendering
+  void distributedSetup();      // from the launch options
+  void distributedQuit();
+  void coordinatorRestart();    // new epoch - resend the scene, requeue every unit
+  void coordinatorHold();       // new epoch, but no scene and no work until coordinatorRestart()
+  void coordinatorUpdate();     // accept workers, merge results, hand out units
+  void coordinatorMerge( const workUnit &unit, const float *data );
+  void workerUpdate();          // render units as they arrive
+  void workerRender( const workUnit &unit );
 
   // shutdown procedure
   void imguiQuit();
@@ -59,10 +272,27 @@ private:
   // OpenGL data handles
     // render
   GLuint accumulatorTexture;
-  GLuint blueNoiseTexture;
+  GLuint normalDepthTexture;
+  GLuint momentsTexture;
+  GLuint denoiseTextures[ 2 ];
+  GLuint accumulatorHistoryTexture;
+  GLuint normalDepthHistoryTexture;
+  GLuint momentsHistoryTexture;
+  GLuint reprojectDepthBuffer;
+  GLuint blueNoiseTexture;    // 2D array, one slice per sample index, see blue_noise.h
+  glm::ivec2 blueNoiseSize;
+  int blueNoiseSlices;
   GLuint raymarchShader;
   GLuint pathtraceShader;
+  GLuint reprojectShader;
+  GLuint denoiseShader;
   GLuint postprocessShader;
+  GLuint mergeShader;
+  GLuint tileResultTextures[ 3 ]; // one tile of accumulator, normalDepth, moments - distributed results
+  GLuint dirtyTileBuffer;
+  GLuint tonemapLUTTexture;
+  GLuint paletteLUTTexture;
+  GLuint paletteTexture;
     // present
   GLuint displayTexture;
   GLuint displayShader;
@@ -0,0 +1,185 @@
+#include "engine.h"
+
+// headless benchmark - each scene of the --bench list renders from a cleared accumulator with a fixed
+// seed, for a set time or sample count. Results go to --bench-out as JSON, and are checked against
+// --baseline when one is given.
+//
+// scene list format:
+//  {
+//    "defaults": { "seconds": 10, "spp": 0, "seed": 1, "stats": false, "state": { ... } },
+//    "scenes": [ { "name": "default", "seconds": 5, "state": { "core": { "maxSteps": 100 } } }, ... ]
+//  }
+// "state" is a partial scene state ( see sceneState() ), patched over the engine defaults. A run stops
+// at whichever of seconds / spp it reaches first, zero meaning no limit.
+
+// compared against the baseline, and which direction is better
+static const struct { const char *name; bool higherIsBetter; } benchMetrics[] = {
+  { "primaryRaysPerSecond", true },
+  { "samplesPerSecond",     true },
+  { "frameMs",              false },
+  { "timeToFirstPixelMs",   false },
+};
+
+// prints one line per metric, returns the number that regressed past the threshold
+static int benchCompare( const std::string &label, const json &current, const json &reference, const char *metric, bool higherIsBetter, float threshold ) {
+  if ( !current.contains( metric ) || !reference.contains( metric ) ) return 0;
+  double now = current.at( metric ).get< double >();
+  double before = reference.at( metric ).get< double >();
+  if ( before <= 0.0 ) return 0;
+
+  double change = now / before - 1.0;
+  bool regressed = higherIsBetter ? change < -threshold : change > threshold;
+  bool improved = higherIsBetter ? change > threshold : change < -threshold;
+  cout << ( regressed ? T_RED : improved ? T_GREEN : T_BLUE ) << "    " << label << " " << metric << RESET
+       << " " << before << " -> " << now << " ( " << std::showpos << std::fixed << std::setprecision( 1 )
+       << change * 100.0 << "% )" << std::noshowpos << std::defaultfloat << std::setprecision( 6 ) << endl;
+  return regressed ? 1 : 0;
+}
+
+int engine::benchmark() {
+  json config;
+  std::ifstream configFile( launch.benchConfig );
+  try {
+    configFile >> config;
+    if ( !config.at( "scenes" ).is_array() ) throw std::runtime_error( "\"scenes\" is not an array" );
+  } catch ( std::exception &e ) {
+    cout << T_RED << "Benchmark - can't use " << launch.benchConfig << ": " << e.what() << RESET << endl;
+    return 1;
+  }
+  json defaults = config.value( "defaults", json::object() );
+
+  json results;
+  results[ "renderer" ] = std::string( ( const char * ) glGetString( GL_RENDERER ) );
+  results[ "version" ] = std::string( ( const char * ) glGetString( GL_VERSION ) );
+  results[ "resolution" ] = { WIDTH, HEIGHT };
+  results[ "startupMs" ] = startupMs;
+  results[ "scenes" ] = json::object();
+
+  // every scene patches over the same starting point, not over whatever the previous scene left
+  json initialState = sceneState();
+  for ( auto &scene : config[ "scenes" ] ) {
+    std::string name = scene.value( "name", "scene" + std::to_string( results[ "scenes" ].size() ) );
+    cout << T_BLUE << "    Benchmark - " << name << RESET << " ..... " << std::flush;
+    try {
+      sceneLoad( initialState );
+      json result = benchScene( scene, defaults );
+      results[ "scenes" ][ name ] = result;
+      cout << T_GREEN << "done." << RESET << " " << result[ "samplesPerSecond" ].get< float >() << " spp/s, "
+           << result[ "primaryRaysPerSecond" ].get< double >() / 1e6 << " Mrays/s, " << result[ "frameMs" ].get< float >() << " ms/frame" << endl;
+    } catch ( json::exception &e ) {
+      cout << T_RED << "failed: " << e.what() << RESET << endl;
+      return 1;
+    }
+  }
+
+  std::ofstream output( launch.benchOutput );
+  output << results.dump( 2 ) << endl;
+  if ( !output.good() ) {
+    cout << T_RED << "Benchmark - can't write " << launch.benchOutput << RESET << endl;
+    return 1;
+  }
+  cout << T_GREEN << "    Benchmark - results in " << launch.benchOutput << RESET << endl;
+
+  // no baseline, nothing to check
+  if ( launch.benchBaseline.empty() ) return 0;
+  json baseline;
+  std::ifstream baselineFile( launch.benchBaseline );
+  if ( !baselineFile.good() ) {
+    cout << T_BLUE << "    Benchmark - no baseline at " << launch.benchBaseline << ", skipping comparison" << RESET << endl;
+    return 0;
+  }
+  try {
+    baselineFile >> baseline;
+    if ( baseline.value( "renderer", "" ) != results[ "renderer" ] )
+      cout << T_RED << "    Benchmark - baseline is from " << baseline.value( "renderer", "unknown" ) << ", numbers may not be comparable" << RESET << endl;
+
+    int regressions = benchCompare( "startup", results, baseline, "startupMs", false, launch.benchThreshold );
+    for ( auto &[ name, result ] : results[ "scenes" ].items() ) {
+      if ( !baseline[ "scenes" ].contains( name ) ) {
+        cout << T_BLUE << "    " << name << RESET << " not in the baseline" << endl;
+        continue;
+      }
+      for ( auto &metric : benchMetrics )
+        regressions += benchCompare( name, result, baseline[ "scenes" ][ name ], metric.name, metric.higherIsBetter, launch.benchThreshold );
+    }
+    if ( regressions ) {
+      cout << T_RED << "    Benchmark - " << regressions << " regressions past " << launch.benchThreshold * 100.0f << "%" << RESET << endl;
+      return 2;
+    }
+  } catch ( json::exception &e ) {
+    cout << T_RED << "Benchmark - bad baseline " << launch.benchBaseline << ": " << e.what() << RESET << endl;
+    return 1;
+  }
+  cout << T_GREEN << "    Benchmark - no regressions" << RESET << endl;
+  return 0;
+}
+
+json engine::benchScene( const json &scene, const json &defaults ) {
+  float seconds = scene.value( "seconds", defaults.value( "seconds", 10.0f ) );
+  float targetSamples = scene.value( "spp", defaults.value( "spp", 0.0f ) );
+  uint32_t seed = scene.value( "seed", defaults.value( "seed", 1u ) );
+  if ( seconds <= 0.0f && targetSamples <= 0.0f ) seconds = 10.0f; // has to stop somewhere
+
+  // throws before anything changes if the patched state doesn't parse
+  json state = sceneState();
+  state.merge_patch( defaults.value( "state", json::object() ) );
+  state.merge_patch( scene.value( "state", json::object() ) );
+  sceneLoad( state );
+  collectStats = scene.value( "stats", defaults.value( "stats", launch.stats ) );
+
+  // same sample sequence and tile order every run, starting from nothing
+  mode = renderMode::pathtrace;
+  frameIndex = seed;
+  tileRNG.seed( seed );
+  tileOffsets.clear();
+  glClearTexImage( accumulatorTexture, 0, GL_RGBA, GL_FLOAT, NULL );
+  glClearTexImage( normalDepthTexture, 0, GL_RGBA, GL_FLOAT, NULL );
+  glClearTexImage( momentsTexture, 0, GL_RGBA, GL_FLOAT, NULL );
+  glFinish();
+
+  // first frame on its own - includes any lazy driver work, kept out of the steady state numbers
+  auto start = std::chrono::steady_clock::now();
+  mainLoop();
+  glFinish();
+  float firstPixelMs = std::chrono::duration< float, std::milli >( std::chrono::steady_clock::now() - start ).count();
+  profile.resetTotals();
+
+  const int tilesPerImage = int( std::ceil( WIDTH / float( TILESIZE ) ) * std::ceil( HEIGHT / float( TILESIZE ) ) );
+  auto samplesPerPixel = [ & ] { return float( frameIndex - seed ) / tilesPerImage; };
+  const float firstFrameSamples = samplesPerPixel();
+  auto steadyStart = std::chrono::steady_clock::now();
+  int frames = 0;
+  while ( true ) {
+    float elapsed = std::chrono::duration< float >( std::chrono::steady_clock::now() - start ).count();
+    if ( seconds > 0.0f && elapsed >= seconds ) break;
+    if ( targetSamples > 0.0f && samplesPerPixel() >= targetSamples ) break;
+    if ( !mainLoop() ) break;
+    frames++;
+  }
+  glFinish();
+  float steadySeconds = std::max( std::chrono::duration< float >( std::chrono::steady_clock::now() - steadyStart ).count(), 1e-6f );
+
+  json result;
+  result[ "seed" ] = seed;
+  result[ "frames" ] = frames + 1;
+  result[ "seconds" ] = std::chrono::duration< float >( std::chrono::steady_clock::now() - start ).count();
+  result[ "samplesPerPixel" ] = samplesPerPixel();
+  result[ "samplesPerSecond" ] = ( samplesPerPixel() - firstFrameSamples ) / steadySeconds;
+  result[ "timeToFirstPixelMs" ] = firstPixelMs;
+  result[ "frameMs" ] = profile.frameTime.mean();
+
+  // per second rates for every counter the frames produced - tiles, rays, and the shader counters if on
+  const profiler::series *rays = profile.counter( "Primary Rays" );
+  result[ "primaryRaysPerSecond" ] = rays ? rays->total / steadySeconds : 0.0;
+  result[ "counters" ] = json::object();
+  for ( auto &c : profile.counters )
+    result[ "counters" ][ c.name ] = c.total / steadySeconds;
+
+  result[ "passes" ] = json::object();
+  for ( auto &t : profile.timers ) {
+    json pass = { { "cpuMs", t.cpu.mean() } };
+    if ( t.useGPU ) pass[ "gpuMs" ] = t.gpu.mean();
+    result[ "passes" ][ t.cpu.name ] = pass;
+  }
+  return result;
+}
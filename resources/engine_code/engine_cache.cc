@@ -0,0 +1,197 @@
+#include "engine.h"
+
+// distance cache - de() baked into a sparse brick map, see shaders/sdf_cache.glsl. The region is cut
+// into bricks of 8^3 cells; bricks near the surface get 9^3 samples in the atlas, the rest keep de() at
+// their center. Marching reads the cache away from surfaces and calls de() close to them, so hits are
+// exactly where they were. The bake is spread over frames, the classify pass over all the bricks then
+// the fill pass over the ones that got a slot, and each brick is used as soon as it's done
+
+void engine::cacheSetup() {
+  glGenBuffers( 1, &cacheBrickBuffer );
+  glBindBuffer( GL_SHADER_STORAGE_BUFFER, cacheBrickBuffer );
+  glBufferData( GL_SHADER_STORAGE_BUFFER, 2 * sizeof( GLuint ), NULL, GL_DYNAMIC_COPY );
+  glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 6, cacheBrickBuffer );
+  glGenBuffers( 1, &cacheWorkBuffer );
+  glBindBuffer( GL_SHADER_STORAGE_BUFFER, cacheWorkBuffer );
+  glBufferData( GL_SHADER_STORAGE_BUFFER, 4 * sizeof( GLuint ), NULL, GL_DYNAMIC_COPY );
+  glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 7, cacheWorkBuffer );
+  glGenBuffers( 1, &cacheCountReadback );
+  glBindBuffer( GL_COPY_WRITE_BUFFER, cacheCountReadback );
+  glBufferStorage( GL_COPY_WRITE_BUFFER, sizeof( GLuint ), NULL, GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT );
+  cacheCountMapping = ( const uint32_t * ) glMapBufferRange( GL_COPY_WRITE_BUFFER, 0, sizeof( GLuint ), GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT );
+  glBindBuffer( GL_COPY_WRITE_BUFFER, 0 );
+
+  cacheBakeInterpretedShader = CShader( "resources/engine_code/shaders/sdf_cache_bake.cs.glsl", false,
+    { { "scene_de.glsl", "#include \"sdf_interpreter.glsl\"" } } ).Program;
+
+  // largest atlas - 9 samples a brick on each side, within the 3D texture limit and the memory budget
+  GLint maxSize = 0;
+  glGetIntegerv( GL_MAX_3D_TEXTURE_SIZE, &maxSize );
+  cacheAtlasLimit = std::max( maxSize / 9, 1 );
+  const auto atlasBytes = [] ( size_t bricks ) { return sizeof( GLfloat ) * ( 9 * bricks ) * ( 9 * bricks ) * ( 9 * bricks ); };
+  while ( cacheAtlasLimit > 1 && atlasBytes( cacheAtlasLimit ) > cacheAtlasBudget )
+    cacheAtlasLimit--;
+}
+
+// lays out the region and restarts the bake from nothing - the lookup falls back to de() everywhere
+// until bricks come in
+void engine::cacheBakeStart() {
+  const float cell = std::max( cacheParams.cellSize, 1e-4f );
+  glm::vec3 regionMin = cacheParams.regionMin, regionMax = cacheParams.regionMax;
+  if ( cacheParams.fitToScene && sceneCompiler.sceneBounded ) { // with room for the band around it
+    regionMin = sceneCompiler.sceneMin - ( cacheParams.band + 1.0f ) * cell;
+    regionMax = sceneCompiler.sceneMax + ( cacheParams.band + 1.0f ) * cell;
+  }
+  cacheMin = regionMin;
+  cacheCell = cell;
+  cacheBrickCount = glm::clamp( glm::ivec3( glm::ceil( ( regionMax - regionMin ) / ( 8.0f * cell ) ) ), glm::ivec3( 1 ), glm::ivec3( cacheMaxBricks ) );
+  const size_t brickTotal = size_t( cacheBrickCount.x ) * cacheBrickCount.y * cacheBrickCount.z;
+
+  // everything starts out unclassified
+  const GLuint pending = 0xFFFFFFFFu;
+  glBindBuffer( GL_SHADER_STORAGE_BUFFER, cacheBrickBuffer );
+  glBufferData( GL_SHADER_STORAGE_BUFFER, 2 * sizeof( GLuint ) * brickTotal, NULL, GL_DYNAMIC_COPY );
+  glClearBufferData( GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &pending );
+
+  // atlas storage is immutable, so a new capacity is a new texture - if the driver can't back it, halve
+  // the size until it can
+  int atlasBricks = glm::clamp( cacheParams.atlasBricks, 1, cacheAtlasLimit );
+  if ( atlasBricks != cacheAtlasBricks ) {
+    while ( glGetError() != GL_NO_ERROR ); // earlier errors aren't this allocation's
+    while ( true ) {
+      glDeleteTextures( 1, &cacheAtlasTexture );
+      glGenTextures( 1, &cacheAtlasTexture );
+      glActiveTexture( GL_TEXTURE0 + 18 );
+      glBindTexture( GL_TEXTURE_3D, cacheAtlasTexture );
+      glTexParameteri( GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+      glTexParameteri( GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+      glTexParameteri( GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+      glTexParameteri( GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+      glTexParameteri( GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE );
+      glTexStorage3D( GL_TEXTURE_3D, 1, GL_R32F, 9 * atlasBricks, 9 * atlasBricks, 9 * atlasBricks );
+      if ( glGetError() != GL_OUT_OF_MEMORY ) break;
+      if ( atlasBricks == 1 ) { // nothing fits, leave the scene to de()
+        cout << T_RED << "couldn't allocate the distance cache atlas" << RESET << endl;
+        glDeleteTextures( 1, &cacheAtlasTexture );
+        cacheAtlasTexture = 0;
+        cacheAtlasBricks = 0;
+        cacheParams.enable = false;
+        cacheBaking = false;
+        return;
+      }
+      atlasBricks /= 2;
+    }
+    if ( atlasBricks != cacheParams.atlasBricks )
+      cout << T_YELLOW << "distance cache atlas limited to " << atlasBricks << " bricks on a side" << RESET << endl;
+    cacheAtlasBricks = cacheParams.atlasBricks = atlasBricks;
+    glBindImageTexture( 3, cacheAtlasTexture, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_R32F );
+  }
+  const size_t capacity = size_t( cacheAtlasBricks ) * cacheAtlasBricks * cacheAtlasBricks;
+
+  // allocation counter and padding, then the work list
+  glBindBuffer( GL_SHADER_STORAGE_BUFFER, cacheWorkBuffer );
+  glBufferData( GL_SHADER_STORAGE_BUFFER, ( 4 + capacity ) * sizeof( GLuint ), NULL, GL_DYNAMIC_COPY );
+  glClearBufferData( GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, NULL );
+
+  if ( cacheCountFence ) { // a count from the previous bake, nothing to wait for anymore
+    glDeleteSync( cacheCountFence );
+    cacheCountFence = 0;
+  }
+  cacheClassified = 0;
+  cacheAllocated = 0;
+  cacheFilled = 0;
+  cacheFull = false;
+  cacheBaking = true;
+  cacheBakeStartTime = std::chrono::steady_clock::now();
+}
+
+// the scene changed, none of the cache is good anymore
+void engine::cacheInvalidate() {
+  cacheShaderCurrent = false;
+  if ( cacheParams.enable )
+    cacheBakeStart();
+}
+
+// per frame - one slice of whichever pass is running
+void engine::cacheBakeUpdate() {
+  if ( !cacheParams.enable || !cacheBaking ) return;
+
+  // the path tracer still runs generated GLSL from before the edit - a bake of the new nodes wouldn't
+  // match the surface it marches, and rebuilding the bake shader every frame of a drag is the cost the
+  // promotion delay is there to avoid. sceneShaderCompile() restarts the bake once they agree again
+  if ( scenePromotionPending && !sceneInterpreted ) return;
+
+  // classifying is done and the allocation count is on its way back - poll, don't wait, and size the
+  // fill pass once it's here. Anything past the capacity was left for de()
+  if ( cacheCountFence ) {
+    GLenum status = glClientWaitSync( cacheCountFence, 0, 0 );
+    if ( status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED ) return;
+    glDeleteSync( cacheCountFence );
+    cacheCountFence = 0;
+    const GLuint allocated = *cacheCountMapping;
+    const GLuint capacity = GLuint( cacheAtlasBricks ) * cacheAtlasBricks * cacheAtlasBricks;
+    cacheAllocated = std::min( allocated, capacity );
+    cacheFull = allocated > capacity;
+  }
+
+  // the bake evaluates de() the same way the path tracer currently does
+  if ( !sceneInterpreted && !cacheShaderCurrent ) {
+    glDeleteProgram( cacheBakeGeneratedShader );
+    cacheBakeGeneratedShader = CShader( "resources/engine_code/shaders/sdf_cache_bake.cs.glsl", false, { { "scene_de.glsl", sceneCompiler.code } } ).Program;
+    cacheShaderCurrent = true;
+  }
+  const GLuint shader = sceneInterpreted ? cacheBakeInterpretedShader : cacheBakeGeneratedShader;
+  glUseProgram( shader );
+  glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 7, cacheWorkBuffer ); // shared with the VAT tree, see vatUniforms()
+  sceneUniforms( shader );
+  cacheUniforms( shader );
+  glUniform1ui( glGetUniformLocation( shader, "cacheCapacity" ), GLuint( cacheAtlasBricks ) * cacheAtlasBricks * cacheAtlasBricks );
+  glUniform1f( glGetUniformLocation( shader, "cacheBand" ), cacheParams.band * cacheCell );
+
+  const int brickTotal = cacheBrickCount.x * cacheBrickCount.y * cacheBrickCount.z;
+  if ( cacheClassified < brickTotal ) {
+    const int count = std::min( std::max( cacheParams.classifyPerFrame, 729 ), brickTotal - cacheClassified );
+    glUniform1i( glGetUniformLocation( shader, "cachePass" ), 0 );
+    glUniform1ui( glGetUniformLocation( shader, "cacheOffset" ), cacheClassified );
+    glUniform1ui( glGetUniformLocation( shader, "cacheCount" ), count );
+    glDispatchCompute( ( count + 728 ) / 729, 1, 1 );
+    glMemoryBarrier( GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT );
+    cacheClassified += count;
+
+    // once, to size the fill pass - copied out behind a fence rather than read back here, which would
+    // wait on the dispatch just issued
+    if ( cacheClassified == brickTotal ) {
+      glBindBuffer( GL_COPY_READ_BUFFER, cacheWorkBuffer );
+      glBindBuffer( GL_COPY_WRITE_BUFFER, cacheCountReadback );
+      glCopyBufferSubData( GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, sizeof( GLuint ) );
+      glBindBuffer( GL_COPY_READ_BUFFER, 0 );
+      glBindBuffer( GL_COPY_WRITE_BUFFER, 0 );
+      cacheCountFence = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+    }
+    return;
+  }
+
+  if ( cacheFilled < cacheAllocated ) {
+    const int count = std::min( std::max( cacheParams.fillPerFrame, 1 ), cacheAllocated - cacheFilled );
+    glUniform1i( glGetUniformLocation( shader, "cachePass" ), 1 );
+    glUniform1ui( glGetUniformLocation( shader, "cacheOffset" ), cacheFilled );
+    glDispatchCompute( count, 1, 1 );
+    glMemoryBarrier( GL_SHADER_STORAGE_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT );
+    cacheFilled += count;
+  }
+
+  if ( cacheFilled == cacheAllocated ) {
+    cacheBaking = false;
+    cacheBakeMs = std::chrono::duration< float, std::milli >( std::chrono::steady_clock::now() - cacheBakeStartTime ).count();
+  }
+}
+
+// layout of the current bake, for the lookup and the bake itself
+void engine::cacheUniforms( GLuint shader ) {
+  glUniform1i( glGetUniformLocation( shader, "cacheActive" ), cacheParams.enable );
+  glUniform3fv( glGetUniformLocation( shader, "cacheMin" ), 1, glm::value_ptr( cacheMin ) );
+  glUniform1f( glGetUniformLocation( shader, "cacheCell" ), cacheCell );
+  glUniform3i( glGetUniformLocation( shader, "cacheBrickCount" ), cacheBrickCount.x, cacheBrickCount.y, cacheBrickCount.z );
+  glUniform1i( glGetUniformLocation( shader, "cacheAtlasBricks" ), cacheAtlasBricks );
+  glUniform1f( glGetUniformLocation( shader, "cacheFallback" ), cacheParams.fallbackEpsilons * core.epsilon );
+}
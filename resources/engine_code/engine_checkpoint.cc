@@ -0,0 +1,236 @@
+#include "engine.h"
+
+// checkpoint data file layout, back to back - accumulator RGBA32F, normalDepth RGBA32F, moments RG32F
+static const size_t accumulatorBytes = size_t( WIDTH ) * HEIGHT * 4 * sizeof( float );
+static const size_t normalDepthBytes = size_t( WIDTH ) * HEIGHT * 4 * sizeof( float );
+static const size_t momentsBytes     = size_t( WIDTH ) * HEIGHT * 2 * sizeof( float );
+static const size_t checkpointBytes  = accumulatorBytes + normalDepthBytes + momentsBytes;
+static const int checkpointVersion = 1;
+
+// write to a temporary and rename over the target, so a crash mid write never leaves a torn file
+static bool writeAtomically( const std::filesystem::path &path, const void *data, size_t bytes ) {
+  std::filesystem::path temporary = path.string() + ".tmp";
+  {
+    std::ofstream file( temporary, std::ios::binary );
+    if ( !file ) return false;
+    file.write( ( const char * ) data, bytes );
+    if ( !file ) return false;
+  }
+  std::error_code error;
+  std::filesystem::rename( temporary, path, error );
+  return !error;
+}
+
+// render parameters and the scene's SDF content - shared by checkpoints and the scene sent to
+// distributed workers, which have to evaluate the same de()
+json engine::sceneState() {
+  json state;
+  state[ "core" ] = core;
+  state[ "lens" ] = lens;
+  state[ "post" ] = post;
+  state[ "denoise" ] = denoiseParams;
+  state[ "reproject" ] = reprojectParams;
+  state[ "palette" ] = palette;
+  state[ "sdf" ][ "nodes" ] = scene.nodes;
+  state[ "sdf" ][ "materials" ] = scene.materials;
+  state[ "sdf" ][ "materialNames" ] = scene.materialNames;
+  state[ "sdf" ][ "boundsMargin" ] = sceneCompiler.boundsMargin;
+  return state;
+}
+
+// throws json::exception on missing or mistyped fields, before anything has been changed - "sdf" is
+// optional, for states written before it was part of them
+void engine::sceneLoad( const json &state ) {
+  coreParameters loadedCore = state.at( "core" );
+  lensParameters loadedLens = state.at( "lens" );
+  postParameters loadedPost = state.at( "post" );
+  denoiseParameters loadedDenoise = state.at( "denoise" );
+  reprojectParameters loadedReproject = state.at( "reproject" );
+  std::vector< glm::vec3 > loadedPalette = state.at( "palette" );
+
+  sceneDescription loadedScene;
+  float loadedMargin = sceneCompiler.boundsMargin;
+  const bool hasSDF = state.contains( "sdf" );
+  if ( hasSDF ) {
+    const json &sdf = state.at( "sdf" );
+    loadedScene.nodes = sdf.at( "nodes" ).get< std::vector< sdfNode > >();
+    loadedScene.materials = sdf.at( "materials" ).get< std::vector< sceneMaterial > >();
+    loadedScene.materialNames = sdf.at( "materialNames" ).get< std::vector< std::string > >();
+    loadedMargin = sdf.at( "boundsMargin" );
+    if ( loadedScene.materialNames.size() != loadedScene.materials.size() || !loadedScene.treeValid() )
+      throw json::other_error::create( 501, "sdf nodes don't form a valid tree" );
+  }
+
+  core = loadedCore;
+  lens = loadedLens;
+  post = loadedPost;
+  denoiseParams = loadedDenoise;
+  reprojectParams = loadedReproject;
+  if ( !loadedPalette.empty() ) palette = loadedPalette;
+
+  // the new camera is taken as is, nothing to reproject
+  updateBasis();
+  previousCore = core;
+  previousLens = lens;
+  fullFrameDirty = true;
+  paletteUpdate();
+
+  // de() only gets rebuilt when the content actually changed, states mostly carry the same scene
+  auto same = []( const auto &a, const auto &b ) {
+    return a.size() == b.size() && ( a.empty() || std::memcmp( a.data(), b.data(), a.size() * sizeof( a[ 0 ] ) ) == 0 );
+  };
+  if ( hasSDF && ( !same( loadedScene.nodes, scene.nodes ) || !same( loadedScene.materials, scene.materials ) || loadedMargin != sceneCompiler.boundsMargin ) ) {
+    scene.nodes = std::move( loadedScene.nodes );
+    scene.materials = std::move( loadedScene.materials );
+    scene.materialNames = std::move( loadedScene.materialNames );
+    sceneCompiler.boundsMargin = loadedMargin;
+    sceneEdited();
+  }
+}
+
+json engine::checkpointState() {
+  json state = sceneState();
+  state[ "version" ] = checkpointVersion;
+  state[ "width" ] = WIDTH;
+  state[ "height" ] = HEIGHT;
+  state[ "frameIndex" ] = frameIndex;
+  state[ "layout" ] = { "accumulator rgba32f", "normalDepth rgba32f", "moments rg32f" };
+
+  // tile scheduler - the shuffled order, where we are in it, and the generator for the next shuffle
+  std::stringstream rngState;
+  rngState << tileRNG;
+  state[ "tiles" ][ "offsets" ] = tileOffsets;
+  state[ "tiles" ][ "listOffset" ] = tileListOffset;
+  state[ "tiles" ][ "rng" ] = rngState.str();
+  return state;
+}
+
+void engine::checkpoint() {
+  // oldest free slot - both busy means the writer is falling behind, skip this one
+  checkpointSlot *slot = nullptr;
+  for ( auto &s : checkpointSlots )
+    if ( !s.fence && !s.writing && ( !slot || s.sequence < slot->sequence ) )
+      slot = &s;
+  lastCheckpoint = std::chrono::steady_clock::now();
+  if ( !slot ) {
+    cout << "Checkpoint - both readback slots busy, skipping" << endl;
+    return;
+  }
+
+  // slots are allocated on first use, mapped for the lifetime of the program
+  if ( !slot->buffer ) {
+    glGenBuffers( 1, &slot->buffer );
+    glBindBuffer( GL_PIXEL_PACK_BUFFER, slot->buffer );
+    glBufferStorage( GL_PIXEL_PACK_BUFFER, checkpointBytes, NULL, GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT );
+    slot->mapping = ( uint8_t * ) glMapBufferRange( GL_PIXEL_PACK_BUFFER, 0, checkpointBytes, GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT );
+  }
+
+  // async copies into the pack buffer, fence tells us when they've landed
+  glMemoryBarrier( GL_TEXTURE_UPDATE_BARRIER_BIT );
+  glBindBuffer( GL_PIXEL_PACK_BUFFER, slot->buffer );
+  glActiveTexture( GL_TEXTURE0 );
+  glBindTexture( GL_TEXTURE_2D, accumulatorTexture );
+  glGetTexImage( GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, ( void * ) 0 );
+  glBindTexture( GL_TEXTURE_2D, normalDepthTexture );
+  glGetTexImage( GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, ( void * ) accumulatorBytes );
+  glBindTexture( GL_TEXTURE_2D, momentsTexture );
+  glGetTexImage( GL_TEXTURE_2D, 0, GL_RG, GL_FLOAT, ( void * ) ( accumulatorBytes + normalDepthBytes ) );
+  glBindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
+  slot->fence = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+  slot->sequence = ++checkpointSequence;
+  slot->state = checkpointState();
+}
+
+void engine::checkpointUpdate() {
+  if ( checkpointParams.enable && mode == renderMode::pathtrace ) {
+    float elapsed = std::chrono::duration< float >( std::chrono::steady_clock::now() - lastCheckpoint ).count();
+    if ( elapsed > checkpointParams.interval )
+      checkpoint();
+  }
+
+  // hand off finished readbacks, oldest first so checkpoint.json always ends up pointing at the newest
+  checkpointSlot *order[ 2 ] = { &checkpointSlots[ 0 ], &checkpointSlots[ 1 ] };
+  if ( order[ 0 ]->sequence > order[ 1 ]->sequence ) std::swap( order[ 0 ], order[ 1 ] );
+  for ( auto slot : order ) {
+    if ( !slot->fence ) continue;
+
+    // poll, don't wait - check again next frame if the copy hasn't finished
+    GLenum status = glClientWaitSync( slot->fence, 0, 0 );
+    if ( status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED ) break;
+    glDeleteSync( slot->fence );
+    slot->fence = 0;
+    slot->writing = true;
+
+    // data goes straight from the mapping to disk on the writer thread, the slot is released when done
+    std::filesystem::path directory = checkpointParams.directory;
+    std::string dataFile = "checkpoint." + std::to_string( slot - checkpointSlots ) + ".bin";
+    slot->state[ "data" ] = dataFile;
+    imageWriteJob job;
+    job.filename = ( directory / "checkpoint.json" ).string();
+    job.task = [ slot, directory, dataFile ] {
+      std::filesystem::create_directories( directory );
+      bool ok = writeAtomically( directory / dataFile, slot->mapping, checkpointBytes );
+      if ( ok ) { // metadata last, it's what makes the new data file current
+        std::string text = slot->state.dump( 2 );
+        ok = writeAtomically( directory / "checkpoint.json", text.data(), text.size() );
+      }
+      slot->writing = false;
+      return ok;
+    };
+    writer.push( std::move( job ) );
+  }
+}
+
+bool engine::checkpointLoad() {
+  std::filesystem::path directory = checkpointParams.directory;
+  cout << T_BLUE << "    Resuming From Checkpoint" << RESET << " ......................... ";
+
+  json state;
+  std::ifstream metadata( directory / "checkpoint.json" );
+  if ( !metadata ) {
+    cout << T_RED << "no checkpoint in " << directory << RESET << endl;
+    return false;
+  }
+
+  try {
+    metadata >> state;
+    if ( state.at( "version" ).get< int >() != checkpointVersion || state.at( "width" ).get< int >() != WIDTH || state.at( "height" ).get< int >() != HEIGHT ) {
+      cout << T_RED << "checkpoint doesn't match this build" << RESET << endl;
+      return false;
+    }
+
+    std::vector< uint8_t > data( checkpointBytes );
+    std::ifstream file( directory / state.at( "data" ).get< std::string >(), std::ios::binary );
+    if ( !file.read( ( char * ) data.data(), checkpointBytes ) ) {
+      cout << T_RED << "checkpoint data is incomplete" << RESET << endl;
+      return false;
+    }
+
+    // scheduler state first - these can throw, and nothing should be half restored
+    std::vector< glm::ivec2 > loadedTiles = state.at( "tiles" ).at( "offsets" );
+    int loadedListOffset = state.at( "tiles" ).at( "listOffset" );
+    uint32_t loadedFrameIndex = state.at( "frameIndex" );
+    std::string loadedRNG = state.at( "tiles" ).at( "rng" );
+    sceneLoad( state );
+
+    tileOffsets = loadedTiles;
+    tileListOffset = loadedListOffset;
+    tileDirty.assign( tileOffsets.size(), false );
+    frameIndex = loadedFrameIndex;
+    std::stringstream rngState( loadedRNG );
+    rngState >> tileRNG;
+
+    glBindTexture( GL_TEXTURE_2D, accumulatorTexture );
+    glTexSubImage2D( GL_TEXTURE_2D, 0, 0, 0, WIDTH, HEIGHT, GL_RGBA, GL_FLOAT, data.data() );
+    glBindTexture( GL_TEXTURE_2D, normalDepthTexture );
+    glTexSubImage2D( GL_TEXTURE_2D, 0, 0, 0, WIDTH, HEIGHT, GL_RGBA, GL_FLOAT, data.data() + accumulatorBytes );
+    glBindTexture( GL_TEXTURE_2D, momentsTexture );
+    glTexSubImage2D( GL_TEXTURE_2D, 0, 0, 0, WIDTH, HEIGHT, GL_RG, GL_FLOAT, data.data() + accumulatorBytes + normalDepthBytes );
+  } catch ( json::exception &e ) {
+    cout << T_RED << "malformed checkpoint - " << e.what() << RESET << endl;
+    return false;
+  }
+
+  cout << T_GREEN << "done." << RESET << endl;
+  return true;
+}
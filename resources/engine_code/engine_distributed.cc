@@ -0,0 +1,303 @@
+#include "engine.h"
+
+#include <spawn.h>
+#include <sys/wait.h>
+
+extern char **environ;
+
+// units each worker holds at once - one rendering, one queued behind it to hide the round trip
+static const size_t unitsInFlight = 2;
+
+void engine::distributedSetup() {
+  if ( launch.coordinatorPort ) {
+    distributedRole = distributedMode::coordinator;
+    cout << T_BLUE << "    Starting Coordinator" << RESET << " ............................. ";
+    listenSocket = netListen( launch.coordinatorPort );
+    if ( listenSocket < 0 ) {
+      cout << T_RED << "couldn't listen on port " << launch.coordinatorPort << RESET << endl;
+      distributedRole = distributedMode::none;
+      return;
+    }
+    coordinatorRestart();
+    cout << T_GREEN << "done." << RESET << " listening on port " << launch.coordinatorPort << endl;
+
+    // workers on this machine - same executable, pointed back at us
+    for ( int i = 0; i < launch.localWorkers; i++ ) {
+      std::string address = "127.0.0.1:" + std::to_string( launch.coordinatorPort );
+      char *arguments[] = { ( char * ) "exe", ( char * ) "--worker", ( char * ) address.c_str(), nullptr };
+      pid_t pid;
+      if ( posix_spawn( &pid, "/proc/self/exe", nullptr, nullptr, arguments, environ ) == 0 )
+        localWorkerProcesses.push_back( pid );
+      else
+        cout << "Failed to start local worker " << i << endl;
+    }
+
+  } else if ( !launch.workerAddress.empty() ) {
+    distributedRole = distributedMode::worker;
+    checkpointParams.enable = false; // the coordinator owns the render state
+    cout << T_BLUE << "    Connecting To Coordinator" << RESET << " ........................ ";
+
+    // the coordinator may still be starting up
+    for ( int attempt = 0; attempt < 50 && !coordinatorLink.open(); attempt++ ) {
+      coordinatorLink.fd = netConnect( launch.workerAddress );
+      if ( !coordinatorLink.open() ) std::this_thread::sleep_for( std::chrono::milliseconds( 100 ) );
+    }
+    if ( !coordinatorLink.open() ) {
+      cout << T_RED << "couldn't reach " << launch.workerAddress << RESET << endl;
+      pQuit = true;
+      return;
+    }
+    helloMessage hello = { protocolVersion, WIDTH, HEIGHT, TILESIZE };
+    coordinatorLink.send( MSG_HELLO, &hello, sizeof( hello ) );
+    cout << T_GREEN << "done." << RESET << endl;
+  }
+}
+
+void engine::distributedQuit() {
+  for ( auto &w : remoteWorkers ) {
+    w->link.send( MSG_DONE, nullptr, 0 );
+    w->link.close();
+  }
+  remoteWorkers.clear();
+  if ( listenSocket >= 0 ) close( listenSocket );
+  listenSocket = -1;
+  for ( pid_t pid : localWorkerProcesses )
+    waitpid( pid, nullptr, 0 );
+  localWorkerProcesses.clear();
+  coordinatorLink.close();
+}
+
+void engine::coordinatorRestart() {
+  // units ordered by sample range, then shuffled tiles, so the whole image refines together
+  distributedEpoch++;
+  workQueue.clear();
+  std::vector< glm::ivec2 > tiles;
+  for ( int x = 0; x < WIDTH; x += TILESIZE )
+    for ( int y = 0; y < HEIGHT; y += TILESIZE )
+      tiles.push_back( glm::ivec2( x, y ) );
+  int samplesPerUnit = std::max( 1, launch.samplesPerUnit );
+  for ( int first = 0; first < launch.targetSamples; first += samplesPerUnit ) {
+    std::shuffle( tiles.begin(), tiles.end(), tileRNG );
+    for ( auto &tile : tiles ) {
+      uint32_t count = std::min( samplesPerUnit, launch.targetSamples - first );
+      workQueue.push_back( { distributedEpoch, nextUnitID++, tile.x, tile.y, uint32_t( first ), count } );
+    }
+  }
+  unitsTotal = workQueue.size();
+  unitsMerged = 0;
+  coordinatorHeld = false;
+
+  // anything in flight is stale now, workers get the new scene before their next unit
+  std::string scene = sceneState().dump();
+  for ( auto &w : remoteWorkers ) {
+    w->inFlight.clear();
+    if ( w->ready )
+      w->link.send( MSG_SCENE, &distributedEpoch, sizeof( distributedEpoch ), scene.data(), scene.size() );
+  }
+}
+
+// per frame while an edit is dragged - results for the old scene stop merging and no units go out,
+// without serializing and sending the whole scene each time
+void engine::coordinatorHold() {
+  distributedEpoch++;
+  workQueue.clear();
+  for ( auto &w : remoteWorkers )
+    w->inFlight.clear();
+  unitsTotal = 0;
+  unitsMerged = 0;
+  coordinatorHeld = true;
+}
+
+void engine::coordinatorUpdate() {
+  // new connections
+  for ( int fd = netAccept( listenSocket ); fd >= 0; fd = netAccept( listenSocket ) ) {
+    remoteWorkers.push_back( std::make_unique< remoteWorker >() );
+    remoteWorkers.back()->link.fd = fd;
+  }
+
+  messageHeader header;
+  std::vector< uint8_t > payload;
+  for ( auto it = remoteWorkers.begin(); it != remoteWorkers.end(); ) {
+    remoteWorker &w = **it;
+    bool alive = w.link.receive();
+
+    while ( alive && w.link.next( header, payload ) ) {
+      switch ( header.type ) {
+        case MSG_HELLO: {
+          helloMessage hello;
+          memcpy( &hello, payload.data(), std::min( payload.size(), sizeof( hello ) ) );
+          if ( payload.size() != sizeof( hello ) || hello.version != protocolVersion || hello.width != WIDTH || hello.height != HEIGHT || hello.tileSize != TILESIZE ) {
+            cout << "Coordinator - rejected a worker with a mismatched build" << endl;
+            w.link.send( MSG_DONE, nullptr, 0 );
+            alive = false;
+            break;
+          }
+          std::string scene = sceneState().dump();
+          w.link.send( MSG_SCENE, &distributedEpoch, sizeof( distributedEpoch ), scene.data(), scene.size() );
+          w.ready = true;
+          break;
+        }
+
+        case MSG_RESULT: {
+          if ( payload.size() != sizeof( workUnit ) + tileResultFloats( TILESIZE ) * sizeof( float ) ) {
+            alive = false;
+            break;
+          }
+          workUnit unit;
+          memcpy( &unit, payload.data(), sizeof( unit ) );
+          w.inFlight.erase( std::remove_if( w.inFlight.begin(), w.inFlight.end(),
+            [ & ]( const workUnit &u ) { return u.id == unit.id; } ), w.inFlight.end() );
+          if ( unit.epoch == distributedEpoch ) { // results for an old view are dropped
+            coordinatorMerge( unit, ( const float * ) ( payload.data() + sizeof( workUnit ) ) );
+            unitsMerged++;
+          }
+          break;
+        }
+
+        default: break;
+      }
+    }
+    alive &= w.link.open(); // next() drops a connection that sends an oversized header
+
+    // lost a worker - its units go back to the front of the queue
+    if ( !alive ) {
+      for ( auto &unit : w.inFlight )
+        if ( unit.epoch == distributedEpoch )
+          workQueue.push_front( unit );
+      w.link.close();
+      it = remoteWorkers.erase( it );
+      continue;
+    }
+
+    // top up
+    while ( w.ready && w.inFlight.size() < unitsInFlight && !workQueue.empty() ) {
+      workUnit unit = workQueue.front();
+      workQueue.pop_front();
+      w.inFlight.push_back( unit );
+      w.link.send( MSG_WORK, &unit, sizeof( unit ) );
+    }
+    ++it;
+  }
+}
+
+// weighted by sample count into the local buffers, see merge.cs.glsl
+void engine::coordinatorMerge( const workUnit &unit, const float *data ) {
+  const size_t texels = TILESIZE * TILESIZE;
+  glActiveTexture( GL_TEXTURE0 + 15 );
+  glTexSubImage2D( GL_TEXTURE_2D, 0, 0, 0, TILESIZE, TILESIZE, GL_RGBA, GL_FLOAT, data );
+  glActiveTexture( GL_TEXTURE0 + 16 );
+  glTexSubImage2D( GL_TEXTURE_2D, 0, 0, 0, TILESIZE, TILESIZE, GL_RGBA, GL_FLOAT, data + texels * 4 );
+  glActiveTexture( GL_TEXTURE0 + 17 );
+  glTexSubImage2D( GL_TEXTURE_2D, 0, 0, 0, TILESIZE, TILESIZE, GL_RG, GL_FLOAT, data + texels * 8 );
+
+  glUseProgram( mergeShader );
+  glUniform2i( glGetUniformLocation( mergeShader, "tileOffset" ), unit.x, unit.y );
+  glDispatchCompute( TILESIZE / 32, TILESIZE / 32, 1 );
+  glMemoryBarrier( GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT );
+  markTileDirty( glm::ivec2( unit.x, unit.y ) );
+}
+
+void engine::workerUpdate() {
+  if ( !coordinatorLink.open() ) {
+    pQuit = true;
+    return;
+  }
+
+  // short wait keeps an idle worker from spinning, without stalling the window
+  coordinatorLink.wait( 10 );
+  if ( !coordinatorLink.receive() ) {
+    cout << "Worker - lost the coordinator, quitting" << endl;
+    coordinatorLink.close();
+    pQuit = true;
+    return;
+  }
+
+  // everything that's arrived - a scene makes the ones before it, and the units queued behind those, stale
+  std::vector< std::pair< messageHeader, std::vector< uint8_t > > > messages;
+  std::pair< messageHeader, std::vector< uint8_t > > message;
+  size_t first = 0;
+  while ( coordinatorLink.next( message.first, message.second ) ) {
+    if ( message.first.type == MSG_SCENE ) first = messages.size();
+    messages.push_back( std::move( message ) );
+  }
+
+  for ( size_t i = first; i < messages.size(); i++ ) {
+    const messageHeader &header = messages[ i ].first;
+    const std::vector< uint8_t > &payload = messages[ i ].second;
+    switch ( header.type ) {
+      case MSG_SCENE:
+        if ( payload.size() < sizeof( workerEpoch ) ) {
+          cout << "Worker - malformed scene message" << endl;
+          pQuit = true;
+          return;
+        }
+        try {
+          memcpy( &workerEpoch, payload.data(), sizeof( workerEpoch ) );
+          sceneLoad( json::parse( payload.begin() + sizeof( workerEpoch ), payload.end() ) );
+        } catch ( json::exception &e ) {
+          cout << "Worker - malformed scene, " << e.what() << endl;
+          pQuit = true;
+          return;
+        }
+        break;
+
+      case MSG_WORK: {
+        workUnit unit = {};
+        if ( payload.size() == sizeof( unit ) )
+          memcpy( &unit, payload.data(), sizeof( unit ) );
+        if ( payload.size() != sizeof( unit ) || unit.x < 0 || unit.y < 0 || unit.x >= WIDTH || unit.y >= HEIGHT ) {
+          cout << "Worker - malformed work unit" << endl;
+          pQuit = true;
+          return;
+        }
+        workerRender( unit );
+        break;
+      }
+
+      case MSG_DONE:
+        pQuit = true;
+        return;
+
+      default: break;
+    }
+  }
+}
+
+void engine::workerRender( const workUnit &unit ) {
+  // the tile starts empty, so it holds exactly this unit's samples
+  int width = std::min( TILESIZE, WIDTH - unit.x );
+  int height = std::min( TILESIZE, HEIGHT - unit.y );
+  const float zero[ 4 ] = { 0.0f, 0.0f, 0.0f, 0.0f };
+  glClearTexSubImage( accumulatorTexture, 0, unit.x, unit.y, 0, width, height, 1, GL_RGBA, GL_FLOAT, zero );
+  glClearTexSubImage( normalDepthTexture, 0, unit.x, unit.y, 0, width, height, 1, GL_RGBA, GL_FLOAT, zero );
+  glClearTexSubImage( momentsTexture, 0, unit.x, unit.y, 0, width, height, 1, GL_RG, GL_FLOAT, zero );
+
+  // sample indices seed the RNG, so units of the same tile never repeat each other's paths
+  pathtraceUniforms();
+  glUniform2i( glGetUniformLocation( pathtraceShader, "tileOffset" ), unit.x, unit.y );
+  glUniform1ui( glGetUniformLocation( pathtraceShader, "sampleIndexBase" ), unit.firstSample );
+  for ( uint32_t i = 0; i < unit.sampleCount; i++ ) {
+    glUniform1ui( glGetUniformLocation( pathtraceShader, "frameIndex" ), unit.firstSample + i );
+    noiseUniforms( unit.firstSample + i );
+    glDispatchCompute( TILESIZE / 32, TILESIZE / 32, 1 );
+    glMemoryBarrier( GL_SHADER_IMAGE_ACCESS_BARRIER_BIT );
+  }
+  glMemoryBarrier( GL_TEXTURE_UPDATE_BARRIER_BIT );
+
+  // copy out through full size tile textures, zero past the image edge
+  const GLuint sources[ 3 ] = { accumulatorTexture, normalDepthTexture, momentsTexture };
+  const GLenum formats[ 3 ] = { GL_RGBA, GL_RGBA, GL_RG };
+  const size_t offsets[ 3 ] = { 0, TILESIZE * TILESIZE * 4, TILESIZE * TILESIZE * 8 };
+  std::vector< float > data( tileResultFloats( TILESIZE ) );
+  for ( int i = 0; i < 3; i++ ) {
+    glClearTexSubImage( tileResultTextures[ i ], 0, 0, 0, 0, TILESIZE, TILESIZE, 1, formats[ i ], GL_FLOAT, zero );
+    glCopyImageSubData( sources[ i ], GL_TEXTURE_2D, 0, unit.x, unit.y, 0, tileResultTextures[ i ], GL_TEXTURE_2D, 0, 0, 0, 0, width, height, 1 );
+    glActiveTexture( GL_TEXTURE0 + 15 + i );
+    glGetTexImage( GL_TEXTURE_2D, 0, formats[ i ], GL_FLOAT, data.data() + offsets[ i ] );
+  }
+
+  if ( !coordinatorLink.send( MSG_RESULT, &unit, sizeof( unit ), data.data(), data.size() * sizeof( float ) ) )
+    coordinatorLink.close();
+  unitsRendered++;
+  markTileDirty( glm::ivec2( unit.x, unit.y ) );
+}
@@ -79,6 +79,321 @@ void engine::controlsWindow() {
   ImGui::Begin( "Controls", NULL, 0 );
 
   // controls
+  if ( ImGui::Button( " Screenshot " ) )
+    screenShot();
+  ImGui::SameLine();
+  HelpMarker( "Also on F12 - encoded in the background, saved to screenshots/" );
+  const char *presets[] = { "Fast", "Best" };
+  ImGui::Combo( "PNG Compression", &exportParams.pngPreset, presets, IM_ARRAYSIZE( presets ) );
+
+  if ( ImGui::Button( " Export Accumulator " ) )
+    accumulatorExport();
+  ImGui::SameLine();
+  HelpMarker( "Raw float radiance plus per pixel sample count, saved to exports/ - for merging, resuming, or offline tonemapping" );
+  const char *floatFormats[] = { "PFM", "EXR" };
+  int floatFormat = exportParams.floatFormat - IMAGE_PFM;
+  if ( ImGui::Combo( "Float Format", &floatFormat, floatFormats, IM_ARRAYSIZE( floatFormats ) ) )
+    exportParams.floatFormat = floatFormat + IMAGE_PFM;
+  if ( exportParams.floatFormat == IMAGE_EXR ) {
+    ImGui::Checkbox( "Half Float", &exportParams.halfFloat );
+    ImGui::SameLine();
+    ImGui::Checkbox( "ZIP", &exportParams.zip );
+  }
+
+  if ( ImGui::CollapsingHeader( "Profiler" ) ) {
+    float frameMs = profile.frameTime.average();
+    ImGui::Text( "%.2f ms/frame, %.1f fps", frameMs, frameMs > 0.0f ? 1000.0f / frameMs : 0.0f );
+    const profiler::series *tiles = profile.counter( "Tiles" );
+    const profiler::series *rays = profile.counter( "Primary Rays" );
+    if ( tiles && rays ) {
+      // totals over the whole history window, so it doesn't jitter frame to frame
+      float seconds = frameMs * profiler::historyLength / 1000.0f;
+      float rayRate = seconds > 0.0f ? rays->average() * profiler::historyLength / seconds : 0.0f;
+      ImGui::Text( "%.1f tiles/frame, %.2f Mrays/s primary", tiles->average(), rayRate / 1e6f );
+      ImGui::PlotLines( "Tiles", tiles->history, profiler::historyLength, profile.offset, NULL, 0.0f, FLT_MAX, ImVec2( 0, 40 ) );
+    }
+    ImGui::PlotLines( "Frame", profile.frameTime.history, profiler::historyLength, profile.offset, NULL, 0.0f, FLT_MAX, ImVec2( 0, 40 ) );
+    ImGui::SameLine();
+    HelpMarker( "GPU times come from timestamp queries read back a few frames late, so nothing waits on them - CPU times are submission cost" );
+
+    ImGui::Checkbox( "Path Tracer Counters", &collectStats );
+    ImGui::SameLine();
+    HelpMarker( "Atomic counters in the path tracer, read back a frame late - adds a little shader cost, also --stats" );
+    if ( collectStats && ImGui::BeginTable( "counters", 3, ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV ) ) {
+      const char *names[] = { "Traced Primary Rays", "Bounce Rays", "DE Calls", "Misses", "Step Limit Hits" };
+      ImGui::TableSetupColumn( "Counter" );
+      ImGui::TableSetupColumn( "Per Frame" );
+      ImGui::TableSetupColumn( "Per Second" );
+      ImGui::TableHeadersRow();
+      for ( auto name : names ) {
+        const profiler::series *s = profile.counter( name );
+        float perFrame = s ? s->average() : 0.0f;
+        ImGui::TableNextRow();
+        ImGui::TableNextColumn(); ImGui::TextUnformatted( name );
+        ImGui::TableNextColumn(); ImGui::Text( "%.0f", perFrame );
+        ImGui::TableNextColumn(); ImGui::Text( "%.2f M", frameMs > 0.0f ? perFrame * 1000.0f / frameMs / 1e6f : 0.0f );
+      }
+      ImGui::EndTable();
+    }
+
+    if ( ImGui::BeginTable( "passes", 5, ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV ) ) {
+      ImGui::TableSetupColumn( "Pass" );
+      ImGui::TableSetupColumn( "CPU avg" );
+      ImGui::TableSetupColumn( "CPU peak" );
+      ImGui::TableSetupColumn( "GPU avg" );
+      ImGui::TableSetupColumn( "GPU peak" );
+      ImGui::TableHeadersRow();
+      for ( auto &t : profile.timers ) {
+        ImGui::TableNextRow();
+        ImGui::TableNextColumn(); ImGui::TextUnformatted( t.cpu.name.c_str() );
+        ImGui::TableNextColumn(); ImGui::Text( "%.3f ms", t.cpu.average() );
+        ImGui::TableNextColumn(); ImGui::Text( "%.3f ms", t.cpu.peak() );
+        ImGui::TableNextColumn(); if ( t.useGPU ) ImGui::Text( "%.3f ms", t.gpu.average() ); else ImGui::TextDisabled( "-" );
+        ImGui::TableNextColumn(); if ( t.useGPU ) ImGui::Text( "%.3f ms", t.gpu.peak() ); else ImGui::TextDisabled( "-" );
+      }
+      ImGui::EndTable();
+    }
+
+    // rolling graphs, GPU where there is one
+    for ( auto &t : profile.timers ) {
+      const profiler::series &s = t.useGPU ? t.gpu : t.cpu;
+      char overlay[ 64 ];
+      snprintf( overlay, sizeof( overlay ), "%s %.2f ms", t.useGPU ? "GPU" : "CPU", s.average() );
+      ImGui::PlotLines( t.cpu.name.c_str(), s.history, profiler::historyLength, t.useGPU ? profile.gpuOffset : profile.offset,
+        overlay, 0.0f, FLT_MAX, ImVec2( 0, 40 ) );
+    }
+  }
+
+  if ( ImGui::CollapsingHeader( "Checkpoints" ) ) {
+    ImGui::Checkbox( "Periodic Checkpoints", &checkpointParams.enable );
+    ImGui::SameLine();
+    HelpMarker( "Accumulator and render state, written in the background - relaunch with --resume to continue" );
+    ImGui::SliderFloat( "Interval", &checkpointParams.interval, 10.0f, 3600.0f, "%.0f s" );
+    if ( ImGui::Button( " Checkpoint Now " ) )
+      checkpoint();
+    ImGui::Text( "Frame index %u, saving to %s/", frameIndex, checkpointParams.directory.c_str() );
+  }
+
+  if ( distributedRole != distributedMode::none && ImGui::CollapsingHeader( "Distributed" ) ) {
+    if ( distributedRole == distributedMode::coordinator ) {
+      size_t inFlight = 0;
+      for ( auto &w : remoteWorkers )
+        inFlight += w->inFlight.size();
+      ImGui::Text( "Coordinator on port %d, %d workers connected", launch.coordinatorPort, int( remoteWorkers.size() ) );
+      ImGui::ProgressBar( unitsTotal ? float( unitsMerged ) / float( unitsTotal ) : 0.0f );
+      ImGui::Text( "%zu/%zu units merged, %zu in flight, %zu queued", unitsMerged, unitsTotal, inFlight, workQueue.size() );
+      ImGui::Text( "Target %d spp, %d samples per unit", launch.targetSamples, launch.samplesPerUnit );
+      if ( coordinatorHeld )
+        ImGui::Text( "Holding work until the scene edit settles" );
+    } else {
+      ImGui::Text( "Worker for %s, epoch %u", launch.workerAddress.c_str(), workerEpoch );
+      ImGui::Text( "%zu units rendered", unitsRendered );
+    }
+  }
+
+  if ( ImGui::CollapsingHeader( "Scene" ) ) {
+    if ( scene.source.empty() ) {
+      ImGui::Text( "No scene file, load one with --scene <path>" );
+    } else {
+      ImGui::Text( "%s", scene.source.c_str() );
+      ImGui::Text( "%zu nodes, %zu materials, %zu assets", scene.nodes.size(), scene.materials.size(), scene.assets.size() );
+      ImGui::Text( "Loaded %s in %.2f ms", scene.fromCache ? "from cache" : "from JSON", sceneLoadMs );
+      if ( ImGui::Button( "Reload" ) )
+        sceneFileLoad( scene.source );
+      const sdfCompileStats &s = sceneCompiler.stats;
+      ImGui::Text( "de(): %d primitives, %d operations, %d bounds checks", s.primitives, s.operations, s.boundsChecks );
+      ImGui::Text( "%d transforms folded, %d nodes simplified away", s.transformsFolded, s.nodesRemoved );
+      ImGui::Text( "%d lines of GLSL, generated in %.2f ms, built in %.2f ms", s.lines, s.compileMs, sceneShaderMs );
+      ImGui::Text( "%d instructions of bytecode, %d registers, %d domains", s.instructions, s.stackDepth, s.domainDepth );
+      if ( s.bvhNodes )
+        ImGui::Text( "BVH over %d objects, %d nodes, %d deep, %d objects outside", s.bvhObjects, s.bvhNodes, s.bvhDepth, s.unboundedObjects );
+      if ( ImGui::SliderFloat( "Bounds Margin", &sceneCompiler.boundsMargin, 0.001f, 1.0f, "%.3f", ImGuiSliderFlags_Logarithmic ) )
+        sceneEdited( true );
+      ImGui::SameLine();
+      HelpMarker( "Subtrees with a bounding box are only evaluated once a point is this close to the box, otherwise de() returns the distance to the box" );
+
+      const char *evaluators[] = { "Automatic", "Generated GLSL", "Bytecode Interpreter" };
+      if ( ImGui::Combo( "Evaluator", &sceneEvaluator, evaluators, IM_ARRAYSIZE( evaluators ) ) )
+        sceneEvaluatorSelect();
+      ImGui::SameLine();
+      HelpMarker( "Generated GLSL is fastest, but every edit rebuilds the path tracer. The interpreter runs the scene from a buffer, so edits apply immediately. Automatic interprets while editing and switches to the generated GLSL once edits settle, generated GLSL waits for edits to settle before rebuilding" );
+      ImGui::SliderFloat( "Promotion Delay", &scenePromotionDelay, 0.1f, 10.0f, "%.1f s" );
+      if ( !sceneCompiler.programFits )
+        ImGui::TextColored( ImVec4( 1.0f, 0.3f, 0.3f, 1.0f ), "Too deep for the interpreter, generated GLSL only" );
+      else if ( sceneInterpreted && scenePromotionPending )
+        ImGui::Text( "Interpreting, generated GLSL in %.1f s", std::max( 0.0f, scenePromotionDelay - std::chrono::duration< float >( std::chrono::steady_clock::now() - sceneEditTime ).count() ) );
+      else
+        ImGui::Text( "Running %s", sceneInterpreted ? "the bytecode interpreter" : "generated GLSL" );
+      if ( ImGui::Button( "Recompile" ) )
+        sceneEdited();
+      ImGui::SameLine();
+      if ( ImGui::Button( "Copy GLSL" ) )
+        ImGui::SetClipboardText( sceneCompiler.code.c_str() );
+
+      if ( !scene.nodes.empty() && ImGui::TreeNode( "Nodes" ) ) {
+        if ( sceneNodeEditor( 0 ) )
+          sceneEdited( true );
+        ImGui::TreePop();
+      }
+      for ( auto &e : scene.errors )
+        ImGui::TextColored( ImVec4( 1.0f, 0.3f, 0.3f, 1.0f ), "%s", e.c_str() );
+    }
+  }
+
+  if ( ImGui::CollapsingHeader( "Distance Cache" ) ) {
+    if ( ImGui::Checkbox( "Cache de()", &cacheParams.enable ) && cacheParams.enable )
+      cacheBakeStart();
+    ImGui::SameLine();
+    HelpMarker( "Bakes de() into a sparse brick map around the surface, for marching static scenes - rays step on the cached distance and call de() within a few epsilon of a surface, so hits don't move" );
+    ImGui::Checkbox( "Fit To Scene", &cacheParams.fitToScene );
+    if ( !cacheParams.fitToScene || !sceneCompiler.sceneBounded ) {
+      ImGui::DragFloat3( "Region Min", &cacheParams.regionMin.x, 0.01f );
+      ImGui::DragFloat3( "Region Max", &cacheParams.regionMax.x, 0.01f );
+    }
+    ImGui::SliderFloat( "Cell Size", &cacheParams.cellSize, 0.001f, 1.0f, "%.3f", ImGuiSliderFlags_Logarithmic );
+    ImGui::SliderFloat( "Band", &cacheParams.band, 0.0f, 8.0f, "%.1f cells" );
+    ImGui::SliderInt( "Atlas Bricks", &cacheParams.atlasBricks, 1, cacheAtlasLimit );
+    ImGui::SameLine();
+    HelpMarker( "On a side of the atlas - the cube of this is how many bricks near the surface get samples. Limited by the 3D texture size and a 1 GB budget, and halved if the driver runs out of memory" );
+    ImGui::SliderInt( "Classify Per Frame", &cacheParams.classifyPerFrame, 729, 1 << 20, "%d", ImGuiSliderFlags_Logarithmic );
+    ImGui::SliderInt( "Fill Per Frame", &cacheParams.fillPerFrame, 1, 4096, "%d", ImGuiSliderFlags_Logarithmic );
+    ImGui::SliderFloat( "Fallback", &cacheParams.fallbackEpsilons, 1.0f, 64.0f, "%.1f epsilon", ImGuiSliderFlags_Logarithmic );
+    if ( ImGui::Button( "Rebake" ) && cacheParams.enable )
+      cacheBakeStart();
+
+    const int brickTotal = cacheBrickCount.x * cacheBrickCount.y * cacheBrickCount.z;
+    if ( cacheParams.enable && brickTotal ) {
+      ImGui::Text( "%d x %d x %d bricks of %.3f cells", cacheBrickCount.x, cacheBrickCount.y, cacheBrickCount.z, cacheCell );
+      if ( cacheClassified < brickTotal || cacheCountFence ) {
+        ImGui::Text( "Classifying" );
+        ImGui::ProgressBar( float( cacheClassified ) / float( brickTotal ) );
+      } else {
+        ImGui::Text( "%d bricks near the surface, %.1f%% of the region", cacheAllocated, 100.0f * cacheAllocated / brickTotal );
+        if ( cacheBaking )
+          ImGui::ProgressBar( cacheAllocated ? float( cacheFilled ) / float( cacheAllocated ) : 0.0f );
+        else
+          ImGui::Text( "Baked in %.0f ms", cacheBakeMs );
+      }
+      if ( cacheFull )
+        ImGui::TextColored( ImVec4( 1.0f, 0.3f, 0.3f, 1.0f ), "Atlas full, the rest of the surface falls back to de()" );
+    }
+  }
+
+  if ( ImGui::CollapsingHeader( "VAT Terrain" ) ) {
+    bool placed = ImGui::Checkbox( "Show Terrain", &vatParams.enable );
+    ImGui::SliderInt( "Levels", &vatParams.levels, 1, 9 );
+    ImGui::SameLine();
+    HelpMarker( "2^levels + 1 cells on a side - memory and generation time grow eightfold per level" );
+    ImGui::InputText( "Rule", vatParams.rule, sizeof( vatParams.rule ) );
+    ImGui::SameLine();
+    HelpMarker( "r for a random rule, i for a random Ising rule, or a short rule string" );
+    ImGui::SliderFloat( "Flip", &vatParams.flip, 0.0f, 1.0f );
+    ImGui::SliderFloat( "Lambda", &vatParams.lambda, 0.0f, 1.0f );
+    ImGui::SliderFloat( "Beta", &vatParams.beta, 0.0f, 2.0f );
+    ImGui::SliderFloat( "Mag", &vatParams.mag, -2.0f, 2.0f );
+    const char *fills[] = { "Zeroes", "Ones", "Twos", "Random" };
+    ImGui::Combo( "Face Fill", &vatParams.initMode, fills, IM_ARRAYSIZE( fills ) );
+    ImGui::Checkbox( "-X", &vatParams.minimums.x ); ImGui::SameLine();
+    ImGui::Checkbox( "-Y", &vatParams.minimums.y ); ImGui::SameLine();
+    ImGui::Checkbox( "-Z", &vatParams.minimums.z ); ImGui::SameLine();
+    ImGui::Checkbox( "+X", &vatParams.maximums.x ); ImGui::SameLine();
+    ImGui::Checkbox( "+Y", &vatParams.maximums.y ); ImGui::SameLine();
+    ImGui::Checkbox( "+Z", &vatParams.maximums.z );
+    placed |= ImGui::DragFloat3( "Corner", &vatParams.position.x, 0.01f );
+    placed |= ImGui::DragFloat( "Extent", &vatParams.extent, 0.01f, 0.01f, 1000.0f );
+    placed |= ImGui::InputInt2( "Materials", &vatParams.materials.x );
+    const char *traversals[] = { "Distance Field", "64-Tree" };
+    placed |= ImGui::Combo( "Traversal", &vatParams.traversal, traversals, IM_ARRAYSIZE( traversals ) );
+    ImGui::SameLine();
+    HelpMarker( "Sphere trace the distance field, or cast rays through the sparse 64-tree, which skips empty space a block at a time and hits exact cell faces" );
+    if ( ImGui::Checkbox( "CPU Distance Field", &vatParams.cpuField ) ) {
+      vatFieldUpdate();
+      placed = true;
+    }
+    ImGui::SameLine();
+    HelpMarker( "Exact separable EDT on the CPU, instead of the jump flood on the GPU" );
+    if ( placed && !vatCells.empty() )
+      accumulationRestart();
+    if ( ImGui::Button( "Generate" ) ) {
+      vatGenerate();
+      vatParams.enable = true;
+    }
+    if ( vatSize ) {
+      ImGui::Text( "%d^3 cells, %zu solid, generated in %.0f ms, field in %.1f ms", vatSize, vatSolidCells, vatGenerateMs, vatFieldMs );
+      ImGui::Text( "64-tree %d deep, %zu kB for %zu kB of cells, built in %.1f ms", vatTreeDepth, vatTreeBytes / 1024, vatCells.size() / 1024, vatTreeMs );
+    }
+  }
+
+  if ( ImGui::CollapsingHeader( "Camera" ) ) {
+    ImGui::DragFloat3( "Position", &core.viewerPosition.x, 0.01f );
+    ImGui::SliderAngle( "Rotation X", &core.rotationAboutX );
+    ImGui::SliderAngle( "Rotation Y", &core.rotationAboutY );
+    ImGui::SliderAngle( "Rotation Z", &core.rotationAboutZ );
+    ImGui::SliderFloat( "FoV", &core.FoV, 0.01f, 1.0f );
+  }
+
+  if ( ImGui::CollapsingHeader( "Sampling" ) ) {
+    const char *samplers[] = { "Random", "Blue Noise", "Sobol", "Sobol, Blue Noise Ranked" };
+    ImGui::Combo( "Sampler", &core.sampler, samplers, IM_ARRAYSIZE( samplers ) );
+    ImGui::SameLine();
+    HelpMarker( "Owen scrambled Sobol converges per pixel, the ranked variant also spreads the error as blue noise across neighbouring pixels" );
+  }
+
+  if ( ImGui::CollapsingHeader( "Reprojection" ) ) {
+    ImGui::Checkbox( "Reproject History", &reprojectParams.enable );
+    ImGui::SameLine();
+    HelpMarker( "Carry accumulated samples through camera motion, instead of clearing" );
+    ImGui::SliderInt( "Max History", &reprojectParams.maxHistory, 1, 1024 );
+    ImGui::SliderFloat( "Depth Rejection", &reprojectParams.depthRejection, 0.001f, 1.0f );
+  }
+
+  if ( ImGui::CollapsingHeader( "Postprocess" ) ) {
+    const char *tonemapModes[] = { "None", "ACES", "AgX", "Reinhard" };
+    fullFrameDirty |= ImGui::Combo( "Tonemap", &post.tonemapMode, tonemapModes, IM_ARRAYSIZE( tonemapModes ) );
+    const char *ditherModes[] = { "None", "Per Channel", "Oklab Palette" };
+    fullFrameDirty |= ImGui::Combo( "Dither Mode", &post.ditherMode, ditherModes, IM_ARRAYSIZE( ditherModes ) );
+    const char *ditherMethods[] = { "Ordered", "Blue Noise", "Error Diffusion" };
+    fullFrameDirty |= ImGui::Combo( "Dither Method", &post.ditherMethod, ditherMethods, IM_ARRAYSIZE( ditherMethods ) );
+    const char *ditherPatterns[] = { "Bayer 2x2", "Bayer 4x4", "Bayer 8x8", "Bayer 16x16" };
+    fullFrameDirty |= ImGui::Combo( "Dither Pattern", &post.ditherPattern, ditherPatterns, IM_ARRAYSIZE( ditherPatterns ) );
+    fullFrameDirty |= ImGui::SliderInt( "Levels", &post.ditherLevels, 2, 256 );
+
+    // palette editing - the nearest pair LUT is rebaked on any change
+    bool paletteChanged = false;
+    for ( size_t i = 0; i < palette.size(); i++ ) {
+      ImGui::PushID( i );
+      paletteChanged |= ImGui::ColorEdit3( "", &palette[ i ].x, ImGuiColorEditFlags_NoInputs );
+      ImGui::PopID();
+      if ( ( i + 1 ) % 8 ) ImGui::SameLine();
+    }
+    if ( palette.size() < 256 && ImGui::Button( " + " ) ) {
+      palette.push_back( glm::vec3( 0.5 ) );
+      paletteChanged = true;
+    }
+    ImGui::SameLine();
+    if ( palette.size() > 1 && ImGui::Button( " - " ) ) {
+      palette.pop_back();
+      paletteChanged = true;
+    }
+    if ( paletteChanged ) {
+      paletteUpdate();
+      fullFrameDirty = true;
+    }
+  }
+
+  if ( ImGui::CollapsingHeader( "Denoiser" ) ) {
+    ImGui::Checkbox( "Enable", &denoiseParams.enable );
+    ImGui::SameLine();
+    HelpMarker( "The filter footprint crosses tile boundaries, so while enabled every frame is denoised and postprocessed in full" );
+    ImGui::SliderInt( "Passes", &denoiseParams.passes, 1, 8 );
+    ImGui::SliderFloat( "Strength", &denoiseParams.strength, 0.0f, 4.0f );
+    ImGui::SameLine();
+    HelpMarker( "Filter strength at one sample per pixel, falls off as samples accumulate" );
+    ImGui::SliderFloat( "Falloff", &denoiseParams.falloff, 1.0f, 256.0f, "%.1f spp" );
+    ImGui::SliderFloat( "Normal Sigma", &denoiseParams.sigmaNormal, 1.0f, 256.0f );
+    ImGui::SliderFloat( "Depth Sigma", &denoiseParams.sigmaDepth, 0.01f, 10.0f );
+    ImGui::SliderFloat( "Luminance Sigma", &denoiseParams.sigmaLuminance, 0.1f, 16.0f );
+  }
 
   ImGui::End();
 }
@@ -115,3 +430,68 @@ void engine::imguiFrameEnd() {
     SDL_GL_MakeCurrent( backup_current_window, backup_current_context );
   }
 }
+
+// one node of the scene tree, with its children nested below - edits go straight into scene.nodes
+bool engine::sceneNodeEditor( int index ) {
+  sdfNode &node = scene.nodes[ index ];
+  const sdfNodeType type = sdfNodeType( node.type );
+  bool edited = false;
+  ImGui::PushID( index );
+  if ( ImGui::TreeNode( "node", "%s", nodeInfo( type ).name ) ) {
+    edited |= ImGui::DragFloat3( "Position", &node.position.x, 0.01f );
+    glm::quat q( node.rotation.w, node.rotation.x, node.rotation.y, node.rotation.z );
+    glm::vec3 rotation = glm::degrees( glm::eulerAngles( q ) );
+    if ( ImGui::DragFloat3( "Rotation", &rotation.x, 0.5f ) ) {
+      q = glm::quat( glm::radians( rotation ) );
+      node.rotation = glm::vec4( q.x, q.y, q.z, q.w );
+      edited = true;
+    }
+    edited |= ImGui::DragFloat( "Scale", &node.scale, 0.01f, 0.01f, 100.0f );
+
+    switch ( type ) {
+      case sdfNodeType::sphere:
+        edited |= ImGui::DragFloat( "Radius", &node.params.x, 0.005f, 0.0f, 100.0f );
+        break;
+      case sdfNodeType::box:
+      case sdfNodeType::roundBox:
+        edited |= ImGui::DragFloat3( "Size", &node.params.x, 0.005f, 0.0f, 100.0f );
+        if ( type == sdfNodeType::roundBox ) edited |= ImGui::DragFloat( "Radius", &node.params.w, 0.001f, 0.0f, 100.0f );
+        break;
+      case sdfNodeType::torus:
+        edited |= ImGui::DragFloat( "Radius", &node.params.x, 0.005f, 0.0f, 100.0f );
+        edited |= ImGui::DragFloat( "Thickness", &node.params.y, 0.001f, 0.0f, 100.0f );
+        break;
+      case sdfNodeType::cylinder:
+      case sdfNodeType::capsule:
+        edited |= ImGui::DragFloat( "Radius", &node.params.x, 0.005f, 0.0f, 100.0f );
+        edited |= ImGui::DragFloat( "Height", &node.params.y, 0.005f, 0.0f, 100.0f );
+        break;
+      case sdfNodeType::smoothUnite:
+      case sdfNodeType::smoothIntersect:
+      case sdfNodeType::smoothSubtract:
+        edited |= ImGui::DragFloat( "Blend", &node.params.x, 0.001f, 0.0f, 10.0f );
+        break;
+      case sdfNodeType::repeat:
+        edited |= ImGui::DragFloat3( "Period", &node.params.x, 0.01f, 0.0f, 100.0f );
+        edited |= ImGui::DragFloat( "Count", &node.params.w, 0.1f, 0.0f, 1000.0f, "%.0f" );
+        node.params.w = std::floor( node.params.w );
+        break;
+      default:
+        break;
+    }
+
+    if ( isPrimitive( type ) ) {
+      auto name = []( void *names, int i, const char **out ) {
+        *out = ( *( std::vector< std::string > * ) names )[ i ].c_str();
+        return true;
+      };
+      edited |= ImGui::Combo( "Material", &node.material, name, &scene.materialNames, scene.materialNames.size() );
+    }
+
+    for ( uint32_t i = 0; i < node.childCount; i++ )
+      edited |= sceneNodeEditor( node.firstChild + i );
+    ImGui::TreePop();
+  }
+  ImGui::PopID();
+  return edited;
+}
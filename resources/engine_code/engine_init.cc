@@ -33,23 +33,25 @@ void engine::createWindowAndContext() {
   auto flags = SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN | SDL_WINDOW_RESIZABLE;
   window = SDL_CreateWindow( "NQADE", 0, 0, dm.w, dm.h, flags );
 
-  // if init takes some time, don't show the window before it's done
-  SDL_ShowWindow( window );
+  // if init takes some time, don't show the window before it's done - benchmark runs never show it
+  if ( launch.benchConfig.empty() )
+    SDL_ShowWindow( window );
 
   cout << T_GREEN << "done." << RESET << endl;
 
   cout << T_BLUE << "    Setting up OpenGL Context" << RESET << " ........................ ";
-  // initialize OpenGL 4.3 + GLSL version 430
+  // initialize OpenGL 4.5 + GLSL version 430 - 4.4+ needed for persistently mapped buffers
   SDL_GL_SetAttribute( SDL_GL_CONTEXT_FLAGS, 0 );
   SDL_GL_SetAttribute( SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE );
   SDL_GL_SetAttribute( SDL_GL_CONTEXT_MAJOR_VERSION, 4 );
-  SDL_GL_SetAttribute( SDL_GL_CONTEXT_MINOR_VERSION, 3 );
+  SDL_GL_SetAttribute( SDL_GL_CONTEXT_MINOR_VERSION, 5 );
   GLcontext = SDL_GL_CreateContext( window );
   SDL_GL_MakeCurrent( window, GLcontext );
-  SDL_GL_SetSwapInterval( 1 ); // Enable vsync
+  SDL_GL_SetSwapInterval( launch.benchConfig.empty() ? 1 : 0 ); // Enable vsync, except when benchmarking
 
   // load OpenGL functions
   if ( gl3wInit() != 0 ) cout << "Failed to initialize OpenGL loader!" << endl;
+  if ( !glExtensionsInit() ) cout << "OpenGL 4.5 functionality unavailable!" << endl;
 
   // basic OpenGL Config
   glEnable( GL_DEPTH_TEST );
@@ -61,6 +63,19 @@ void engine::createWindowAndContext() {
 }
 
 
+// immutable storage, zeroed on the GPU - nothing is staged or converted on the CPU side
+static GLuint createTexture( int unit, GLenum format, GLsizei width, GLsizei height, GLenum filter ) {
+  GLuint texture;
+  glGenTextures( 1, &texture );
+  glActiveTexture( GL_TEXTURE0 + unit );
+  glBindTexture( GL_TEXTURE_2D, texture );
+  glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter );
+  glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter );
+  glTexStorage2D( GL_TEXTURE_2D, 1, format, width, height );
+  glClearTexImage( texture, 0, GL_RGBA, GL_FLOAT, NULL ); // null data clears to zero
+  return texture;
+}
+
 void engine::displaySetup() {
   // some info on your current platform
   const GLubyte *renderer = glGetString( GL_RENDERER ); // get renderer string
@@ -76,52 +91,182 @@ void engine::displaySetup() {
   // have to have dummy call to this - core requires a VAO bound when calling glDrawArrays, otherwise it complains
   glGenVertexArrays( 1, &displayVAO );
 
-  // replace this with real image data
-  std::vector< uint8_t > imageData;
-  imageData.resize( WIDTH * HEIGHT * 4 );
-
   cout << T_BLUE << "    Setting up Textures" << RESET << " .............................. ";
 
-  // fill with random values
-  std::default_random_engine gen;
-  std::uniform_int_distribution< uint8_t > dist( 150, 255 );
-
-  for ( auto it = imageData.begin(); it != imageData.end(); it++ )
-    *it = dist( gen );
-
   // image setup on the GPU - output texture is the only one where filtering is relevant
-  glGenTextures( 1, &displayTexture );
-  glActiveTexture( GL_TEXTURE0 );
-  glBindTexture( GL_TEXTURE_2D, displayTexture );
-  glTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter ? GL_LINEAR : GL_NEAREST );
-  glTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter ? GL_LINEAR : GL_NEAREST );
-  glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA8, WIDTH, HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, &imageData[ 0 ] );
-  glBindImageTexture( 0, displayTexture, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA8UI );
-
-  // pathtrace accumulator
-  glGenTextures( 1, &accumulatorTexture );
-  glActiveTexture( GL_TEXTURE0 + 1 );
-  glBindTexture( GL_TEXTURE_2D, accumulatorTexture );
-  glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA32F, WIDTH, HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, &imageData[ 0 ] );
+  GLenum filterMode = filter ? GL_LINEAR : GL_NEAREST;
+  displayTexture = createTexture( 0, GL_RGBA8, WIDTH, HEIGHT, filterMode );
+  glBindImageTexture( 0, displayTexture, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA8 );
+
+  // pathtrace accumulator - sampled by the fused present
+  accumulatorTexture = createTexture( 1, GL_RGBA32F, WIDTH, HEIGHT, filterMode );
   glBindImageTexture( 1, accumulatorTexture, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F );
 
-  // blue noise texture
-  unsigned lWidth, lHeight, lError;
-  std::vector< unsigned char > lImage;
-  lError = lodepng::decode( lImage, lWidth, lHeight, "resources/blueNoise.png" );
-  if( lError )
-    cout << "Blue noise - decoder error " << lError << ": " << lodepng_error_text( lError ) << endl;
+  // normals + depth, from the primary ray hits
+  normalDepthTexture = createTexture( 4, GL_RGBA32F, WIDTH, HEIGHT, GL_NEAREST );
+  glBindImageTexture( 4, normalDepthTexture, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F );
+
+  // first and second luminance moments, for the denoiser variance estimate
+  momentsTexture = createTexture( 5, GL_RG32F, WIDTH, HEIGHT, GL_NEAREST );
+  glBindImageTexture( 5, momentsTexture, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RG32F );
+
+  // denoiser ping-pong buffers - bound to units 6 and 7 per pass
+  for ( int i = 0; i < 2; i++ ) {
+    denoiseTextures[ i ] = createTexture( 6 + i, GL_RGBA32F, WIDTH, HEIGHT, filterMode );
+    glBindImageTexture( 6 + i, denoiseTextures[ i ], 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F );
+  }
+
+  // history copies for reprojection - only ever sampled, so they're on texture units 8, 9, 10
+  accumulatorHistoryTexture = createTexture( 8, GL_RGBA32F, WIDTH, HEIGHT, GL_NEAREST );
+  normalDepthHistoryTexture = createTexture( 9, GL_RGBA32F, WIDTH, HEIGHT, GL_NEAREST );
+  momentsHistoryTexture = createTexture( 10, GL_RG32F, WIDTH, HEIGHT, GL_NEAREST );
+
+  // per pixel depth keys and claims for resolving reprojection conflicts
+  glGenBuffers( 1, &reprojectDepthBuffer );
+  glBindBuffer( GL_SHADER_STORAGE_BUFFER, reprojectDepthBuffer );
+  glBufferData( GL_SHADER_STORAGE_BUFFER, 2 * sizeof( GLuint ) * WIDTH * HEIGHT, NULL, GL_DYNAMIC_COPY );
+  glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 0, reprojectDepthBuffer );
+
+  // dirty tile list for postprocess - indirect dispatch args, then one offset per tile
+  int maxTiles = std::ceil( WIDTH / float( TILESIZE ) ) * std::ceil( HEIGHT / float( TILESIZE ) );
+  glGenBuffers( 1, &dirtyTileBuffer );
+  glBindBuffer( GL_SHADER_STORAGE_BUFFER, dirtyTileBuffer );
+  glBufferData( GL_SHADER_STORAGE_BUFFER, 4 * sizeof( GLuint ) + maxTiles * sizeof( glm::ivec2 ), NULL, GL_DYNAMIC_DRAW );
+  glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 1, dirtyTileBuffer );
+
+  // single tile staging for distributed rendering - worker readback, coordinator merge input
+  GLenum tileFormats[ 3 ] = { GL_RGBA32F, GL_RGBA32F, GL_RG32F };
+  for ( int i = 0; i < 3; i++ )
+    tileResultTextures[ i ] = createTexture( 15 + i, tileFormats[ i ], TILESIZE, TILESIZE, GL_NEAREST );
+
+  // timestamps for the pathtrace time budget, reused every frame
+  glGenQueries( 2, pathtraceQueries );
+
+  // path tracer counters, and two frames' worth of mapped readback
+  glGenBuffers( 1, &statsBuffer );
+  glBindBuffer( GL_SHADER_STORAGE_BUFFER, statsBuffer );
+  glBufferData( GL_SHADER_STORAGE_BUFFER, statsCount * sizeof( GLuint ), NULL, GL_DYNAMIC_COPY );
+  glClearBufferSubData( GL_SHADER_STORAGE_BUFFER, GL_R32UI, 0, statsCount * sizeof( GLuint ), GL_RED_INTEGER, GL_UNSIGNED_INT, NULL );
+  glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 2, statsBuffer );
+
+  // scene bytecode for the interpreter, the BVH over the scene's objects and their ranges of the
+  // bytecode, see sdf_compiler.h - sized on upload
+  glGenBuffers( 1, &sdfProgramBuffer );
+  glBindBuffer( GL_SHADER_STORAGE_BUFFER, sdfProgramBuffer );
+  glBufferData( GL_SHADER_STORAGE_BUFFER, sizeof( sdfInstruction ), NULL, GL_DYNAMIC_DRAW );
+  glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 3, sdfProgramBuffer );
+  glGenBuffers( 1, &sdfBVHBuffer );
+  glBindBuffer( GL_SHADER_STORAGE_BUFFER, sdfBVHBuffer );
+  glBufferData( GL_SHADER_STORAGE_BUFFER, sizeof( sdfBVHNode ), NULL, GL_DYNAMIC_DRAW );
+  glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 4, sdfBVHBuffer );
+  glGenBuffers( 1, &sdfObjectBuffer );
+  glBindBuffer( GL_SHADER_STORAGE_BUFFER, sdfObjectBuffer );
+  glBufferData( GL_SHADER_STORAGE_BUFFER, sizeof( sdfObjectRange ), NULL, GL_DYNAMIC_DRAW );
+  glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 5, sdfObjectBuffer );
+  glGenBuffers( 1, &statsReadback );
+  glBindBuffer( GL_COPY_WRITE_BUFFER, statsReadback );
+  glBufferStorage( GL_COPY_WRITE_BUFFER, 2 * statsCount * sizeof( GLuint ), NULL, GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT );
+  statsMapping = ( const uint32_t * ) glMapBufferRange( GL_COPY_WRITE_BUFFER, 0, 2 * statsCount * sizeof( GLuint ), GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT );
+  glBindBuffer( GL_COPY_WRITE_BUFFER, 0 );
+
+  // screenshot readback target, mapped for the lifetime of the program
+  GLsizeiptr screenshotSize = WIDTH * HEIGHT * 4;
+  glGenBuffers( 1, &screenshotBuffer );
+  glBindBuffer( GL_PIXEL_PACK_BUFFER, screenshotBuffer );
+  glBufferStorage( GL_PIXEL_PACK_BUFFER, screenshotSize, NULL, GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT );
+  screenshotMapping = glMapBufferRange( GL_PIXEL_PACK_BUFFER, 0, screenshotSize, GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT );
+  glBindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
+
+  // accumulator export readback target, RGBA32F
+  GLsizeiptr exportSize = WIDTH * HEIGHT * 4 * sizeof( float );
+  glGenBuffers( 1, &exportBuffer );
+  glBindBuffer( GL_PIXEL_PACK_BUFFER, exportBuffer );
+  glBufferStorage( GL_PIXEL_PACK_BUFFER, exportSize, NULL, GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT );
+  exportMapping = ( const float * ) glMapBufferRange( GL_PIXEL_PACK_BUFFER, 0, exportSize, GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT );
+  glBindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
+
+  // blue noise bank, baked by blueNoiseBake - mapped, and uploaded straight out of the mapping
+  blueNoiseBank bank;
+  bool bankLoaded = bank.open( "resources/blueNoise.bank" );
+  if ( !bankLoaded )
+    cout << T_RED << "Blue noise - " << bank.error << ", run blueNoiseBake" << RESET << " ..... ";
+  blueNoiseSize = bankLoaded ? glm::ivec2( bank.header.width, bank.header.height ) : glm::ivec2( 128 );
+  blueNoiseSlices = bankLoaded ? bank.header.slices : 1;
 
   glGenTextures( 1, &blueNoiseTexture );
   glActiveTexture( GL_TEXTURE0 + 2 );
-  glBindTexture( GL_TEXTURE_2D, blueNoiseTexture );
-  glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA8, lWidth, lHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, &lImage[ 0 ] );
-  glBindImageTexture( 2, blueNoiseTexture, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA8UI );
+  glBindTexture( GL_TEXTURE_2D_ARRAY, blueNoiseTexture );
+  glTexStorage3D( GL_TEXTURE_2D_ARRAY, 1, GL_RGBA8UI, blueNoiseSize.x, blueNoiseSize.y, blueNoiseSlices );
+  if ( bankLoaded ) {
+    glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
+    glTexSubImage3D( GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0, blueNoiseSize.x, blueNoiseSize.y, blueNoiseSlices, GL_RGBA_INTEGER, GL_UNSIGNED_BYTE, bank.data );
+    glPixelStorei( GL_UNPACK_ALIGNMENT, 4 );
+  } else { // zero noise still renders, just with plain stratified jitter
+    glClearTexImage( blueNoiseTexture, 0, GL_RGBA_INTEGER, GL_UNSIGNED_BYTE, NULL );
+  }
+  glBindImageTexture( 2, blueNoiseTexture, 0, GL_TRUE, 0, GL_READ_ONLY, GL_RGBA8UI ); // layered, shaders pick the slice
 
   cout << T_GREEN << "done." << RESET << endl;
 }
 
 
+void engine::lutSetup() {
+  cout << T_BLUE << "    Baking Postprocess LUTs" << RESET << " .......................... ";
+
+  // tonemap curves, one row per operator, linear filtering along the curve
+  std::vector< float > tonemapData = bakeTonemapLUT();
+  glGenTextures( 1, &tonemapLUTTexture );
+  glActiveTexture( GL_TEXTURE0 + 11 );
+  glBindTexture( GL_TEXTURE_2D, tonemapLUTTexture );
+  glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+  glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+  glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+  glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+  glTexStorage2D( GL_TEXTURE_2D, 1, GL_R32F, tonemapLUTSize, tonemapCurveCount );
+  glTexSubImage2D( GL_TEXTURE_2D, 0, 0, 0, tonemapLUTSize, tonemapCurveCount, GL_RED, GL_FLOAT, &tonemapData[ 0 ] );
+
+  // default palette is PICO-8
+  palette = {
+    { 0.000, 0.000, 0.000 }, { 0.114, 0.169, 0.325 }, { 0.494, 0.145, 0.325 }, { 0.000, 0.529, 0.318 },
+    { 0.671, 0.322, 0.212 }, { 0.373, 0.341, 0.310 }, { 0.761, 0.765, 0.780 }, { 1.000, 0.945, 0.910 },
+    { 1.000, 0.000, 0.302 }, { 1.000, 0.639, 0.000 }, { 1.000, 0.925, 0.153 }, { 0.000, 0.894, 0.212 },
+    { 0.161, 0.678, 1.000 }, { 0.514, 0.463, 0.612 }, { 1.000, 0.467, 0.659 }, { 1.000, 0.800, 0.667 } };
+
+  // nearest pair LUT is a fixed size, only its contents change with the palette
+  glGenTextures( 1, &paletteLUTTexture );
+  glActiveTexture( GL_TEXTURE0 + 12 );
+  glBindTexture( GL_TEXTURE_3D, paletteLUTTexture );
+  glTexParameteri( GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+  glTexParameteri( GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+  glTexStorage3D( GL_TEXTURE_3D, 1, GL_RGBA8UI, paletteLUTSize, paletteLUTSize, paletteLUTSize );
+
+  glGenTextures( 1, &paletteTexture );
+  paletteUpdate();
+
+  cout << T_GREEN << "done." << RESET << endl;
+}
+
+// rebake the nearest pair LUT + upload the palette, call after any change to palette
+void engine::paletteUpdate() {
+  std::vector< uint8_t > lutData = bakePaletteLUT( palette );
+  glActiveTexture( GL_TEXTURE0 + 12 );
+  glBindTexture( GL_TEXTURE_3D, paletteLUTTexture );
+  glTexSubImage3D( GL_TEXTURE_3D, 0, 0, 0, 0, paletteLUTSize, paletteLUTSize, paletteLUTSize, GL_RGBA_INTEGER, GL_UNSIGNED_BYTE, &lutData[ 0 ] );
+
+  // Oklab in the first row, sRGB in the second
+  std::vector< glm::vec4 > paletteData( palette.size() * 2 );
+  for ( size_t i = 0; i < palette.size(); i++ ) {
+    paletteData[ i ] = glm::vec4( linearSRGBToOklab( sRGBToLinear( palette[ i ] ) ), 1. );
+    paletteData[ i + palette.size() ] = glm::vec4( palette[ i ], 1. );
+  }
+  glActiveTexture( GL_TEXTURE0 + 13 );
+  glBindTexture( GL_TEXTURE_2D, paletteTexture );
+  glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+  glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+  glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA32F, palette.size(), 2, 0, GL_RGBA, GL_FLOAT, &paletteData[ 0 ] );
+}
+
+
 void engine::imguiSetup() {
   cout << T_BLUE << "    Configuring dearImGUI" << RESET << " ............................ ";
 
@@ -221,8 +366,14 @@ void engine::computeShaderCompile() {
   cout << T_BLUE << "    Compiling Compute Shaders" << RESET << " ........................ ";
 
   raymarchShader    = CShader( "resources/engine_code/shaders/raymarch.cs.glsl" ).Program;
-  pathtraceShader   = CShader( "resources/engine_code/shaders/pathtrace.cs.glsl" ).Program;
+  pathtraceShader   = pathtraceGeneratedShader = CShader( "resources/engine_code/shaders/pathtrace.cs.glsl" ).Program;
+  pathtraceInterpretedShader = CShader( "resources/engine_code/shaders/pathtrace.cs.glsl", false,
+    { { "scene_de.glsl", "#include \"sdf_interpreter.glsl\"" } } ).Program;
+  reprojectShader   = CShader( "resources/engine_code/shaders/reproject.cs.glsl" ).Program;
+  denoiseShader     = CShader( "resources/engine_code/shaders/denoise.cs.glsl" ).Program;
   postprocessShader = CShader( "resources/engine_code/shaders/postprocess.cs.glsl" ).Program;
+  mergeShader       = CShader( "resources/engine_code/shaders/merge.cs.glsl" ).Program;
+  vatJFAShader      = CShader( "resources/engine_code/shaders/vat_jfa.cs.glsl" ).Program;
 
   cout << T_GREEN << "done." << RESET << endl;
 }
@@ -0,0 +1,129 @@
+#include "engine.h"
+
+// scene files, see scene.h - the settings replace the current ones, the SDF content is kept in scene
+bool engine::sceneFileLoad( const std::string &filename ) {
+  cout << T_BLUE << "    Loading Scene" << RESET << " .................................... ";
+  auto start = std::chrono::steady_clock::now();
+  if ( !scene.load( filename ) ) {
+    cout << T_RED << "failed, " << scene.errors.size() << " problems:" << RESET << endl;
+    for ( auto &e : scene.errors )
+      cout << T_RED << "      " << e << RESET << endl;
+    return false;
+  }
+  sceneLoadMs = std::chrono::duration< float, std::milli >( std::chrono::steady_clock::now() - start ).count();
+
+  core = scene.core;
+  lens = scene.lens;
+  post = scene.post;
+
+  // a new scene, nothing to reproject
+  updateBasis();
+  previousCore = core;
+  previousLens = lens;
+
+  cout << T_GREEN << "done." << RESET << " " << scene.nodes.size() << " nodes, " << scene.materials.size() << " materials, "
+       << scene.assets.size() << " assets, " << ( scene.fromCache ? "from cache" : "parsed" ) << " in " << sceneLoadMs << "ms" << endl;
+
+  sceneEdited();
+  return true;
+}
+
+// settling is for edits that come every frame while a control is dragged
+void engine::sceneEdited( bool settling ) {
+  sceneCompiler.compile( scene );
+  auto upload = []( GLuint buffer, const auto &data ) { // never zero sized, the shaders declare them either way
+    glBindBuffer( GL_SHADER_STORAGE_BUFFER, buffer );
+    glBufferData( GL_SHADER_STORAGE_BUFFER, std::max< size_t >( data.size(), 1 ) * sizeof( data[ 0 ] ), data.data(), GL_DYNAMIC_DRAW );
+  };
+  upload( sdfProgramBuffer, sceneCompiler.program );
+  upload( sdfBVHBuffer, sceneCompiler.bvh );
+  upload( sdfObjectBuffer, sceneCompiler.objectRanges );
+
+  // nothing accumulated so far shows the scene as it is now, here or on the workers - while a control is
+  // dragged, the workers get the scene once it settles rather than every frame
+  accumulationRestart();
+  if ( distributedRole == distributedMode::coordinator ) {
+    if ( settling )
+      coordinatorHold();
+    else
+      coordinatorRestart();
+  }
+
+  sceneEditTime = std::chrono::steady_clock::now();
+  sceneGeneratedCurrent = false;
+  sceneEvaluatorSelect( settling );
+  cacheInvalidate();
+}
+
+void engine::sceneUniforms( GLuint shader ) {
+  glUniform1i( glGetUniformLocation( shader, "sdfProgramLength" ), sceneCompiler.rootLength );
+  glUniform1i( glGetUniformLocation( shader, "sdfBVHNodeCount" ), sceneCompiler.bvh.size() );
+  glUniform1f( glGetUniformLocation( shader, "sdfBoundsMargin" ), sceneCompiler.boundsMargin );
+}
+
+// programs too deep for the interpreter's stacks only run as generated GLSL, and automatic goes
+// straight there when that's already built for the current nodes. While edits are settling, a rebuild
+// waits for scenePromotionDelay without one, the same as automatic's promotion, with the interpreter
+// standing in when the program fits it
+void engine::sceneEvaluatorSelect( bool settling ) {
+  const sceneEvaluatorMode evaluator = sceneEvaluatorMode( sceneEvaluator );
+  if ( evaluator == sceneEvaluatorMode::generated || !sceneCompiler.programFits ||
+      ( evaluator == sceneEvaluatorMode::automatic && sceneGeneratedCurrent ) ) {
+    if ( !sceneGeneratedCurrent && settling ) {
+      scenePromotionPending = true;
+      if ( sceneCompiler.programFits ) {
+        pathtraceShader = pathtraceInterpretedShader;
+        sceneInterpreted = true;
+      }
+      return;
+    }
+    if ( !sceneGeneratedCurrent ) sceneShaderCompile();
+    pathtraceShader = pathtraceGeneratedShader;
+    sceneInterpreted = false;
+    scenePromotionPending = false;
+    return;
+  }
+  pathtraceShader = pathtraceInterpretedShader;
+  sceneInterpreted = true;
+  scenePromotionPending = evaluator == sceneEvaluatorMode::automatic;
+}
+
+void engine::sceneEvaluatorUpdate() {
+  if ( std::chrono::duration< float >( std::chrono::steady_clock::now() - sceneEditTime ).count() < scenePromotionDelay )
+    return;
+  bool restart = coordinatorHeld;
+  if ( scenePromotionPending ) {
+    const bool stale = !sceneInterpreted; // too deep to interpret, the old generated GLSL ran meanwhile
+    sceneShaderCompile();
+    if ( stale ) {
+      accumulationRestart();
+      restart = true;
+    }
+  }
+  if ( restart && distributedRole == distributedMode::coordinator )
+    coordinatorRestart();
+}
+
+// the node tree becomes the path tracer's de(), standing in for shaders/scene_de.glsl - the compile
+// blocks for as long as the driver takes on it, which grows with the scene
+void engine::sceneShaderCompile() {
+  const bool bakeHeld = scenePromotionPending && !sceneInterpreted; // see cacheBakeUpdate()
+  cout << T_BLUE << "    Compiling Scene SDF" << RESET << " .............................. ";
+  auto start = std::chrono::steady_clock::now();
+  glDeleteProgram( pathtraceGeneratedShader );
+  pathtraceGeneratedShader = CShader( "resources/engine_code/shaders/pathtrace.cs.glsl", false, { { "scene_de.glsl", sceneCompiler.code } } ).Program;
+  pathtraceShader = pathtraceGeneratedShader;
+  sceneInterpreted = false;
+  sceneGeneratedCurrent = true;
+  scenePromotionPending = false;
+  sceneShaderMs = std::chrono::duration< float, std::milli >( std::chrono::steady_clock::now() - start ).count();
+
+  const sdfCompileStats &s = sceneCompiler.stats;
+  cout << T_GREEN << "done." << RESET << " " << s.primitives << " primitives, " << s.operations << " operations, " << s.boundsChecks
+       << " bounds checks, " << s.nodesRemoved << " nodes simplified away, " << s.lines << " lines in " << sceneShaderMs << "ms" << endl;
+  if ( s.bvhNodes )
+    cout << "      BVH over " << s.bvhObjects << " objects, " << s.bvhNodes << " nodes, " << s.bvhDepth << " deep" << endl;
+
+  if ( bakeHeld )
+    cacheInvalidate();
+}
@@ -1,16 +1,49 @@
 #include "engine.h"
 
+// position of a tile in the row major dirty flags
+static int tileIndex( glm::ivec2 tile ) {
+  return ( tile.y / TILESIZE ) * int( std::ceil( WIDTH / float( TILESIZE ) ) ) + tile.x / TILESIZE;
+}
+
+// timestamped output path, making sure the directory exists
+static std::string timestampedFilename( std::string directory, std::string prefix ) {
+  auto now = std::time( nullptr );
+  std::stringstream filename;
+  filename << directory << "/" << prefix << "-" << std::put_time( std::localtime( &now ), "%Y-%m-%d-%H-%M-%S" );
+  std::filesystem::create_directories( directory );
+  return filename.str();
+}
+
 bool engine::mainLoop() {
-  // renderer config
-  static coreParameters core;
-  static lensParameters lens;
-  static postParameters post;
-
-  render();                     // render with the current mode
-  postprocess();                // accumulatorTexture -> displayTexture
-  mainDisplayBlit();            // fullscreen triangle copying the image
-  imguiPass();                  // do all the GUI stuff
-  SDL_GL_SwapWindow( window );  // swap the double buffers to present
+  profile.frameBegin();         // close out timing for the last frame
+  {
+    auto t = profile.time( "Render" );
+    render();                   // render with the current mode
+  }
+  statsUpdate();                // path tracer counters, read back a frame late
+  {
+    auto t = profile.time( "Denoise" );
+    denoise();                  // filter the accumulator, for low sample counts
+  }
+  if ( !fusedPresent() ) {
+    auto t = profile.time( "Postprocess" );
+    postprocess();              // accumulatorTexture -> displayTexture, only when the blit can't do it
+  }
+  {
+    auto t = profile.time( "Blit" );
+    mainDisplayBlit();          // fullscreen triangle presenting the image
+  }
+  screenShotUpdate();           // pass finished readbacks to the writer
+  accumulatorExportUpdate();
+  checkpointUpdate();           // periodic checkpoints of the progressive render
+  {
+    auto t = profile.time( "ImGui" );
+    imguiPass();                // do all the GUI stuff
+  }
+  {
+    auto t = profile.time( "Swap", false ); // GPU side would just measure the wait for vsync
+    SDL_GL_SwapWindow( window );  // swap the double buffers to present
+  }
   handleEvents();               // handle input events
 
   return !pQuit;                // break loop in main.cc when pQuit turns true
@@ -18,39 +51,170 @@ bool engine::mainLoop() {
 
 
 void engine::render() {
+  sceneEvaluatorUpdate();
+  cacheBakeUpdate();
+
+  // history no longer lines up with the view if the camera moved, and can't be kept at all when the
+  // samples would come out differently
+  updateBasis();
+  if ( renderSettingsChanged() || cameraMoved() ) {
+    if ( renderSettingsChanged() )
+      accumulationRestart();
+    else
+      reproject();
+    previousCore = core;
+    previousLens = lens;
+    fullFrameDirty = true;
+    if ( distributedRole == distributedMode::coordinator )
+      coordinatorRestart(); // outstanding work is for the old view
+  }
+
   // different rendering modes - preview until pathtrace is triggered
   switch ( mode ) {
-    case renderMode::preview:   raymarch();  break;
-    case renderMode::pathtrace: pathtrace(); break;
+    case renderMode::preview: raymarch(); break;
+    case renderMode::pathtrace:
+      // distributed roles replace the local tile loop
+      switch ( distributedRole ) {
+        case distributedMode::none:        pathtrace();         break;
+        case distributedMode::coordinator: coordinatorUpdate(); break;
+        case distributedMode::worker:      workerUpdate();      break;
+      }
+      break;
     default: break;
   }
 }
 
+// the accumulated image no longer shows what's being rendered
+void engine::accumulationRestart() {
+  fullFrameDirty = true;
+  glClearTexImage( accumulatorTexture, 0, GL_RGBA, GL_FLOAT, NULL );
+  glClearTexImage( normalDepthTexture, 0, GL_RGBA, GL_FLOAT, NULL );
+  glClearTexImage( momentsTexture, 0, GL_RGBA, GL_FLOAT, NULL );
+}
+
+void engine::updateBasis() {
+  glm::mat4 rotation = glm::rotate( core.rotationAboutZ, glm::vec3( 0., 0., 1. ) )
+                     * glm::rotate( core.rotationAboutY, glm::vec3( 0., 1., 0. ) )
+                     * glm::rotate( core.rotationAboutX, glm::vec3( 1., 0., 0. ) );
+  core.basisX = glm::vec3( rotation * glm::vec4( 1., 0., 0., 0. ) );
+  core.basisY = glm::vec3( rotation * glm::vec4( 0., 1., 0., 0. ) );
+  core.basisZ = glm::vec3( rotation * glm::vec4( 0., 0., 1., 0. ) );
+}
+
+bool engine::cameraMoved() {
+  return core.viewerPosition != previousCore.viewerPosition
+      || core.basisX != previousCore.basisX
+      || core.basisY != previousCore.basisY
+      || core.basisZ != previousCore.basisZ
+      || core.FoV != previousCore.FoV;
+}
+
+bool engine::renderSettingsChanged() {
+  return core.maxSteps != previousCore.maxSteps
+      || core.maxBounces != previousCore.maxBounces
+      || core.maxDistance != previousCore.maxDistance
+      || core.epsilon != previousCore.epsilon
+      || core.exposure != previousCore.exposure
+      || core.focusDistance != previousCore.focusDistance
+      || core.normalMethod != previousCore.normalMethod
+      || core.sampler != previousCore.sampler
+      || core.basicDiffuse != previousCore.basicDiffuse
+      || std::memcmp( &lens, &previousLens, sizeof( lens ) ) != 0;
+}
+
+void engine::reproject() {
+  glUseProgram( reprojectShader );
+
+  // snapshot the current buffers - make sure prior shader writes have landed first
+  glMemoryBarrier( GL_TEXTURE_UPDATE_BARRIER_BIT );
+  glCopyImageSubData( accumulatorTexture, GL_TEXTURE_2D, 0, 0, 0, 0, accumulatorHistoryTexture, GL_TEXTURE_2D, 0, 0, 0, 0, WIDTH, HEIGHT, 1 );
+  glCopyImageSubData( normalDepthTexture, GL_TEXTURE_2D, 0, 0, 0, 0, normalDepthHistoryTexture, GL_TEXTURE_2D, 0, 0, 0, 0, WIDTH, HEIGHT, 1 );
+  glCopyImageSubData( momentsTexture, GL_TEXTURE_2D, 0, 0, 0, 0, momentsHistoryTexture, GL_TEXTURE_2D, 0, 0, 0, 0, WIDTH, HEIGHT, 1 );
+
+  // camera before and after the move
+  glUniform1f( glGetUniformLocation( reprojectShader, "FoV" ), core.FoV );
+  glUniform3fv( glGetUniformLocation( reprojectShader, "viewerPosition" ), 1, glm::value_ptr( core.viewerPosition ) );
+  glUniform3fv( glGetUniformLocation( reprojectShader, "basisX" ), 1, glm::value_ptr( core.basisX ) );
+  glUniform3fv( glGetUniformLocation( reprojectShader, "basisY" ), 1, glm::value_ptr( core.basisY ) );
+  glUniform3fv( glGetUniformLocation( reprojectShader, "basisZ" ), 1, glm::value_ptr( core.basisZ ) );
+  glUniform1f( glGetUniformLocation( reprojectShader, "previousFoV" ), previousCore.FoV );
+  glUniform3fv( glGetUniformLocation( reprojectShader, "previousViewerPosition" ), 1, glm::value_ptr( previousCore.viewerPosition ) );
+  glUniform3fv( glGetUniformLocation( reprojectShader, "previousBasisX" ), 1, glm::value_ptr( previousCore.basisX ) );
+  glUniform3fv( glGetUniformLocation( reprojectShader, "previousBasisY" ), 1, glm::value_ptr( previousCore.basisY ) );
+  glUniform3fv( glGetUniformLocation( reprojectShader, "previousBasisZ" ), 1, glm::value_ptr( previousCore.basisZ ) );
+  glUniform1i( glGetUniformLocation( reprojectShader, "maxHistory" ), reprojectParams.maxHistory );
+  glUniform1f( glGetUniformLocation( reprojectShader, "depthRejection" ), reprojectParams.depthRejection );
+  glUniform1f( glGetUniformLocation( reprojectShader, "maxDistance" ), core.maxDistance );
+
+  // clear, scatter, resolve, reject - with reprojection off, only the clear runs
+  int passes = reprojectParams.enable ? 4 : 1;
+  for ( int pass = 0; pass < passes; pass++ ) {
+    glUniform1i( glGetUniformLocation( reprojectShader, "reprojectPass" ), pass );
+    glDispatchCompute( std::ceil( WIDTH / 32. ), std::ceil( HEIGHT / 32. ), 1 );
+    glMemoryBarrier( GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT );
+  }
+}
+
 void engine::raymarch() {
   glUseProgram( raymarchShader );
   // do a fullscreen pass with simple shading
 }
 
-void engine::pathtrace() {
+// camera + render settings, constant across the tiles
+void engine::pathtraceUniforms() {
   glUseProgram( pathtraceShader );
+  glUniform1i( glGetUniformLocation( pathtraceShader, "maxSteps" ), core.maxSteps );
+  glUniform1i( glGetUniformLocation( pathtraceShader, "maxBounces" ), core.maxBounces );
+  glUniform1f( glGetUniformLocation( pathtraceShader, "maxDistance" ), core.maxDistance );
+  glUniform1f( glGetUniformLocation( pathtraceShader, "epsilon" ), core.epsilon );
+  glUniform1i( glGetUniformLocation( pathtraceShader, "normalMethod" ), core.normalMethod );
+  glUniform1i( glGetUniformLocation( pathtraceShader, "samplerMode" ), core.sampler );
+  glUniform1ui( glGetUniformLocation( pathtraceShader, "sampleIndexBase" ), launch.seed * seedStride );
+  glUniform1ui( glGetUniformLocation( pathtraceShader, "renderSeed" ), launch.seed );
+  glUniform1f( glGetUniformLocation( pathtraceShader, "focusDistance" ), core.focusDistance );
+  glUniform1f( glGetUniformLocation( pathtraceShader, "FoV" ), core.FoV );
+  glUniform1f( glGetUniformLocation( pathtraceShader, "exposure" ), core.exposure );
+  glUniform3fv( glGetUniformLocation( pathtraceShader, "viewerPosition" ), 1, glm::value_ptr( core.viewerPosition ) );
+  glUniform3fv( glGetUniformLocation( pathtraceShader, "basisX" ), 1, glm::value_ptr( core.basisX ) );
+  glUniform3fv( glGetUniformLocation( pathtraceShader, "basisY" ), 1, glm::value_ptr( core.basisY ) );
+  glUniform3fv( glGetUniformLocation( pathtraceShader, "basisZ" ), 1, glm::value_ptr( core.basisZ ) );
+  glUniform3fv( glGetUniformLocation( pathtraceShader, "basicDiffuse" ), 1, glm::value_ptr( core.basicDiffuse ) );
+  glUniform1i( glGetUniformLocation( pathtraceShader, "collectStats" ), collectStats );
+  sceneUniforms( pathtraceShader );
+  cacheUniforms( pathtraceShader );
+  vatUniforms( pathtraceShader );
+}
+
+// blue noise for one sample index - each index gets its own slice, and once the slices run out, the
+// stack is reread at a new toroidal offset ( R2 sequence ) so the repeats don't line up
+void engine::noiseUniforms( uint32_t sampleIndex ) {
+  uint32_t cycle = sampleIndex / blueNoiseSlices;
+  core.noiseOffset = glm::ivec2( glm::fract( float( cycle ) * glm::vec2( 0.7548776662f, 0.5698402910f ) ) * glm::vec2( blueNoiseSize ) );
+  glUniform1i( glGetUniformLocation( pathtraceShader, "noiseSlice" ), sampleIndex % blueNoiseSlices );
+  glUniform2i( glGetUniformLocation( pathtraceShader, "noiseOffset" ), core.noiseOffset.x, core.noiseOffset.y );
+}
+
+void engine::pathtrace() {
+  pathtraceUniforms();
 
   GLuint64 startTime, checkTime;
-  GLuint queryID[ 2 ];
-  glGenQueries( 2, queryID );
-  glQueryCounter( queryID[ 0 ], GL_TIMESTAMP );
+  glQueryCounter( pathtraceQueries[ 0 ], GL_TIMESTAMP );
 
   // get startTime
   GLint startTimeAvailable = 0;
   while( !startTimeAvailable )
-    glGetQueryObjectiv( queryID[ 0 ], GL_QUERY_RESULT_AVAILABLE, &startTimeAvailable );
-  glGetQueryObjectui64v( queryID[ 0 ], GL_QUERY_RESULT, &startTime );
+    glGetQueryObjectiv( pathtraceQueries[ 0 ], GL_QUERY_RESULT_AVAILABLE, &startTimeAvailable );
+  glGetQueryObjectui64v( pathtraceQueries[ 0 ], GL_QUERY_RESULT, &startTime );
 
+  const uint32_t tilesPerImage = uint32_t( std::ceil( WIDTH / float( TILESIZE ) ) * std::ceil( HEIGHT / float( TILESIZE ) ) );
   int tilesCompleted = 0;
   float looptime = 0.;
   while( 1 ) {
     // get a tile offset + send it
     glm::ivec2 tile = getTile();
     glUniform2i( glGetUniformLocation( pathtraceShader, "tileOffset" ), tile.x, tile.y );
+    glUniform1ui( glGetUniformLocation( pathtraceShader, "frameIndex" ), frameIndex );
+    noiseUniforms( launch.seed * seedStride + frameIndex++ / tilesPerImage ); // one full pass over the tiles is one sample per pixel
 
     // render the specified tile - send uniforms and dispatch
     glDispatchCompute( TILESIZE / 32, TILESIZE / 32, 1 );
@@ -58,26 +222,138 @@ void engine::pathtrace() {
     tilesCompleted++;
 
     // check time, wait for query to be ready
-    glQueryCounter( queryID[ 1 ], GL_TIMESTAMP );
+    glQueryCounter( pathtraceQueries[ 1 ], GL_TIMESTAMP );
     GLint checkTimeAvailable = 0;
     while( !checkTimeAvailable )
-      glGetQueryObjectiv( queryID[ 1 ], GL_QUERY_RESULT_AVAILABLE, &checkTimeAvailable );
-    glGetQueryObjectui64v( queryID[ 1 ], GL_QUERY_RESULT, &checkTime );
+      glGetQueryObjectiv( pathtraceQueries[ 1 ], GL_QUERY_RESULT_AVAILABLE, &checkTimeAvailable );
+    glGetQueryObjectui64v( pathtraceQueries[ 1 ], GL_QUERY_RESULT, &checkTime );
 
     // break if duration exceeds 16 ms - query units are nanoseconds
     looptime = ( checkTime - startTime ) / 1e6; // get milliseconds
-    if( looptime > 16. ) {
-      cout << tilesCompleted << " tiles in " << looptime << " ms, avg " << looptime / tilesCompleted << " ms/tile" << endl;
-      break;
-    }
+    if( looptime > 16. ) break;
+  }
+
+  // 2x2 AA, one camera ray per subsample
+  profile.count( "Tiles", tilesCompleted );
+  profile.count( "Primary Rays", float( tilesCompleted ) * TILESIZE * TILESIZE * 4 );
+}
+
+void engine::statsUpdate() {
+  static const char *names[ statsCount ] = { "Traced Primary Rays", "Bounce Rays", "DE Calls", "Misses", "Step Limit Hits" };
+
+  // last frame's copy - poll, don't wait, a late frame just drops its numbers
+  int previous = statsSlot ^ 1;
+  if ( statsFences[ previous ] ) {
+    GLenum status = glClientWaitSync( statsFences[ previous ], 0, 0 );
+    if ( status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED )
+      for ( int i = 0; i < statsCount; i++ )
+        profile.count( names[ i ], float( statsMapping[ previous * statsCount + i ] ) );
+    glDeleteSync( statsFences[ previous ] );
+    statsFences[ previous ] = 0;
+  }
+
+  // this frame's counts into the free half, then reset for the next frame
+  if ( collectStats && mode == renderMode::pathtrace ) {
+    glMemoryBarrier( GL_BUFFER_UPDATE_BARRIER_BIT );
+    glBindBuffer( GL_COPY_READ_BUFFER, statsBuffer );
+    glBindBuffer( GL_COPY_WRITE_BUFFER, statsReadback );
+    glCopyBufferSubData( GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, statsSlot * statsCount * sizeof( GLuint ), statsCount * sizeof( GLuint ) );
+    glClearBufferSubData( GL_COPY_READ_BUFFER, GL_R32UI, 0, statsCount * sizeof( GLuint ), GL_RED_INTEGER, GL_UNSIGNED_INT, NULL );
+    glBindBuffer( GL_COPY_READ_BUFFER, 0 );
+    glBindBuffer( GL_COPY_WRITE_BUFFER, 0 );
+    statsFences[ statsSlot ] = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+    statsSlot = previous;
+  }
+
+  // headless runs get the rates on stdout
+  if ( launch.stats && std::chrono::steady_clock::now() - lastStatsReport > std::chrono::seconds( 1 ) ) {
+    lastStatsReport = std::chrono::steady_clock::now();
+    float framesPerSecond = 1000.0f / std::max( profile.frameTime.average(), 1e-3f );
+    std::stringstream report;
+    report << std::fixed << std::setprecision( 2 );
+    for ( int i = 0; i < statsCount; i++ )
+      if ( const profiler::series *s = profile.counter( names[ i ] ) )
+        report << " " << names[ i ] << " " << s->average() * framesPerSecond / 1e6f << "M/s";
+    cout << T_BLUE << "    Path Tracer" << RESET << report.str() << endl;
   }
 }
 
+void engine::denoise() {
+  if ( !denoiseParams.enable || mode != renderMode::pathtrace ) return;
+  glUseProgram( denoiseShader );
+
+  glUniform1f( glGetUniformLocation( denoiseShader, "strength" ), denoiseParams.strength );
+  glUniform1f( glGetUniformLocation( denoiseShader, "falloff" ), denoiseParams.falloff );
+  glUniform1f( glGetUniformLocation( denoiseShader, "sigmaNormal" ), denoiseParams.sigmaNormal );
+  glUniform1f( glGetUniformLocation( denoiseShader, "sigmaDepth" ), denoiseParams.sigmaDepth );
+  glUniform1f( glGetUniformLocation( denoiseShader, "sigmaLuminance" ), denoiseParams.sigmaLuminance );
+
+  // ping-pong between the two buffers, tap spacing doubles each pass
+  for ( int pass = 0; pass < denoiseParams.passes; pass++ ) {
+    glBindImageTexture( 6, denoiseTextures[ pass % 2 ], 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F );
+    glBindImageTexture( 7, denoiseTextures[ ( pass + 1 ) % 2 ], 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F );
+    glUniform1i( glGetUniformLocation( denoiseShader, "stepSize" ), 1 << pass );
+    glUniform1i( glGetUniformLocation( denoiseShader, "firstPass" ), pass == 0 );
+    glDispatchCompute( std::ceil( WIDTH / 32. ), std::ceil( HEIGHT / 32. ), 1 );
+    glMemoryBarrier( GL_SHADER_IMAGE_ACCESS_BARRIER_BIT );
+  }
+
+  // leave the final result on unit 6, where postprocess picks it up
+  glBindImageTexture( 6, denoiseTextures[ denoiseParams.passes % 2 ], 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F );
+}
+
 void engine::postprocess() {
+  // anything that touches the whole image needs a full frame pass, otherwise only the tiles pathtrace touched
+  bool diffuseMode = post.ditherMode != 0 && post.ditherMethod == 2; // error diffusion within 32x32 blocks
+  bool fullFrame = fullFrameDirty || mode != renderMode::pathtrace || denoiseActive();
+  if ( !fullFrame && dirtyTiles.empty() ) return; // nothing changed, displayTexture is current
+
   // tonemapping and dithering, as configured in the GUI
   glUseProgram( postprocessShader );
-  glDispatchCompute( std::ceil( WIDTH / 32. ), std::ceil( HEIGHT / 32. ), 1 );
-  glMemoryBarrier( GL_SHADER_IMAGE_ACCESS_BARRIER_BIT ); // sync
+  glUniform1i( glGetUniformLocation( postprocessShader, "useDenoised" ), denoiseActive() );
+  sendPostUniforms( postprocessShader );
+
+  // error diffusion walks each block's rows serially, with the same dispatch - blocks don't share error
+  glUniform1i( glGetUniformLocation( postprocessShader, "diffuseMode" ), diffuseMode );
+  glUniform1i( glGetUniformLocation( postprocessShader, "tiled" ), !fullFrame );
+  if ( fullFrame ) {
+    glDispatchCompute( std::ceil( WIDTH / 32. ), std::ceil( HEIGHT / 32. ), 1 );
+  } else {
+    // indirect args in the header, then the tile offsets - one z slice of the dispatch per tile
+    GLuint header[ 4 ] = { TILESIZE / 32, TILESIZE / 32, GLuint( dirtyTiles.size() ), GLuint( dirtyTiles.size() ) };
+    glBindBuffer( GL_DISPATCH_INDIRECT_BUFFER, dirtyTileBuffer );
+    glBufferSubData( GL_DISPATCH_INDIRECT_BUFFER, 0, sizeof( header ), header );
+    glBufferSubData( GL_DISPATCH_INDIRECT_BUFFER, sizeof( header ), sizeof( glm::ivec2 ) * dirtyTiles.size(), &dirtyTiles[ 0 ] );
+    glDispatchComputeIndirect( 0 );
+  }
+  glMemoryBarrier( GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT ); // sync
+
+  // displayTexture is current - start collecting dirty tiles again
+  for ( auto &tile : dirtyTiles )
+    tileDirty[ tileIndex( tile ) ] = false;
+  dirtyTiles.clear();
+  fullFrameDirty = false;
+}
+
+// tonemap + dither settings, shared by the compute postprocess and the fused present
+void engine::sendPostUniforms( GLuint shader ) {
+  glm::vec2 domain = tonemapDomain( post.tonemapMode );
+  glUniform1i( glGetUniformLocation( shader, "tonemapMode" ), post.tonemapMode );
+  glUniform2f( glGetUniformLocation( shader, "tonemapDomain" ), domain.x, domain.y );
+  glUniform1i( glGetUniformLocation( shader, "ditherMode" ), post.ditherMode );
+  glUniform1i( glGetUniformLocation( shader, "ditherMethod" ), post.ditherMethod );
+  glUniform1i( glGetUniformLocation( shader, "ditherPattern" ), post.ditherPattern );
+  glUniform1i( glGetUniformLocation( shader, "ditherLevels" ), post.ditherLevels );
+  glUniform1i( glGetUniformLocation( shader, "paletteSize" ), palette.size() );
+}
+
+bool engine::denoiseActive() {
+  return denoiseParams.enable && denoiseParams.passes > 0 && mode == renderMode::pathtrace;
+}
+
+// error diffusion is serial along row segments, so it can't run per fragment - everything else can
+bool engine::fusedPresent() {
+  return !( post.ditherMode != 0 && post.ditherMethod == 2 );
 }
 
 void engine::mainDisplayBlit() {
@@ -91,6 +367,15 @@ void engine::mainDisplayBlit() {
 
   ImGuiIO &io = ImGui::GetIO();
   glUniform2f( glGetUniformLocation( displayShader, "resolution" ), io.DisplaySize.x, io.DisplaySize.y );
+
+  // fused path tonemaps + dithers straight from the float image, skipping displayTexture
+  glUniform1i( glGetUniformLocation( displayShader, "fused" ), fusedPresent() );
+  if ( fusedPresent() ) {
+    sendPostUniforms( displayShader );
+    glActiveTexture( GL_TEXTURE0 + 14 );
+    glBindTexture( GL_TEXTURE_2D, denoiseActive() ? denoiseTextures[ denoiseParams.passes % 2 ] : accumulatorTexture );
+    glMemoryBarrier( GL_TEXTURE_FETCH_BARRIER_BIT ); // compute writes -> sampler reads
+  }
   glDrawArrays( GL_TRIANGLES, 0, 3 );
 }
 
@@ -103,6 +388,9 @@ void engine::imguiPass() {
   if ( showDemoWindow )
     ImGui::ShowDemoWindow( &showDemoWindow );
 
+  // show the render controls
+  controlsWindow();
+
   // show quit confirm window
   quitConf( &quitConfirm );
 
@@ -128,33 +416,124 @@ void engine::handleEvents() {
 
     if ( event.type == SDL_KEYUP && event.key.keysym.sym == SDLK_ESCAPE && SDL_GetModState() & KMOD_SHIFT )
       pQuit = true; // force quit on shift+esc ( bypasses confirm window )
+
+    if ( event.type == SDL_KEYUP && event.key.keysym.sym == SDLK_F12 && !ImGui::GetIO().WantCaptureKeyboard )
+      screenShot();
   }
 }
 
 glm::ivec2 engine::getTile() {
-  static std::vector< glm::ivec2 > offsets;
-  static int listOffset = 0;
-  static bool firstTime = true;
-  std::random_device rd;
-  std::mt19937 rngen( rd() );
-
-  if ( firstTime ) { // construct the tile list
-    firstTime = false;
-    for( int x = 0; x <= WIDTH; x += TILESIZE ) {
-      for( int y = 0; y <= HEIGHT; y += TILESIZE ) {
-        offsets.push_back( glm::ivec2( x, y ) );
+  if ( tileOffsets.empty() ) { // construct the tile list
+    for( int x = 0; x < WIDTH; x += TILESIZE ) {
+      for( int y = 0; y < HEIGHT; y += TILESIZE ) {
+        tileOffsets.push_back( glm::ivec2( x, y ) );
       }
     }
+    tileDirty.resize( tileOffsets.size(), false );
+    tileListOffset = 0;
   } else { // check if the offset needs to be reset
-    if ( ++listOffset == int( offsets.size() ) ) {
-      listOffset = 0;
+    if ( ++tileListOffset == int( tileOffsets.size() ) ) {
+      tileListOffset = 0;
     }
   }
-  // shuffle when listOffset is zero ( first iteration, and any subsequent resets )
-  if ( !listOffset ) std::shuffle( offsets.begin(), offsets.end(), rngen );
-  return offsets[ listOffset ];
+  // shuffle when tileListOffset is zero ( first iteration, and any subsequent resets )
+  if ( !tileListOffset ) std::shuffle( tileOffsets.begin(), tileOffsets.end(), tileRNG );
+
+  glm::ivec2 tile = tileOffsets[ tileListOffset ];
+  markTileDirty( tile );
+  return tile;
+}
+
+// publish a tile to the dirty list, for postprocess
+void engine::markTileDirty( glm::ivec2 tile ) {
+  if ( tileDirty.empty() )
+    tileDirty.resize( int( std::ceil( WIDTH / float( TILESIZE ) ) ) * int( std::ceil( HEIGHT / float( TILESIZE ) ) ), false );
+  if ( !tileDirty[ tileIndex( tile ) ] ) {
+    tileDirty[ tileIndex( tile ) ] = true;
+    dirtyTiles.push_back( tile );
+  }
 }
 
 void engine::screenShot() {
+  if ( screenshotFence ) {
+    cout << "Screenshot - readback already in flight, skipping" << endl;
+    return;
+  }
+
+  // the fused present never writes displayTexture - bring it up to date first
+  postprocess();
+
+  screenshotFilename = timestampedFilename( "screenshots", "Screenshot" ) + ".png";
+
+  // async copy into the pack buffer, fence tells us when it's landed
+  glMemoryBarrier( GL_TEXTURE_UPDATE_BARRIER_BIT );
+  glBindBuffer( GL_PIXEL_PACK_BUFFER, screenshotBuffer );
+  glActiveTexture( GL_TEXTURE0 );
+  glBindTexture( GL_TEXTURE_2D, displayTexture );
+  glGetTexImage( GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0 );
+  glBindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
+  screenshotFence = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+}
+
+void engine::screenShotUpdate() {
+  if ( !screenshotFence ) return;
+
+  // poll, don't wait - check again next frame if the copy hasn't finished
+  GLenum status = glClientWaitSync( screenshotFence, 0, 0 );
+  if ( status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED ) return;
+  glDeleteSync( screenshotFence );
+  screenshotFence = 0;
+
+  // copy out of the mapping so the buffer is free for the next one, the rest happens on the writer thread
+  imageWriteJob job;
+  job.filename = screenshotFilename;
+  job.width = WIDTH;
+  job.height = HEIGHT;
+  job.preset = pngPreset( exportParams.pngPreset );
+  job.pixels.resize( WIDTH * HEIGHT * 4 );
+  memcpy( job.pixels.data(), screenshotMapping, job.pixels.size() );
+  writer.push( std::move( job ) );
+}
+
+void engine::accumulatorExport() {
+  if ( exportFence ) {
+    cout << "Export - readback already in flight, skipping" << endl;
+    return;
+  }
+
+  // raw radiance and sample counts, straight off the accumulator - the settings are taken now, the pixels
+  // once the fence passes
+  imageWriteJob job;
+  job.format = imageFormat( exportParams.floatFormat );
+  job.width = WIDTH;
+  job.height = HEIGHT;
+  job.halfFloat = exportParams.halfFloat;
+  job.zip = exportParams.zip;
+  job.filename = timestampedFilename( "exports", "Accumulator" ); // PFM adds its own extensions
+  if ( job.format == IMAGE_EXR ) job.filename += ".exr";
+
+  exportJob = std::move( job );
+
+  // async copy into the pack buffer, fence tells us when it's landed
+  glMemoryBarrier( GL_TEXTURE_UPDATE_BARRIER_BIT );
+  glBindBuffer( GL_PIXEL_PACK_BUFFER, exportBuffer );
+  glActiveTexture( GL_TEXTURE0 );
+  glBindTexture( GL_TEXTURE_2D, accumulatorTexture );
+  glGetTexImage( GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, 0 );
+  glBindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
+  exportFence = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+}
+
+void engine::accumulatorExportUpdate() {
+  if ( !exportFence ) return;
+
+  // poll, don't wait - check again next frame if the copy hasn't finished
+  GLenum status = glClientWaitSync( exportFence, 0, 0 );
+  if ( status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED ) return;
+  glDeleteSync( exportFence );
+  exportFence = 0;
 
+  exportJob.radiance.assign( exportMapping, exportMapping + WIDTH * HEIGHT * 4 );
+  writer.push( std::move( exportJob ) );
+  exportJob = imageWriteJob();
 }
@@ -0,0 +1,125 @@
+#include "engine.h"
+
+// VAT terrain, see vat_field.h - the automaton runs on the CPU, its cells go up as an R8UI texture, and
+// the distance field the path tracer marches comes from a jump flood over them on the GPU, or the exact
+// EDT on the CPU. The seed textures only live for the length of the flood. The cells also become a
+// sparse 64-tree ( vat_tree.h ), which the path tracer can cast rays against instead of marching
+
+static GLuint createTexture3D( int unit, GLenum format, GLsizei size, GLenum filter ) {
+  GLuint texture;
+  glGenTextures( 1, &texture );
+  glActiveTexture( GL_TEXTURE0 + unit );
+  glBindTexture( GL_TEXTURE_3D, texture );
+  glTexParameteri( GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, filter );
+  glTexParameteri( GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, filter );
+  glTexParameteri( GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+  glTexParameteri( GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+  glTexParameteri( GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE );
+  glTexStorage3D( GL_TEXTURE_3D, 1, format, size, size, size );
+  return texture;
+}
+
+void engine::vatGenerate() {
+  cout << T_BLUE << "    Generating VAT" << RESET << " ................................... ";
+  auto start = std::chrono::steady_clock::now();
+
+  // seeds in the jump flood hold 10 bits per axis
+  vatParams.levels = glm::clamp( vatParams.levels, 1, 9 );
+  voxel_automata_terrain vat( vatParams.levels, vatParams.flip, std::string( vatParams.rule ), vatParams.initMode,
+    vatParams.lambda, vatParams.beta, vatParams.mag, vatParams.minimums, vatParams.maximums );
+  vatCells = vatPack( vat.state );
+  vatSize = vat.state.size();
+  vatSolidCells = vatCells.size() - std::count( vatCells.begin(), vatCells.end(), 0 );
+  vatGenerateMs = std::chrono::duration< float, std::milli >( std::chrono::steady_clock::now() - start ).count();
+
+  glDeleteTextures( 1, &vatCellTexture );
+  vatCellTexture = createTexture3D( 19, GL_R8UI, vatSize, GL_NEAREST );
+  glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
+  glTexSubImage3D( GL_TEXTURE_3D, 0, 0, 0, 0, vatSize, vatSize, vatSize, GL_RED_INTEGER, GL_UNSIGNED_BYTE, vatCells.data() );
+  glPixelStorei( GL_UNPACK_ALIGNMENT, 4 );
+
+  vatFieldUpdate();
+  vatTreeUpdate();
+  cout << T_GREEN << "done." << RESET << " " << vatSize << "^3 cells, " << vatSolidCells << " solid, generated in " << vatGenerateMs
+       << "ms, distance field in " << vatFieldMs << "ms" << ( vatParams.cpuField ? " on the CPU" : "" ) << endl;
+  cout << "      64-tree " << vatTreeDepth << " deep, " << vatTreeBytes / 1024 << "kB against " << vatCells.size() / 1024
+       << "kB of cells, built in " << vatTreeMs << "ms" << endl;
+}
+
+void engine::vatTreeUpdate() {
+  auto start = std::chrono::steady_clock::now();
+  vatTree tree = vatBuildTree( vatCells, vatSize );
+  vatTreeRoot = tree.root;
+  vatTreeDepth = tree.depth;
+  vatTreeBytes = tree.bytes();
+  vatTreeMs = std::chrono::duration< float, std::milli >( std::chrono::steady_clock::now() - start ).count();
+
+  if ( !vatTreeBuffer ) glGenBuffers( 1, &vatTreeBuffer );
+  glBindBuffer( GL_SHADER_STORAGE_BUFFER, vatTreeBuffer );
+  glBufferData( GL_SHADER_STORAGE_BUFFER, tree.bytes(), tree.nodes.data(), GL_STATIC_DRAW );
+}
+
+// distance field from vatCells - either way it ends up in the R32F texture on unit 21
+void engine::vatFieldUpdate() {
+  if ( vatCells.empty() ) return;
+  auto start = std::chrono::steady_clock::now();
+  glDeleteTextures( 1, &vatFieldTexture );
+  vatFieldTexture = createTexture3D( 21, GL_R32F, vatSize, GL_NEAREST );
+
+  if ( vatParams.cpuField ) {
+    std::vector< float > field = vatDistanceField( vatCells, vatSize );
+    glTexSubImage3D( GL_TEXTURE_3D, 0, 0, 0, 0, vatSize, vatSize, vatSize, GL_RED, GL_FLOAT, field.data() );
+  } else {
+    // ping-pong between two seed textures - read through unit 20, written through image unit 6, which
+    // the denoiser rebinds for itself every pass
+    GLuint seeds[ 2 ] = { createTexture3D( 20, GL_R32UI, vatSize, GL_NEAREST ), createTexture3D( 20, GL_R32UI, vatSize, GL_NEAREST ) };
+    const GLuint groups = ( vatSize + 7 ) / 8;
+    glUseProgram( vatJFAShader );
+    glUniform1i( glGetUniformLocation( vatJFAShader, "vatSize" ), vatSize );
+    int current = 0;
+    auto pass = [ & ]( int which, int step ) {
+      glActiveTexture( GL_TEXTURE0 + 20 );
+      glBindTexture( GL_TEXTURE_3D, seeds[ current ] );
+      glBindImageTexture( 6, seeds[ current ^ 1 ], 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_R32UI );
+      glUniform1i( glGetUniformLocation( vatJFAShader, "jfaPass" ), which );
+      glUniform1i( glGetUniformLocation( vatJFAShader, "jfaStep" ), step );
+      glDispatchCompute( groups, groups, groups );
+      glMemoryBarrier( GL_TEXTURE_FETCH_BARRIER_BIT );
+      current ^= 1;
+    };
+
+    pass( 0, 0 );
+    int step = 1;
+    while ( step * 2 < vatSize ) step *= 2;
+    for ( ; step >= 1; step /= 2 )
+      pass( 1, step );
+    pass( 1, 1 ); // 1+JFA, cleans up most of the remaining misses
+
+    // resolve, seeds to the signed field
+    glActiveTexture( GL_TEXTURE0 + 20 );
+    glBindTexture( GL_TEXTURE_3D, seeds[ current ] );
+    glBindImageTexture( 7, vatFieldTexture, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_R32F );
+    glUniform1i( glGetUniformLocation( vatJFAShader, "jfaPass" ), 2 );
+    glDispatchCompute( groups, groups, groups );
+    glMemoryBarrier( GL_TEXTURE_FETCH_BARRIER_BIT );
+    glFinish(); // once per generate, for the timing, and so the seeds can go
+    glDeleteTextures( 2, seeds );
+  }
+  vatFieldMs = std::chrono::duration< float, std::milli >( std::chrono::steady_clock::now() - start ).count();
+  accumulationRestart(); // nothing accumulated so far shows the terrain as it is now
+}
+
+void engine::vatUniforms( GLuint shader ) {
+  glUniform1i( glGetUniformLocation( shader, "vatActive" ), vatParams.enable && !vatCells.empty() );
+  glUniform3fv( glGetUniformLocation( shader, "vatMin" ), 1, glm::value_ptr( vatParams.position ) );
+  glUniform1f( glGetUniformLocation( shader, "vatCellSize" ), vatParams.extent / std::max( vatSize, 1 ) );
+  glUniform1i( glGetUniformLocation( shader, "vatSize" ), vatSize );
+  glUniform2i( glGetUniformLocation( shader, "vatMaterials" ), vatParams.materials.x, vatParams.materials.y );
+  glUniform1i( glGetUniformLocation( shader, "vatTraversal" ), vatParams.traversal );
+  glUniform1ui( glGetUniformLocation( shader, "vatTreeRoot" ), vatTreeRoot );
+  glUniform1i( glGetUniformLocation( shader, "vatTreeDepth" ), vatTreeDepth );
+
+  // the SSBO bindings GL guarantees are all taken, so the tree takes turns on 7 with the cache bake
+  if ( vatTreeBuffer )
+    glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 7, vatTreeBuffer );
+}
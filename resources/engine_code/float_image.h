@@ -0,0 +1,476 @@
+#ifndef FLOAT_IMAGE_H
+#define FLOAT_IMAGE_H
+
+// float image output for the raw accumulator - rgb radiance plus the per pixel sample count, so renders
+// can be merged, resumed, or tonemapped offline
+//  - PFM: radiance in <name>.pfm, sample counts as a greyscale companion <name>.samples.pfm
+//  - EXR: minimal single part scanline file, channels B, G, R, sampleCount - radiance optionally half
+//    float, sampleCount always full float since half loses integers past 2048, optional ZIP compression
+// plus streaming readers for both, used to merge dumps a few scanlines at a time
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <zlib.h>
+#include "../glm/gtc/packing.hpp"
+
+// input for all of these is RGBA32F as it comes from OpenGL - bottom row first, sample count in alpha
+
+// PFM rows run bottom to top already, negative scale means little endian
+inline bool writePFMChannels( const std::string &filename, const float *rgba, int width, int height, bool color ) {
+  std::ofstream file( filename, std::ios::binary );
+  if ( !file ) return false;
+  file << ( color ? "PF" : "Pf" ) << "\n" << width << " " << height << "\n-1.0\n";
+  std::vector< float > row( width * ( color ? 3 : 1 ) );
+  for ( int y = 0; y < height; y++ ) {
+    const float *source = rgba + size_t( y ) * width * 4;
+    for ( int x = 0; x < width; x++ ) {
+      if ( color ) {
+        row[ x * 3 + 0 ] = source[ x * 4 + 0 ];
+        row[ x * 3 + 1 ] = source[ x * 4 + 1 ];
+        row[ x * 3 + 2 ] = source[ x * 4 + 2 ];
+      } else {
+        row[ x ] = source[ x * 4 + 3 ];
+      }
+    }
+    file.write( ( const char * ) row.data(), row.size() * sizeof( float ) );
+  }
+  return bool( file );
+}
+
+// filename without the extension
+inline bool writePFM( const std::string &basename, const float *rgba, int width, int height ) {
+  return writePFMChannels( basename + ".pfm", rgba, width, height, true )
+      && writePFMChannels( basename + ".samples.pfm", rgba, width, height, false );
+}
+
+// EXR header attribute helpers - everything in the file is little endian
+inline void exrPut( std::vector< uint8_t > &out, const void *data, size_t bytes ) {
+  const uint8_t *p = ( const uint8_t * ) data;
+  out.insert( out.end(), p, p + bytes );
+}
+
+inline void exrPutString( std::vector< uint8_t > &out, const char *s ) {
+  exrPut( out, s, strlen( s ) + 1 );
+}
+
+template < typename T >
+inline void exrPutValue( std::vector< uint8_t > &out, T value ) {
+  exrPut( out, &value, sizeof( T ) );
+}
+
+inline void exrAttribute( std::vector< uint8_t > &out, const char *name, const char *type, const std::vector< uint8_t > &value ) {
+  exrPutString( out, name );
+  exrPutString( out, type );
+  exrPutValue< int32_t >( out, int32_t( value.size() ) );
+  exrPut( out, value.data(), value.size() );
+}
+
+// ZIP compression preprocessing - split even and odd bytes, then delta encode, then zlib
+inline std::vector< uint8_t > exrZip( const std::vector< uint8_t > &raw ) {
+  size_t n = raw.size();
+  std::vector< uint8_t > shuffled( n );
+  size_t half = ( n + 1 ) / 2;
+  for ( size_t i = 0; i < n; i++ )
+    shuffled[ ( i & 1 ) ? half + i / 2 : i / 2 ] = raw[ i ];
+  for ( size_t i = n - 1; i > 0; i-- )
+    shuffled[ i ] = uint8_t( int( shuffled[ i ] ) - int( shuffled[ i - 1 ] ) + 128 );
+
+  uLongf compressedSize = compressBound( n );
+  std::vector< uint8_t > compressed( compressedSize );
+  if ( compress2( compressed.data(), &compressedSize, shuffled.data(), n, Z_DEFAULT_COMPRESSION ) != Z_OK )
+    return raw;
+  compressed.resize( compressedSize );
+
+  // readers take a chunk the size of the raw data as stored uncompressed
+  return compressed.size() < n ? compressed : raw;
+}
+
+enum exrPixelType { EXR_UINT = 0, EXR_HALF = 1, EXR_FLOAT = 2 };
+enum exrCompression { EXR_NO_COMPRESSION = 0, EXR_ZIPS_COMPRESSION = 2, EXR_ZIP_COMPRESSION = 3 };
+
+// streaming scanline writer - header and a placeholder offset table go out on open, chunks as they
+// come, and the offset table is filled in on close
+class exrWriter {
+public:
+  bool open( const std::string &filename, int w, int h, bool halfFloat, bool zip ) {
+    width = w;
+    height = h;
+    compression = zip ? EXR_ZIP_COMPRESSION : EXR_NO_COMPRESSION;
+    linesPerChunk = zip ? 16 : 1; // ZIP works on blocks of 16 scanlines
+    nextLine = 0;
+    offsets.clear();
+
+    // channels, in the alphabetical order they're stored in
+    channels = {
+      { "B", halfFloat ? EXR_HALF : EXR_FLOAT, 2 },
+      { "G", halfFloat ? EXR_HALF : EXR_FLOAT, 1 },
+      { "R", halfFloat ? EXR_HALF : EXR_FLOAT, 0 },
+      { "sampleCount", EXR_FLOAT, 3 } };
+
+    std::vector< uint8_t > header;
+    exrPutValue< uint32_t >( header, 20000630 ); // magic
+    exrPutValue< uint32_t >( header, 2 );        // version 2, single part scanline
+
+    std::vector< uint8_t > value;
+    for ( auto &c : channels ) {
+      exrPutString( value, c.name );
+      exrPutValue< int32_t >( value, c.type );
+      exrPutValue< uint32_t >( value, 0 ); // pLinear + reserved
+      exrPutValue< int32_t >( value, 1 );  // x sampling
+      exrPutValue< int32_t >( value, 1 );  // y sampling
+    }
+    value.push_back( 0 );
+    exrAttribute( header, "channels", "chlist", value );
+
+    value = { uint8_t( compression ) };
+    exrAttribute( header, "compression", "compression", value );
+
+    value.clear();
+    exrPutValue< int32_t >( value, 0 );
+    exrPutValue< int32_t >( value, 0 );
+    exrPutValue< int32_t >( value, width - 1 );
+    exrPutValue< int32_t >( value, height - 1 );
+    exrAttribute( header, "dataWindow", "box2i", value );
+    exrAttribute( header, "displayWindow", "box2i", value );
+
+    value = { 0 }; // INCREASING_Y
+    exrAttribute( header, "lineOrder", "lineOrder", value );
+
+    value.clear();
+    exrPutValue< float >( value, 1.0f );
+    exrAttribute( header, "pixelAspectRatio", "float", value );
+
+    value.clear();
+    exrPutValue< float >( value, 0.0f );
+    exrPutValue< float >( value, 0.0f );
+    exrAttribute( header, "screenWindowCenter", "v2f", value );
+
+    value.clear();
+    exrPutValue< float >( value, 1.0f );
+    exrAttribute( header, "screenWindowWidth", "float", value );
+    header.push_back( 0 ); // end of header
+
+    file.open( filename, std::ios::binary );
+    if ( !file ) return false;
+    file.write( ( const char * ) header.data(), header.size() );
+    tablePosition = header.size();
+    std::vector< uint64_t > placeholder( chunkCount(), 0 );
+    file.write( ( const char * ) placeholder.data(), placeholder.size() * sizeof( uint64_t ) );
+    return bool( file );
+  }
+
+  int chunkCount() const { return ( height + linesPerChunk - 1 ) / linesPerChunk; }
+  int linesPerChunk = 1;
+
+  // the next linesPerChunk scanlines ( fewer for the last chunk ), top row first, RGBA32F with the
+  // sample count in alpha - rowStride is in floats, negative walks up through bottom up data
+  bool writeChunk( const float *rgba, ptrdiff_t rowStride ) {
+    int lines = std::min( linesPerChunk, height - nextLine );
+    if ( lines <= 0 ) return false;
+    std::vector< uint8_t > raw;
+    for ( int y = 0; y < lines; y++ ) {
+      const float *row = rgba + y * rowStride;
+      for ( auto &c : channels ) {
+        for ( int x = 0; x < width; x++ ) {
+          float v = row[ x * 4 + c.source ];
+          if ( c.type == EXR_HALF )
+            exrPutValue< uint16_t >( raw, glm::packHalf1x16( v ) );
+          else
+            exrPutValue< float >( raw, v );
+        }
+      }
+    }
+    std::vector< uint8_t > data = compression == EXR_NO_COMPRESSION ? raw : exrZip( raw );
+
+    offsets.push_back( uint64_t( file.tellp() ) );
+    int32_t chunkHeader[ 2 ] = { nextLine, int32_t( data.size() ) };
+    file.write( ( const char * ) chunkHeader, sizeof( chunkHeader ) );
+    file.write( ( const char * ) data.data(), data.size() );
+    nextLine += lines;
+    return bool( file );
+  }
+
+  bool close() {
+    if ( int( offsets.size() ) != chunkCount() ) return false;
+    file.seekp( tablePosition );
+    file.write( ( const char * ) offsets.data(), offsets.size() * sizeof( uint64_t ) );
+    file.close();
+    return !file.fail();
+  }
+
+private:
+  struct channel { const char *name; int type; int source; };
+  std::vector< channel > channels;
+  std::ofstream file;
+  std::vector< uint64_t > offsets;
+  size_t tablePosition = 0;
+  int width = 0, height = 0, compression = 0, nextLine = 0;
+};
+
+inline bool writeEXR( const std::string &filename, const float *rgba, int width, int height, bool halfFloat, bool zip ) {
+  exrWriter writer;
+  if ( !writer.open( filename, width, height, halfFloat, zip ) ) return false;
+  // EXR y runs down the image, the input up
+  const ptrdiff_t stride = ptrdiff_t( width ) * 4;
+  for ( int y = 0; y < height; y += writer.linesPerChunk )
+    if ( !writer.writeChunk( rgba + ( height - 1 - y ) * stride, -stride ) ) return false;
+  return writer.close();
+}
+
+// streaming readers for merging dumps - scanlines on request, top row first, RGBA32F with the sample count in alpha
+class floatImageReader {
+public:
+  virtual ~floatImageReader() {}
+  virtual bool readLines( int y, int count, float *rgba ) = 0;
+  int width = 0, height = 0;
+  std::string error;
+};
+
+// reads back what writeEXR produces, and other single part scanline files with R, G, B and optionally
+// sampleCount ( or A as a fallback ) - uncompressed, ZIPS or ZIP, half or float
+class exrReader : public floatImageReader {
+public:
+  bool open( const std::string &filename ) {
+    file.open( filename, std::ios::binary );
+    if ( !file ) return fail( "can't open " + filename );
+    uint32_t magic = 0, version = 0;
+    file.read( ( char * ) &magic, 4 );
+    file.read( ( char * ) &version, 4 );
+    if ( magic != 20000630 ) return fail( filename + " isn't an EXR" );
+    if ( version & 0x1200 ) return fail( filename + " is tiled or multipart, only single part scanline files are supported" );
+
+    int32_t window[ 4 ] = { 0, 0, -1, -1 };
+    int compression = -1;
+    while ( true ) {
+      std::string name = readString();
+      if ( name.empty() ) break; // end of header
+      std::string type = readString();
+      int32_t size = 0;
+      file.read( ( char * ) &size, 4 );
+      std::vector< uint8_t > value( size );
+      file.read( ( char * ) value.data(), size );
+      if ( !file ) return fail( filename + " has a truncated header" );
+
+      if ( name == "channels" ) {
+        size_t p = 0;
+        while ( p < value.size() && value[ p ] ) {
+          std::string channelName( ( const char * ) &value[ p ] );
+          p += channelName.size() + 1;
+          int32_t pixelType;
+          memcpy( &pixelType, &value[ p ], 4 );
+          p += 16;
+          channels.push_back( { channelName, pixelType, -1 } );
+        }
+      } else if ( name == "compression" ) {
+        compression = value[ 0 ];
+      } else if ( name == "dataWindow" ) {
+        memcpy( window, value.data(), 16 );
+      }
+    }
+
+    originY = window[ 1 ];
+    width = window[ 2 ] - window[ 0 ] + 1;
+    height = window[ 3 ] - window[ 1 ] + 1;
+    switch ( compression ) {
+      case EXR_NO_COMPRESSION:   linesPerChunk = 1;  break;
+      case EXR_ZIPS_COMPRESSION: linesPerChunk = 1;  break;
+      case EXR_ZIP_COMPRESSION:  linesPerChunk = 16; break;
+      default: return fail( filename + " uses an unsupported compression" );
+    }
+
+    // map channels to RGBA slots - sampleCount wins over A if both are present
+    bool haveCount = false;
+    for ( auto &c : channels ) {
+      if ( c.name == "R" ) c.slot = 0;
+      else if ( c.name == "G" ) c.slot = 1;
+      else if ( c.name == "B" ) c.slot = 2;
+      else if ( c.name == "sampleCount" ) { c.slot = 3; haveCount = true; }
+      bytesPerPixel += c.type == EXR_HALF ? 2 : 4;
+    }
+    for ( auto &c : channels )
+      if ( c.name == "A" && !haveCount ) { c.slot = 3; haveCount = true; }
+    if ( !haveCount ) return fail( filename + " has no sampleCount channel" );
+
+    offsets.resize( ( height + linesPerChunk - 1 ) / linesPerChunk );
+    file.read( ( char * ) offsets.data(), offsets.size() * sizeof( uint64_t ) );
+    if ( !file || width <= 0 || height <= 0 ) return fail( filename + " has a truncated offset table" );
+    return true;
+  }
+
+  bool readLines( int y, int count, float *rgba ) override {
+    for ( int line = y; line < y + count; line++ ) {
+      int chunk = line / linesPerChunk;
+      if ( chunk != cachedChunk && !loadChunk( chunk ) ) return false;
+      int lineInChunk = line - chunk * linesPerChunk;
+      const uint8_t *p = cache.data() + size_t( lineInChunk ) * width * bytesPerPixel;
+      float *row = rgba + size_t( line - y ) * width * 4;
+      for ( int x = 0; x < width; x++ )
+        row[ x * 4 + 3 ] = 1.0f;
+      for ( auto &c : channels ) {
+        for ( int x = 0; x < width; x++ ) {
+          float v;
+          if ( c.type == EXR_HALF ) {
+            uint16_t h;
+            memcpy( &h, p, 2 );
+            v = glm::unpackHalf1x16( h );
+            p += 2;
+          } else if ( c.type == EXR_FLOAT ) {
+            memcpy( &v, p, 4 );
+            p += 4;
+          } else {
+            uint32_t u;
+            memcpy( &u, p, 4 );
+            v = float( u );
+            p += 4;
+          }
+          if ( c.slot >= 0 ) row[ x * 4 + c.slot ] = v;
+        }
+      }
+    }
+    return true;
+  }
+
+private:
+  struct channel { std::string name; int type; int slot; };
+  std::vector< channel > channels;
+  std::vector< uint64_t > offsets;
+  std::vector< uint8_t > cache;
+  std::ifstream file;
+  int originY = 0, linesPerChunk = 1, bytesPerPixel = 0, cachedChunk = -1;
+
+  bool fail( const std::string &message ) { error = message; return false; }
+
+  std::string readString() {
+    std::string s;
+    char c;
+    while ( file.get( c ) && c ) s += c;
+    return s;
+  }
+
+  bool loadChunk( int chunk ) {
+    int lines = std::min( linesPerChunk, height - chunk * linesPerChunk );
+    size_t rawSize = size_t( lines ) * width * bytesPerPixel;
+    int32_t chunkHeader[ 2 ];
+    file.seekg( offsets[ chunk ] );
+    file.read( ( char * ) chunkHeader, sizeof( chunkHeader ) );
+    if ( !file || chunkHeader[ 0 ] - originY != chunk * linesPerChunk ) return fail( "bad chunk" );
+    std::vector< uint8_t > data( chunkHeader[ 1 ] );
+    file.read( ( char * ) data.data(), data.size() );
+    if ( !file ) return fail( "truncated chunk" );
+
+    if ( data.size() == rawSize ) { // stored
+      cache = std::move( data );
+    } else { // undo zlib, then the delta, then the even / odd split
+      std::vector< uint8_t > shuffled( rawSize );
+      uLongf size = rawSize;
+      if ( uncompress( shuffled.data(), &size, data.data(), data.size() ) != Z_OK || size != rawSize )
+        return fail( "corrupt chunk" );
+      for ( size_t i = 1; i < rawSize; i++ )
+        shuffled[ i ] = uint8_t( int( shuffled[ i - 1 ] ) + int( shuffled[ i ] ) - 128 );
+      cache.resize( rawSize );
+      size_t half = ( rawSize + 1 ) / 2;
+      for ( size_t i = 0; i < rawSize; i++ )
+        cache[ i ] = shuffled[ ( i & 1 ) ? half + i / 2 : i / 2 ];
+    }
+    cachedChunk = chunk;
+    return true;
+  }
+};
+
+// radiance from <name>.pfm, sample counts from <name>.samples.pfm next to it - without the companion,
+// every pixel counts as one sample
+class pfmReader : public floatImageReader {
+public:
+  bool open( const std::string &filename ) {
+    if ( !openChannel( filename, radiance, 3 ) ) return false;
+    std::string base = filename.substr( 0, filename.size() - 4 );
+    if ( std::ifstream( base + ".samples.pfm" ).good() && !openChannel( base + ".samples.pfm", samples, 1 ) )
+      return false;
+    return true;
+  }
+
+  bool readLines( int y, int count, float *rgba ) override {
+    std::vector< float > row( width * 3 );
+    for ( int line = y; line < y + count; line++ ) {
+      float *out = rgba + size_t( line - y ) * width * 4;
+      int fileRow = height - 1 - line; // PFM rows run bottom to top
+      if ( !readRow( radiance, fileRow, row.data() ) ) return false;
+      for ( int x = 0; x < width; x++ ) {
+        out[ x * 4 + 0 ] = row[ x * 3 + 0 ];
+        out[ x * 4 + 1 ] = row[ x * 3 + 1 ];
+        out[ x * 4 + 2 ] = row[ x * 3 + 2 ];
+        out[ x * 4 + 3 ] = 1.0f;
+      }
+      if ( samples.file.is_open() ) {
+        if ( !readRow( samples, fileRow, row.data() ) ) return false;
+        for ( int x = 0; x < width; x++ )
+          out[ x * 4 + 3 ] = row[ x ];
+      }
+    }
+    return true;
+  }
+
+private:
+  struct channelFile {
+    std::ifstream file;
+    std::streamoff dataStart = 0;
+    int components = 3;
+    bool bigEndian = false;
+  };
+  channelFile radiance, samples;
+
+  bool openChannel( const std::string &filename, channelFile &c, int components ) {
+    c.file.open( filename, std::ios::binary );
+    std::string type;
+    int w = 0, h = 0;
+    float scale = 0.0f;
+    c.file >> type >> w >> h >> scale;
+    c.file.get(); // single whitespace before the data
+    if ( !c.file || type != ( components == 3 ? "PF" : "Pf" ) ) { error = filename + " isn't a " + ( components == 3 ? "color" : "greyscale" ) + " PFM"; return false; }
+    if ( components == 3 ) { width = w; height = h; }
+    else if ( w != width || h != height ) { error = filename + " doesn't match its radiance file"; return false; }
+    c.dataStart = c.file.tellg();
+    c.components = components;
+    c.bigEndian = scale > 0.0f;
+    return true;
+  }
+
+  bool readRow( channelFile &c, int row, float *out ) {
+    c.file.seekg( c.dataStart + std::streamoff( row ) * width * c.components * sizeof( float ) );
+    c.file.read( ( char * ) out, size_t( width ) * c.components * sizeof( float ) );
+    if ( c.bigEndian )
+      for ( int i = 0; i < width * c.components; i++ ) {
+        uint8_t *b = ( uint8_t * ) &out[ i ];
+        std::swap( b[ 0 ], b[ 3 ] );
+        std::swap( b[ 1 ], b[ 2 ] );
+      }
+    if ( !c.file ) { error = "truncated PFM"; return false; }
+    return true;
+  }
+};
+
+// picks the reader by extension, null with a message on failure
+inline std::unique_ptr< floatImageReader > openFloatImage( const std::string &filename, std::string &error ) {
+  std::string extension = filename.size() > 4 ? filename.substr( filename.size() - 4 ) : "";
+  if ( extension == ".exr" ) {
+    auto reader = std::make_unique< exrReader >();
+    if ( reader->open( filename ) ) return reader;
+    error = reader->error;
+  } else if ( extension == ".pfm" ) {
+    auto reader = std::make_unique< pfmReader >();
+    if ( reader->open( filename ) ) return reader;
+    error = reader->error;
+  } else {
+    error = filename + " - expected .exr or .pfm";
+  }
+  return nullptr;
+}
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef GL_EXTENSIONS_H
+#define GL_EXTENSIONS_H
+
+// the bundled gl3w loader stops at OpenGL 4.3 - entry points from later versions that the engine
+// uses are declared and loaded here, in the same style, after gl3wInit() has run
+
+#include "../ocornut_imgui/gl3w.h"
+
+// OpenGL 4.4 - ARB_buffer_storage
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT                 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT                   0x0080
+#endif
+#ifndef GL_CLIENT_MAPPED_BUFFER_BARRIER_BIT
+#define GL_CLIENT_MAPPED_BUFFER_BARRIER_BIT   0x00004000
+#endif
+
+typedef void ( APIENTRYP PFNENGINEBUFFERSTORAGEPROC )( GLenum target, GLsizeiptr size, const void *data, GLbitfield flags );
+inline PFNENGINEBUFFERSTORAGEPROC gl3wExtBufferStorage = nullptr;
+#define glBufferStorage gl3wExtBufferStorage
+
+// OpenGL 4.4 - ARB_clear_texture
+typedef void ( APIENTRYP PFNENGINECLEARTEXSUBIMAGEPROC )( GLuint texture, GLint level, GLint xoffset, GLint yoffset, GLint zoffset, GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void *data );
+inline PFNENGINECLEARTEXSUBIMAGEPROC gl3wExtClearTexSubImage = nullptr;
+#define glClearTexSubImage gl3wExtClearTexSubImage
+typedef void ( APIENTRYP PFNENGINECLEARTEXIMAGEPROC )( GLuint texture, GLint level, GLenum format, GLenum type, const void *data );
+inline PFNENGINECLEARTEXIMAGEPROC gl3wExtClearTexImage = nullptr;
+#define glClearTexImage gl3wExtClearTexImage
+
+// returns false if anything is missing - the caller reports it
+inline bool glExtensionsInit() {
+  bool complete = true;
+  auto load = [ &complete ]( const char *name ) {
+    void *proc = gl3wGetProcAddress( name );
+    if ( !proc ) {
+      std::cout << "Missing OpenGL entry point: " << name << std::endl;
+      complete = false;
+    }
+    return proc;
+  };
+
+  gl3wExtBufferStorage = ( PFNENGINEBUFFERSTORAGEPROC ) load( "glBufferStorage" );
+  gl3wExtClearTexSubImage = ( PFNENGINECLEARTEXSUBIMAGEPROC ) load( "glClearTexSubImage" );
+  gl3wExtClearTexImage = ( PFNENGINECLEARTEXIMAGEPROC ) load( "glClearTexImage" );
+
+  return complete;
+}
+
+#endif
@@ -0,0 +1,133 @@
+#ifndef IMAGE_WRITER_H
+#define IMAGE_WRITER_H
+
+// background image encoding - the main thread hands off pixels read back from the GPU, and a
+// worker thread flips, encodes and writes them to disk so rendering doesn't stall
+//  - PNG from the RGBA8 display image, float formats from the raw RGBA32F accumulator
+
+#include <condition_variable>
+#include <cstdint>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "png_parallel.h"
+#include "float_image.h"
+
+enum imageFormat { IMAGE_PNG = 0, IMAGE_PFM = 1, IMAGE_EXR = 2 };
+
+struct imageWriteJob {
+  std::string filename;
+  int width;
+  int height;
+  imageFormat format = IMAGE_PNG;
+  std::vector< uint8_t > pixels;  // PNG - RGBA8, bottom row first as it comes from OpenGL
+  std::vector< float > radiance;  // PFM/EXR - RGBA32F, sample count in alpha, also bottom row first
+  pngPreset preset = PNG_FAST;
+  bool halfFloat = false;         // EXR only
+  bool zip = true;                // EXR only
+  std::function< bool() > task;   // anything else that should stay off the main thread, replaces the above
+};
+
+class imageWriter {
+public:
+  imageWriter() : worker( &imageWriter::run, this ) {}
+  ~imageWriter() {
+    { // finish anything still queued, then stop
+      std::lock_guard< std::mutex > lock( queueMutex );
+      quit = true;
+    }
+    queueCondition.notify_all();
+    worker.join();
+  }
+
+  void push( imageWriteJob &&job ) {
+    {
+      std::lock_guard< std::mutex > lock( queueMutex );
+      jobs.push_back( std::move( job ) );
+    }
+    queueCondition.notify_one();
+  }
+
+  size_t pending() {
+    std::lock_guard< std::mutex > lock( queueMutex );
+    return jobs.size() + ( busy ? 1 : 0 );
+  }
+
+  // block until everything queued so far is on disk
+  void finish() {
+    std::unique_lock< std::mutex > lock( queueMutex );
+    idleCondition.wait( lock, [ this ]{ return jobs.empty() && !busy; } );
+  }
+
+private:
+  void run() {
+    while ( true ) {
+      imageWriteJob job;
+      {
+        std::unique_lock< std::mutex > lock( queueMutex );
+        queueCondition.wait( lock, [ this ]{ return quit || !jobs.empty(); } );
+        if ( jobs.empty() ) return; // quit, and nothing left to write
+        job = std::move( jobs.front() );
+        jobs.pop_front();
+        busy = true;
+      }
+      write( job );
+      {
+        std::lock_guard< std::mutex > lock( queueMutex );
+        busy = false;
+      }
+      idleCondition.notify_all();
+    }
+  }
+
+  void write( imageWriteJob &job ) {
+    auto start = std::chrono::steady_clock::now();
+    bool ok = false;
+    if ( job.task )
+      ok = job.task();
+    else switch ( job.format ) {
+      case IMAGE_PNG: ok = writePNG( job ); break;
+      case IMAGE_PFM: ok = writePFM( job.filename, job.radiance.data(), job.width, job.height ); break;
+      case IMAGE_EXR: ok = writeEXR( job.filename, job.radiance.data(), job.width, job.height, job.halfFloat, job.zip ); break;
+    }
+    float ms = std::chrono::duration< float, std::milli >( std::chrono::steady_clock::now() - start ).count();
+    if ( !ok )
+      std::cout << "Image writer - failed to write " << job.filename << std::endl;
+    else
+      std::cout << "Image writer - saved " << job.filename << " in " << ms << "ms" << std::endl;
+  }
+
+  bool writePNG( imageWriteJob &job ) {
+    // OpenGL puts the origin at the bottom left, image files at the top left
+    size_t rowBytes = job.width * 4;
+    std::vector< uint8_t > row( rowBytes );
+    for ( int y = 0; y < job.height / 2; y++ ) {
+      uint8_t *top = &job.pixels[ y * rowBytes ];
+      uint8_t *bottom = &job.pixels[ ( job.height - 1 - y ) * rowBytes ];
+      memcpy( row.data(), top, rowBytes );
+      memcpy( top, bottom, rowBytes );
+      memcpy( bottom, row.data(), rowBytes );
+    }
+
+    return encodePNGParallel( job.filename, job.pixels.data(), job.width, job.height, job.preset );
+  }
+
+  std::mutex queueMutex;
+  std::condition_variable queueCondition;
+  std::condition_variable idleCondition;
+  std::deque< imageWriteJob > jobs;
+  bool quit = false;
+  bool busy = false;
+
+  // declared last, so everything above is constructed before the thread starts
+  std::thread worker;
+};
+
+#endif
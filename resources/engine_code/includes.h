@@ -5,15 +5,19 @@
 
 // stl includes
 #include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <cmath>
 #include <cstdint>
 #include <cstdlib>
 #include <ctime>
 #include <deque>
+#include <filesystem>
 #include <fstream>
+#include <functional>
 #include <iomanip>
 #include <iostream>
+#include <memory>
 #include <numeric>
 #include <random>
 #include <sstream>
@@ -41,6 +45,7 @@ constexpr int MSAACount = 1;
 #include "../glm/gtc/type_ptr.hpp"         //to send matricies gpu-side
 #include "../glm/gtx/rotate_vector.hpp"
 #include "../glm/gtx/transform.hpp"
+#include "../glm/gtc/quaternion.hpp"
 
 // not sure as to the utility of this
 #define GLX_GLEXT_PROTOTYPES
@@ -58,9 +63,27 @@ constexpr int MSAACount = 1;
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_opengl.h>
 
+// OpenGL 4.4+ entry points the bundled loader doesn't cover
+#include "gl_extensions.h"
+
 // png loading library - very powerful
 #include "../lodev_lodePNG/lodepng.h"
 
+// background image encoding - parallel deflate PNG screenshots, PFM/EXR accumulator dumps
+#include "image_writer.h"
+
+// coordinator / worker protocol for distributed rendering
+#include "distributed.h"
+
+// CPU / GPU frame timing scopes, rolling history for the profiler window
+#include "profiler.h"
+
+// baked blue noise bank, mapped at startup and uploaded as a 2D array texture
+#include "blue_noise.h"
+
+// CPU mirror of the path tracer sampler - Owen scrambled Sobol and its blue noise ranked variant
+#include "sampler.h"
+
 // wrapper for TinyOBJLoader
 #include "../TinyOBJLoader/objLoader.h"
 
@@ -70,11 +93,19 @@ constexpr int MSAACount = 1;
 // coloring of CLI output
 #include "colors.h"
 
+// validated numbers from the command line, shared with the tools
+#include "arguments.h"
+
 // diamond square heightmap generation
 #include "../mafford_diamond_square/diamond_square.h"
 
 // Brent Werness' Voxel Automata Terrain
 #include "../VAT/VAT.h"
+#include "vat_field.h"
+#include "vat_tree.h"
+
+// tonemap curves + Oklab, baked into postprocess LUTs
+#include "tonemap.h"
 
 // Niels Lohmann - JSON for Modern C++
 #include "../nlohmann_JSON/json.hpp"
@@ -91,45 +122,153 @@ using json = nlohmann::json;
 
 
 struct coreParameters {
-  glm::ivec2 tileOffset;
-  glm::ivec2 noiseOffset; // update once a frame, offset blue noise read
+  glm::ivec2 tileOffset = glm::ivec2( 0 );
+  glm::ivec2 noiseOffset = glm::ivec2( 0 ); // update once a frame, offset blue noise read
   int maxSteps = 300;
   int maxBounces = 10;
   float maxDistance = 5.;
   float epsilon = 0.001;
   float exposure = 1.0;
-  float focusDistance;
+  float focusDistance = 1.0;
   int normalMethod = 0;
+  int sampler = int( samplerMode::sobolRanked ); // see sampler.h
   float FoV = 0.152;
-  glm::vec3 basicDiffuse;
-  glm::vec3 viewerPosition;
+  glm::vec3 basicDiffuse = glm::vec3( 0.5 );
+  glm::vec3 viewerPosition = glm::vec3( 0. );
   float rotationAboutX = 0.;
   float rotationAboutY = 0.;
   float rotationAboutZ = 0.;
   // calculated from the above 3 params
-  glm::vec3 basisX;
-  glm::vec3 basisY;
-  glm::vec3 basisZ;
+  glm::vec3 basisX = glm::vec3( 1., 0., 0. );
+  glm::vec3 basisY = glm::vec3( 0., 1., 0. );
+  glm::vec3 basisZ = glm::vec3( 0., 0., 1. );
+};
+
+struct reprojectParameters {
+  bool enable = true;          // when false, camera motion clears the accumulator
+  int maxHistory = 32;         // cap on the sample count carried through a camera move
+  float depthRejection = 0.1;  // relative depth difference treated as a disocclusion
 };
 
 struct lensParameters {
-  float lensScaleFactor;
-  float lensRadius1;
-  float lensRadius2;
-  float lensThickness;
-  float lensRotate;
-  float lensIOR;
+  float lensScaleFactor = 1.0;
+  float lensRadius1 = 0.0;
+  float lensRadius2 = 0.0;
+  float lensThickness = 0.0;
+  float lensRotate = 0.0;
+  float lensIOR = 1.5;
+};
+
+struct denoiseParameters {
+  bool enable = false;         // off by default - it filters the whole frame, every frame
+  int passes = 5;              // each pass doubles the tap spacing
+  float strength = 1.0;
+  float falloff = 16.;         // sample count at which strength has halved
+  float sigmaNormal = 64.;
+  float sigmaDepth = 1.0;
+  float sigmaLuminance = 4.0;
+};
+
+struct exportParameters {
+  int pngPreset = PNG_FAST;     // screenshot compression, fast or best
+  int floatFormat = IMAGE_EXR;  // accumulator dumps, PFM or EXR
+  bool halfFloat = false;       // EXR radiance as half, sample count stays full float
+  bool zip = true;              // EXR ZIP compression
 };
 
 struct postParameters {
-  int ditherMode;
-  int ditherMethod;
-  int ditherPattern;
-  int tonemapMode;
-  int depthMode;
-  float depthScale;
+  int ditherMode = 0;     // 0 none, 1 per channel quantize, 2 Oklab palette
+  int ditherMethod = 0;   // 0 ordered, 1 blue noise, 2 error diffusion
+  int ditherPattern = 2;  // Bayer matrix is 2^( pattern + 1 ) on a side
+  int ditherLevels = 8;   // levels per channel, for per channel quantize
+  int tonemapMode = 1;    // 0 none, 1 ACES, 2 AgX, 3 Reinhard
+  int depthMode = 0;
+  float depthScale = 1.0;
 };
 
+// distance cache for static scenes, see engine_cache.cc - sizes in world units
+struct cacheParameters {
+  bool enable = false;
+  bool fitToScene = true;                          // region from the scene's bounds, when it has them
+  glm::vec3 regionMin = glm::vec3( -4.0f );
+  glm::vec3 regionMax = glm::vec3( 4.0f );
+  float cellSize = 0.02f;                          // between samples, a brick spans 8 cells
+  float band = 2.0f;                               // cells of margin around the surface that get bricks
+  int atlasBricks = 16;                            // on a side of the atlas, cube of it is the capacity
+  int classifyPerFrame = 65536;                    // bricks classified per frame while baking
+  int fillPerFrame = 128;                          // bricks filled per frame while baking
+  float fallbackEpsilons = 4.0f;                   // analytic de() under this many epsilon from a surface
+};
+
+// voxel automata terrain, generated on request and traced through its distance field, see engine_vat.cc
+struct vatParameters {
+  bool enable = false;
+  int levels = 7;                                  // 2^levels + 1 cells on a side
+  float flip = 0.0f;                               // chance of a filled cell flipping state
+  char rule[ 128 ] = "r";                          // "r" random, "i" random Ising, otherwise a short rule
+  int initMode = 3;                                // fill for the seeded faces, 3 is random
+  float lambda = 0.35f;                            // random rule density
+  float beta = 0.5f;                               // Ising rule parameters
+  float mag = 0.0f;
+  glm::bvec3 minimums = glm::bvec3( false, true, false ); // faces seeded before the automaton runs
+  glm::bvec3 maximums = glm::bvec3( false );
+  glm::vec3 position = glm::vec3( -2.0f );         // corner of the volume
+  float extent = 4.0f;                             // edge length of the volume, world units
+  glm::ivec2 materials = glm::ivec2( 0 );          // scene material for states 1 and 2
+  bool cpuField = false;                           // exact EDT on the CPU instead of the GPU jump flood
+  int traversal = 0;                               // 0 marches the distance field, 1 casts rays against the 64-tree
+};
+
+struct checkpointParameters {
+  bool enable = true;
+  float interval = 300.;                           // seconds between automatic checkpoints
+  std::string directory = "checkpoints";
+};
+
+// command line options, parsed in main.cc
+struct launchParameters {
+  bool resume = false;                             // --resume, reload the checkpoint and keep accumulating
+  std::string checkpointDirectory = "checkpoints"; // --checkpoint-dir <path>
+  int coordinatorPort = 0;                         // --coordinator <port>, hand out work instead of rendering
+  std::string workerAddress;                       // --worker <host:port>, render work for a coordinator
+  int localWorkers = 0;                            // --local-workers <n>, coordinator starts n workers here
+  int targetSamples = 256;                         // --spp <n>, coordinator's samples per pixel goal
+  int samplesPerUnit = 8;                          // --unit-spp <n>, samples in one work unit
+  bool stats = false;                              // --stats, path tracer counters, rates printed once a second
+  std::string benchConfig;                         // --bench <scenes.json>, headless benchmark run
+  std::string benchOutput = "bench.json";          // --bench-out <path>, results
+  std::string benchBaseline;                       // --baseline <path>, results to compare against
+  float benchThreshold = 0.1f;                     // --threshold <x>, fractional slowdown counted as a regression
+  std::string sceneFile;                           // --scene <path>, scene description to load, see scene.h
+  uint32_t seed = 0;                               // --seed <n>, offsets sample indices and reseeds the hash RNG, so separate renders can be merged
+};
+
+// sample indices each --seed is given, far more than any one render takes
+constexpr uint32_t seedStride = 1u << 20;
+
+// JSON round trips for the parameter structs - glm types as arrays
+namespace glm {
+  inline void to_json( json &j, const vec3 &v ) { j = { v.x, v.y, v.z }; }
+  inline void from_json( const json &j, vec3 &v ) { v = vec3( j.at( 0 ).get< float >(), j.at( 1 ).get< float >(), j.at( 2 ).get< float >() ); }
+  inline void to_json( json &j, const vec4 &v ) { j = { v.x, v.y, v.z, v.w }; }
+  inline void from_json( const json &j, vec4 &v ) { v = vec4( j.at( 0 ).get< float >(), j.at( 1 ).get< float >(), j.at( 2 ).get< float >(), j.at( 3 ).get< float >() ); }
+  inline void to_json( json &j, const ivec2 &v ) { j = { v.x, v.y }; }
+  inline void from_json( const json &j, ivec2 &v ) { v = ivec2( j.at( 0 ).get< int >(), j.at( 1 ).get< int >() ); }
+}
+
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE( coreParameters, maxSteps, maxBounces, maxDistance, epsilon, exposure, focusDistance,
+  normalMethod, sampler, FoV, basicDiffuse, viewerPosition, rotationAboutX, rotationAboutY, rotationAboutZ )
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE( reprojectParameters, enable, maxHistory, depthRejection )
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE( lensParameters, lensScaleFactor, lensRadius1, lensRadius2, lensThickness, lensRotate, lensIOR )
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE( denoiseParameters, enable, passes, strength, falloff, sigmaNormal, sigmaDepth, sigmaLuminance )
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE( postParameters, ditherMode, ditherMethod, ditherPattern, ditherLevels, tonemapMode, depthMode, depthScale )
+
+// scene files, over the parameter structs above
+#include "scene.h"
+
+// scene node trees to GLSL
+#include "sdf_compiler.h"
+
 
 
 
@@ -1,7 +1,70 @@
 #include "engine.h"
 
+static void usage() {
+  cout << "usage: exe [options]" << endl
+       << "  --resume                 reload the checkpoint and keep accumulating" << endl
+       << "  --checkpoint-dir <path>  where checkpoints go ( default checkpoints )" << endl
+       << "  --scene <path>           scene description to load" << endl
+       << "  --seed <n>               offsets sample indices so separate renders can be merged, 0 to " << ( 0xFFFFFFFFu / seedStride ) << endl
+       << "  --coordinator <port>     hand out work instead of rendering" << endl
+       << "  --worker <host:port>     render work for a coordinator" << endl
+       << "  --local-workers <n>      coordinator starts n workers here" << endl
+       << "  --spp <n>                coordinator's samples per pixel goal" << endl
+       << "  --unit-spp <n>           samples in one work unit" << endl
+       << "  --stats                  path tracer counters, printed once a second" << endl
+       << "  --bench <scenes.json>    headless benchmark run" << endl
+       << "  --bench-out <path>       benchmark results ( default bench.json )" << endl
+       << "  --baseline <path>        benchmark results to compare against" << endl
+       << "  --threshold <x>          fractional slowdown counted as a regression" << endl;
+}
+
+static launchParameters parseArguments( int argc, char *argv[] ) {
+  launchParameters launch;
+  for ( int i = 1; i < argc; i++ ) {
+    std::string argument = argv[ i ];
+    if ( argument == "--resume" )
+      launch.resume = true;
+    else if ( argument == "--checkpoint-dir" && i + 1 < argc )
+      launch.checkpointDirectory = argv[ ++i ];
+    else if ( argument == "--coordinator" && i + 1 < argc )
+      launch.coordinatorPort = numericArgument( argument, argv[ ++i ], 1, 65535, usage );
+    else if ( argument == "--worker" && i + 1 < argc )
+      launch.workerAddress = argv[ ++i ];
+    else if ( argument == "--local-workers" && i + 1 < argc )
+      launch.localWorkers = numericArgument( argument, argv[ ++i ], 0, 256, usage );
+    else if ( argument == "--spp" && i + 1 < argc )
+      launch.targetSamples = numericArgument( argument, argv[ ++i ], 1, 1 << 20, usage );
+    else if ( argument == "--unit-spp" && i + 1 < argc )
+      launch.samplesPerUnit = numericArgument( argument, argv[ ++i ], 1, 1 << 16, usage );
+    else if ( argument == "--stats" )
+      launch.stats = true;
+    else if ( argument == "--bench" && i + 1 < argc )
+      launch.benchConfig = argv[ ++i ];
+    else if ( argument == "--bench-out" && i + 1 < argc )
+      launch.benchOutput = argv[ ++i ];
+    else if ( argument == "--baseline" && i + 1 < argc )
+      launch.benchBaseline = argv[ ++i ];
+    else if ( argument == "--threshold" && i + 1 < argc )
+      launch.benchThreshold = numericArgument( argument, argv[ ++i ], 0.0f, 100.0f, usage );
+    else if ( argument == "--scene" && i + 1 < argc )
+      launch.sceneFile = argv[ ++i ];
+    else if ( argument == "--seed" && i + 1 < argc )
+      launch.seed = numericArgument( argument, argv[ ++i ], 0u, 0xFFFFFFFFu / seedStride, usage ); // past that, seeds wrap onto earlier ones
+    else if ( argument == "-h" || argument == "--help" ) {
+      usage();
+      exit( 0 );
+    } else
+      cout << "Unrecognized argument: " << argument << endl;
+  }
+  return launch;
+}
+
 int main( int argc, char *argv[] ) {
-  engine e;
+  launchParameters launch = parseArguments( argc, argv );
+  engine e( launch );
+
+  if ( !launch.benchConfig.empty() )
+    return e.benchmark();
 
   while( e.mainLoop() );
 
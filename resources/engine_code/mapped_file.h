@@ -0,0 +1,52 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+// read only memory mapping of a whole file - for the flat binary formats ( blue noise bank, scene cache )
+// that are used in place instead of being parsed
+
+#include <cstdint>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+class mappedFile {
+public:
+  const uint8_t *data = nullptr;
+  size_t size = 0;
+  std::string error;
+
+  mappedFile() = default;
+  mappedFile( const mappedFile & ) = delete;
+  mappedFile &operator=( const mappedFile & ) = delete;
+  ~mappedFile() { close(); }
+
+  bool open( const std::string &filename ) {
+    close();
+    int fd = ::open( filename.c_str(), O_RDONLY );
+    if ( fd < 0 ) { error = "can't open " + filename; return false; }
+    struct stat info;
+    if ( fstat( fd, &info ) != 0 || info.st_size == 0 ) {
+      ::close( fd );
+      error = filename + " is empty";
+      return false;
+    }
+    void *mapping = mmap( nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    ::close( fd ); // the mapping holds its own reference
+    if ( mapping == MAP_FAILED ) { error = "can't map " + filename; return false; }
+    data = ( const uint8_t * ) mapping;
+    size = info.st_size;
+    madvise( mapping, size, MADV_SEQUENTIAL );
+    return true;
+  }
+
+  void close() {
+    if ( data ) munmap( ( void * ) data, size );
+    data = nullptr;
+    size = 0;
+  }
+};
+
+#endif
@@ -0,0 +1,258 @@
+#ifndef PNG_PARALLEL_H
+#define PNG_PARALLEL_H
+
+// multithreaded PNG encoder for large exports, where lodepng's single threaded deflate is the bottleneck
+//  - scanline filters are chosen per row in parallel, minimum sum of absolute differences heuristic
+//  - the filtered image is cut into strips, each deflated on its own thread as raw deflate data ending
+//    in a sync flush, so the pieces are byte aligned and concatenate into one valid stream ( pigz style )
+//  - each strip is primed with the last 32k of the one before it, so matches still reach across the cut
+//  - per strip adler32s are combined in order for the zlib trailer
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <zlib.h>
+
+#if defined( __SSE2__ )
+#include <emmintrin.h>
+#endif
+
+enum pngPreset { PNG_FAST = 0, PNG_BEST = 1 };
+
+// run fn( index, thread ) for index in [0,count), indices handed out dynamically
+template < typename T >
+inline void pngParallelFor( int count, int threads, T fn ) {
+  std::atomic< int > next( 0 );
+  auto work = [ & ]( int thread ) {
+    for ( int i = next++; i < count; i = next++ )
+      fn( i, thread );
+  };
+  std::vector< std::thread > pool;
+  for ( int t = 1; t < threads; t++ )
+    pool.emplace_back( work, t );
+  work( 0 );
+  for ( auto &t : pool )
+    t.join();
+}
+
+inline uint8_t pngPaeth( int a, int b, int c ) {
+  int pa = std::abs( b - c ), pb = std::abs( a - c ), pc = std::abs( a + b - 2 * c );
+  return ( pa <= pb && pa <= pc ) ? a : ( pb <= pc ? b : c );
+}
+
+// all five filter types for bytes [begin,end) of a row, accumulating the cost of each - filtered bytes
+// are read as signed, so the cost of a byte is its distance from zero mod 256
+inline void pngFilterScalar( const uint8_t *cur, const uint8_t *prev, uint8_t *out[ 5 ], uint64_t cost[ 5 ], size_t begin, size_t end ) {
+  for ( size_t i = begin; i < end; i++ ) {
+    int x = cur[ i ], b = prev[ i ];
+    int a = i >= 4 ? cur[ i - 4 ] : 0;
+    int c = i >= 4 ? prev[ i - 4 ] : 0;
+    uint8_t f[ 5 ] = { uint8_t( x ), uint8_t( x - a ), uint8_t( x - b ), uint8_t( x - ( ( a + b ) >> 1 ) ), uint8_t( x - pngPaeth( a, b, c ) ) };
+    for ( int t = 0; t < 5; t++ ) {
+      out[ t ][ i ] = f[ t ];
+      cost[ t ] += f[ t ] < 128 ? f[ t ] : 256 - f[ t ];
+    }
+  }
+}
+
+#if defined( __SSE2__ )
+// paeth predictor on 8 pixels' worth of channels, widened to 16 bits
+inline __m128i pngPaethSSE2( __m128i a, __m128i b, __m128i c ) {
+  const __m128i zero = _mm_setzero_si128();
+  auto absolute = [ & ]( __m128i v ) { return _mm_max_epi16( v, _mm_sub_epi16( zero, v ) ); };
+  __m128i pa = absolute( _mm_sub_epi16( b, c ) );
+  __m128i pb = absolute( _mm_sub_epi16( a, c ) );
+  __m128i pc = absolute( _mm_sub_epi16( _mm_add_epi16( a, b ), _mm_add_epi16( c, c ) ) );
+  __m128i pickA = _mm_andnot_si128( _mm_or_si128( _mm_cmpgt_epi16( pa, pb ), _mm_cmpgt_epi16( pa, pc ) ), _mm_set1_epi16( -1 ) );
+  __m128i pickB = _mm_cmpgt_epi16( pb, pc ); // set where c wins over b
+  __m128i bc = _mm_or_si128( _mm_and_si128( pickB, c ), _mm_andnot_si128( pickB, b ) );
+  return _mm_or_si128( _mm_and_si128( pickA, a ), _mm_andnot_si128( pickA, bc ) );
+}
+
+// same as the scalar path, 16 bytes at a time - needs begin >= 4 and ( end - begin ) a multiple of 16
+inline void pngFilterSSE2( const uint8_t *cur, const uint8_t *prev, uint8_t *out[ 5 ], uint64_t cost[ 5 ], size_t begin, size_t end ) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i one = _mm_set1_epi8( 1 );
+  __m128i sums[ 5 ] = { zero, zero, zero, zero, zero };
+  for ( size_t i = begin; i < end; i += 16 ) {
+    __m128i x = _mm_loadu_si128( ( const __m128i * ) ( cur + i ) );
+    __m128i a = _mm_loadu_si128( ( const __m128i * ) ( cur + i - 4 ) );
+    __m128i b = _mm_loadu_si128( ( const __m128i * ) ( prev + i ) );
+    __m128i c = _mm_loadu_si128( ( const __m128i * ) ( prev + i - 4 ) );
+
+    // _mm_avg_epu8 rounds up, the filter wants floor
+    __m128i average = _mm_sub_epi8( _mm_avg_epu8( a, b ), _mm_and_si128( _mm_xor_si128( a, b ), one ) );
+    __m128i paeth = _mm_packus_epi16(
+      pngPaethSSE2( _mm_unpacklo_epi8( a, zero ), _mm_unpacklo_epi8( b, zero ), _mm_unpacklo_epi8( c, zero ) ),
+      pngPaethSSE2( _mm_unpackhi_epi8( a, zero ), _mm_unpackhi_epi8( b, zero ), _mm_unpackhi_epi8( c, zero ) ) );
+
+    __m128i f[ 5 ] = { x, _mm_sub_epi8( x, a ), _mm_sub_epi8( x, b ), _mm_sub_epi8( x, average ), _mm_sub_epi8( x, paeth ) };
+    for ( int t = 0; t < 5; t++ ) {
+      _mm_storeu_si128( ( __m128i * ) ( out[ t ] + i ), f[ t ] );
+      __m128i magnitude = _mm_min_epu8( f[ t ], _mm_sub_epi8( zero, f[ t ] ) );
+      sums[ t ] = _mm_add_epi64( sums[ t ], _mm_sad_epu8( magnitude, zero ) );
+    }
+  }
+  for ( int t = 0; t < 5; t++ ) {
+    uint64_t lanes[ 2 ];
+    _mm_storeu_si128( ( __m128i * ) lanes, sums[ t ] );
+    cost[ t ] += lanes[ 0 ] + lanes[ 1 ];
+  }
+}
+#endif
+
+// filter one RGBA8 row into dst, which gets the filter type byte followed by the filtered bytes
+inline void pngFilterRow( const uint8_t *cur, const uint8_t *prev, size_t rowBytes, uint8_t *scratch, uint8_t *dst ) {
+  uint8_t *out[ 5 ];
+  for ( int t = 0; t < 5; t++ )
+    out[ t ] = scratch + t * rowBytes;
+  uint64_t cost[ 5 ] = { 0, 0, 0, 0, 0 };
+
+#if defined( __SSE2__ )
+  // first pixels go scalar, so the vector loop can always read a full pixel to the left
+  size_t head = std::min< size_t >( 16, rowBytes );
+  size_t body = head + ( ( rowBytes - head ) & ~size_t( 15 ) );
+  pngFilterScalar( cur, prev, out, cost, 0, head );
+  pngFilterSSE2( cur, prev, out, cost, head, body );
+  pngFilterScalar( cur, prev, out, cost, body, rowBytes );
+#else
+  pngFilterScalar( cur, prev, out, cost, 0, rowBytes );
+#endif
+
+  int best = int( std::min_element( cost, cost + 5 ) - cost );
+  dst[ 0 ] = uint8_t( best );
+  memcpy( dst + 1, out[ best ], rowBytes );
+}
+
+// raw deflate of one strip, ending in a sync flush, or finishing the stream for the last one
+inline bool pngDeflateStrip( const uint8_t *data, size_t begin, size_t end, bool last, int level, std::vector< uint8_t > &out, size_t reserved ) {
+  z_stream stream;
+  memset( &stream, 0, sizeof( stream ) );
+  if ( deflateInit2( &stream, level, Z_DEFLATED, -15, 9, Z_DEFAULT_STRATEGY ) != Z_OK )
+    return false;
+
+  // prime the window with the end of the previous strip
+  size_t dictionary = std::min< size_t >( begin, 32768 );
+  if ( dictionary )
+    deflateSetDictionary( &stream, data + begin - dictionary, dictionary );
+
+  out.resize( reserved + deflateBound( &stream, end - begin ) + 64 );
+  stream.next_in = const_cast< uint8_t * >( data + begin );
+  stream.avail_in = end - begin;
+  stream.next_out = out.data() + reserved;
+  stream.avail_out = out.size() - reserved;
+
+  bool ok = true;
+  while ( true ) {
+    int result = deflate( &stream, last ? Z_FINISH : Z_SYNC_FLUSH );
+    if ( result == Z_STREAM_ERROR ) { ok = false; break; }
+    if ( last ? result == Z_STREAM_END : ( stream.avail_in == 0 && stream.avail_out > 0 ) ) break;
+
+    // ran out of room, grow and keep going
+    size_t produced = out.size() - stream.avail_out;
+    out.resize( out.size() * 2 );
+    stream.next_out = out.data() + produced;
+    stream.avail_out = out.size() - produced;
+  }
+  out.resize( out.size() - stream.avail_out );
+  deflateEnd( &stream );
+  return ok;
+}
+
+inline void pngPutU32( uint8_t *p, uint32_t v ) {
+  p[ 0 ] = v >> 24; p[ 1 ] = v >> 16; p[ 2 ] = v >> 8; p[ 3 ] = v;
+}
+
+inline void pngWriteChunk( std::ofstream &file, const char *type, const uint8_t *data, size_t length ) {
+  uint8_t header[ 8 ], footer[ 4 ];
+  pngPutU32( header, uint32_t( length ) );
+  memcpy( header + 4, type, 4 );
+  uint32_t crc = crc32( 0, header + 4, 4 );
+  if ( length ) crc = crc32( crc, data, length );
+  pngPutU32( footer, crc );
+  file.write( ( const char * ) header, 8 );
+  file.write( ( const char * ) data, length );
+  file.write( ( const char * ) footer, 4 );
+}
+
+// pixels are RGBA8, top row first - threads = 0 uses every hardware thread
+inline bool encodePNGParallel( const std::string &filename, const uint8_t *pixels, int width, int height, pngPreset preset = PNG_FAST, int threads = 0 ) {
+  if ( width <= 0 || height <= 0 ) return false;
+  if ( threads <= 0 ) threads = std::max( 1u, std::thread::hardware_concurrency() );
+
+  // filtering - rows are independent given the unfiltered row above
+  const size_t rowBytes = size_t( width ) * 4;
+  const size_t lineBytes = rowBytes + 1;
+  std::vector< uint8_t > filtered( lineBytes * height );
+  std::vector< std::vector< uint8_t > > scratch( threads, std::vector< uint8_t >( rowBytes * 5 ) );
+  const std::vector< uint8_t > zeroRow( rowBytes, 0 );
+  const int rowsPerTask = 16;
+  pngParallelFor( ( height + rowsPerTask - 1 ) / rowsPerTask, threads, [ & ]( int task, int thread ) {
+    int last = std::min( height, ( task + 1 ) * rowsPerTask );
+    for ( int y = task * rowsPerTask; y < last; y++ ) {
+      const uint8_t *prev = y ? pixels + ( y - 1 ) * rowBytes : zeroRow.data();
+      pngFilterRow( pixels + y * rowBytes, prev, rowBytes, scratch[ thread ].data(), filtered.data() + y * lineBytes );
+    }
+  });
+
+  // deflate - strips of whole rows, about 256k each, enough of them to keep every thread busy
+  const int level = preset == PNG_BEST ? 9 : 1;
+  int rowsPerStrip = std::max< int >( 1, int( ( 256 * 1024 ) / lineBytes ) );
+  int stripCount = ( height + rowsPerStrip - 1 ) / rowsPerStrip;
+  std::vector< std::vector< uint8_t > > strips( stripCount );
+  std::vector< uLong > adlers( stripCount );
+  std::atomic< bool > ok( true );
+  pngParallelFor( stripCount, threads, [ & ]( int strip, int ) {
+    size_t begin = size_t( strip ) * rowsPerStrip * lineBytes;
+    size_t end = std::min( filtered.size(), begin + size_t( rowsPerStrip ) * lineBytes );
+    bool last = strip == stripCount - 1;
+    // the first strip leaves room for the zlib header, the last for the adler32 trailer
+    if ( !pngDeflateStrip( filtered.data(), begin, end, last, level, strips[ strip ], strip == 0 ? 2 : 0 ) )
+      ok = false;
+    adlers[ strip ] = adler32( adler32( 0, Z_NULL, 0 ), filtered.data() + begin, end - begin );
+  });
+  if ( !ok ) return false;
+
+  // zlib header - FLEVEL is only informative, but matches the preset
+  strips.front()[ 0 ] = 0x78;
+  strips.front()[ 1 ] = preset == PNG_BEST ? 0xDA : 0x01;
+
+  uLong adler = adlers[ 0 ];
+  for ( int i = 1; i < stripCount; i++ ) {
+    size_t length = std::min( filtered.size() - size_t( i ) * rowsPerStrip * lineBytes, size_t( rowsPerStrip ) * lineBytes );
+    adler = adler32_combine( adler, adlers[ i ], length );
+  }
+  uint8_t trailer[ 4 ];
+  pngPutU32( trailer, uint32_t( adler ) );
+  strips.back().insert( strips.back().end(), trailer, trailer + 4 );
+
+  std::ofstream file( filename, std::ios::binary );
+  if ( !file ) return false;
+  const uint8_t signature[ 8 ] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+  file.write( ( const char * ) signature, 8 );
+
+  uint8_t IHDR[ 13 ];
+  pngPutU32( IHDR, width );
+  pngPutU32( IHDR + 4, height );
+  IHDR[ 8 ] = 8;  // bit depth
+  IHDR[ 9 ] = 6;  // RGBA
+  IHDR[ 10 ] = 0; // deflate
+  IHDR[ 11 ] = 0; // adaptive filtering
+  IHDR[ 12 ] = 0; // no interlace
+  pngWriteChunk( file, "IHDR", IHDR, 13 );
+
+  // one IDAT per strip - decoders treat consecutive IDATs as one stream
+  for ( auto &strip : strips )
+    pngWriteChunk( file, "IDAT", strip.data(), strip.size() );
+  pngWriteChunk( file, "IEND", nullptr, 0 );
+
+  return bool( file );
+}
+
+#endif
@@ -0,0 +1,175 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+// lightweight frame profiler - named scopes time the CPU side with std::chrono, and optionally the GPU
+// side with a pair of timestamp queries. Queries go into a ring of frames, and are only read back once
+// they're available, a couple frames later, so nothing waits on the GPU. Per frame counters ( tiles,
+// rays, ... ) are tracked the same way. Everything keeps a rolling history for graphs and averages.
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+class profiler {
+public:
+  static constexpr int historyLength = 240;
+  static constexpr int framesInFlight = 3;
+
+  struct series {
+    std::string name;
+    float history[ historyLength ] = {};
+    float current = 0.0f; // accumulating for this frame
+    double total = 0.0;   // running sum since the last resetTotals(), for long averages
+    uint64_t samples = 0;
+
+    void push( int offset, bool valid = true ) {
+      history[ offset ] = current;
+      if ( valid ) { total += current; samples++; } // dropped GPU results stay out of the long average
+      current = 0.0f;
+    }
+    float mean() const { return samples ? float( total / samples ) : 0.0f; }
+    float average() const {
+      float sum = 0.0f;
+      for ( float v : history ) sum += v;
+      return sum / historyLength;
+    }
+    float peak() const {
+      float m = 0.0f;
+      for ( float v : history ) m = std::max( m, v );
+      return m;
+    }
+  };
+
+  struct timer {
+    series cpu;  // ms
+    series gpu;  // ms, lags the CPU by up to framesInFlight frames
+    bool useGPU = true;
+  };
+
+  // RAII - timing runs from construction to destruction
+  class scope {
+  public:
+    scope( profiler &p, int index ) : p( p ), index( index ) { p.start( index ); }
+    ~scope() { p.stop( index ); }
+  private:
+    profiler &p;
+    int index;
+  };
+
+  scope time( const char *name, bool useGPU = true ) {
+    return scope( *this, timerIndex( name, useGPU ) );
+  }
+
+  // add to a per frame counter
+  void count( const char *name, float value ) {
+    for ( auto &c : counters )
+      if ( c.name == name ) { c.current += value; return; }
+    counters.push_back( series() );
+    counters.back().name = name;
+    counters.back().current = value;
+  }
+
+  // call once at the top of the frame - closes out the last frame's numbers, collects finished queries
+  void frameBegin() {
+    auto now = std::chrono::steady_clock::now();
+    if ( frame ) {
+      frameTime.current = std::chrono::duration< float, std::milli >( now - frameStart ).count();
+      frameTime.push( offset );
+      for ( auto &t : timers ) t.cpu.push( offset );
+      for ( auto &c : counters ) c.push( offset );
+      offset = ( offset + 1 ) % historyLength;
+    }
+    frameStart = now;
+    frame++;
+
+    // the slot about to be reused was written framesInFlight frames ago - take what's finished, drop
+    // anything that isn't rather than wait on it
+    frameSlot &slot = slots[ frame % framesInFlight ];
+    std::vector< bool > valid( timers.size(), false );
+    for ( auto &t : timers ) t.gpu.current = 0.0f;
+    for ( auto &p : slot.pending ) {
+      GLint available = 0;
+      glGetQueryObjectiv( slot.queries[ p.query + 1 ], GL_QUERY_RESULT_AVAILABLE, &available );
+      if ( !available ) continue;
+      valid[ p.timer ] = true;
+      GLuint64 begin, end;
+      glGetQueryObjectui64v( slot.queries[ p.query ], GL_QUERY_RESULT, &begin );
+      glGetQueryObjectui64v( slot.queries[ p.query + 1 ], GL_QUERY_RESULT, &end );
+      timers[ p.timer ].gpu.current += ( end - begin ) / 1e6f;
+    }
+    for ( size_t i = 0; i < timers.size(); i++ ) timers[ i ].gpu.push( gpuOffset, valid[ i ] );
+    gpuOffset = ( gpuOffset + 1 ) % historyLength;
+    slot.pending.clear();
+    slot.used = 0;
+  }
+
+  std::vector< timer > timers;
+  std::vector< series > counters;
+  series frameTime;
+  int offset = 0;     // where the next CPU / counter entry goes, for ImGui::PlotLines
+  int gpuOffset = 0;  // same for GPU
+
+  // start the long averages over, e.g. between benchmark scenes
+  void resetTotals() {
+    frameTime.total = 0.0;
+    frameTime.samples = 0;
+    for ( auto &t : timers ) { t.cpu.total = t.gpu.total = 0.0; t.cpu.samples = t.gpu.samples = 0; }
+    for ( auto &c : counters ) { c.total = 0.0; c.samples = 0; }
+  }
+
+  const series *counter( const char *name ) const {
+    for ( auto &c : counters )
+      if ( c.name == name ) return &c;
+    return nullptr;
+  }
+
+private:
+  struct pendingQuery { int timer; int query; };
+  struct frameSlot {
+    std::vector< GLuint > queries; // pairs, grown as needed
+    std::vector< pendingQuery > pending;
+    int used = 0;
+  };
+  frameSlot slots[ framesInFlight ];
+  std::vector< std::chrono::steady_clock::time_point > starts;
+  std::chrono::steady_clock::time_point frameStart;
+  uint64_t frame = 0;
+
+  int timerIndex( const char *name, bool useGPU ) {
+    for ( size_t i = 0; i < timers.size(); i++ )
+      if ( timers[ i ].cpu.name == name ) return i;
+    timers.push_back( timer() );
+    timers.back().cpu.name = timers.back().gpu.name = name;
+    timers.back().useGPU = useGPU;
+    starts.push_back( std::chrono::steady_clock::now() );
+    return timers.size() - 1;
+  }
+
+  void start( int index ) {
+    starts[ index ] = std::chrono::steady_clock::now();
+    if ( !timers[ index ].useGPU ) return;
+    frameSlot &slot = slots[ frame % framesInFlight ];
+    if ( slot.used + 2 > int( slot.queries.size() ) ) {
+      slot.queries.resize( slot.used + 2 );
+      glGenQueries( 2, &slot.queries[ slot.used ] );
+    }
+    slot.pending.push_back( { index, slot.used } );
+    glQueryCounter( slot.queries[ slot.used ], GL_TIMESTAMP );
+    slot.used += 2;
+  }
+
+  void stop( int index ) {
+    timers[ index ].cpu.current += std::chrono::duration< float, std::milli >( std::chrono::steady_clock::now() - starts[ index ] ).count();
+    if ( !timers[ index ].useGPU ) return;
+    // the most recent open query pair for this timer
+    frameSlot &slot = slots[ frame % framesInFlight ];
+    for ( auto p = slot.pending.rbegin(); p != slot.pending.rend(); ++p )
+      if ( p->timer == index ) {
+        glQueryCounter( slot.queries[ p->query + 1 ], GL_TIMESTAMP );
+        break;
+      }
+  }
+};
+
+#endif
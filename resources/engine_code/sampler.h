@@ -0,0 +1,108 @@
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+// sample generation for the path tracer - CPU mirror of shaders/sampler.glsl, same modes, same bits.
+// Keep the two in sync: anything rendered on the CPU ( tests, tools ) should see exactly the values
+// the shader sees for a given ( pixel, sample index, dimension ).
+//
+// the Sobol modes follow Burley 2020, "Practical Hash-based Owen Scrambling" - a 4D Sobol sequence,
+// nested uniform scrambled, with the index shuffled per 4D group so further groups pad out the
+// dimensions. Scrambling and shuffling both map aligned power of two blocks of indices onto aligned
+// blocks, and every aligned block of 2^m Sobol points is a stratified ( 0,m,2 ) net.
+//  sobol         - every pixel has its own scramble seed, so each pixel converges fast on its own
+//  sobol ranked  - one seed per 128x128 noise tile, each pixel takes a different point of that shared
+//                  sequence, by xoring the index's low 6 bits with its blue noise rank - an 8x8 window
+//                  of pixels covers ( close to ) one aligned block of 64 points, so neighbours are
+//                  stratified against each other and the error goes to high frequencies ( the ranking
+//                  idea of Heitz et al. 2019, with the rank as a fixed key instead of an optimized one )
+
+#include <cstdint>
+
+enum class samplerMode : int { random, blueNoise, sobol, sobolRanked };
+
+static constexpr uint32_t sobolDirections[ 4 ][ 32 ] = {
+  { 0x80000000u, 0x40000000u, 0x20000000u, 0x10000000u, 0x08000000u, 0x04000000u, 0x02000000u, 0x01000000u,
+    0x00800000u, 0x00400000u, 0x00200000u, 0x00100000u, 0x00080000u, 0x00040000u, 0x00020000u, 0x00010000u,
+    0x00008000u, 0x00004000u, 0x00002000u, 0x00001000u, 0x00000800u, 0x00000400u, 0x00000200u, 0x00000100u,
+    0x00000080u, 0x00000040u, 0x00000020u, 0x00000010u, 0x00000008u, 0x00000004u, 0x00000002u, 0x00000001u },
+  { 0x80000000u, 0xc0000000u, 0xa0000000u, 0xf0000000u, 0x88000000u, 0xcc000000u, 0xaa000000u, 0xff000000u,
+    0x80800000u, 0xc0c00000u, 0xa0a00000u, 0xf0f00000u, 0x88880000u, 0xcccc0000u, 0xaaaa0000u, 0xffff0000u,
+    0x80008000u, 0xc000c000u, 0xa000a000u, 0xf000f000u, 0x88008800u, 0xcc00cc00u, 0xaa00aa00u, 0xff00ff00u,
+    0x80808080u, 0xc0c0c0c0u, 0xa0a0a0a0u, 0xf0f0f0f0u, 0x88888888u, 0xccccccccu, 0xaaaaaaaau, 0xffffffffu },
+  { 0x80000000u, 0xc0000000u, 0x60000000u, 0x90000000u, 0xe8000000u, 0x5c000000u, 0x8e000000u, 0xc5000000u,
+    0x68800000u, 0x9cc00000u, 0xee600000u, 0x55900000u, 0x80680000u, 0xc09c0000u, 0x60ee0000u, 0x90550000u,
+    0xe8808000u, 0x5cc0c000u, 0x8e606000u, 0xc5909000u, 0x6868e800u, 0x9c9c5c00u, 0xeeee8e00u, 0x5555c500u,
+    0x8000e880u, 0xc0005cc0u, 0x60008e60u, 0x9000c590u, 0xe8006868u, 0x5c009c9cu, 0x8e00eeeeu, 0xc5005555u },
+  { 0x80000000u, 0xc0000000u, 0x20000000u, 0x50000000u, 0xf8000000u, 0x74000000u, 0xa2000000u, 0x93000000u,
+    0xd8800000u, 0x25400000u, 0x59e00000u, 0xe6d00000u, 0x78080000u, 0xb40c0000u, 0x82020000u, 0xc3050000u,
+    0x208f8000u, 0x51474000u, 0xfbea2000u, 0x75d93000u, 0xa0858800u, 0x914e5400u, 0xdbe79e00u, 0x25db6d00u,
+    0x58800080u, 0xe54000c0u, 0x79e00020u, 0xb6d00050u, 0x800800f8u, 0xc00c0074u, 0x200200a2u, 0x50050093u }
+};
+
+inline uint32_t samplerHash( uint32_t x ) { // lowbias32, Chris Wellons
+  x ^= x >> 16; x *= 0x7feb352du;
+  x ^= x >> 15; x *= 0x846ca68bu;
+  x ^= x >> 16;
+  return x;
+}
+
+inline uint32_t reverseBits( uint32_t x ) {
+  x = ( ( x >> 1 ) & 0x55555555u ) | ( ( x & 0x55555555u ) << 1 );
+  x = ( ( x >> 2 ) & 0x33333333u ) | ( ( x & 0x33333333u ) << 2 );
+  x = ( ( x >> 4 ) & 0x0f0f0f0fu ) | ( ( x & 0x0f0f0f0fu ) << 4 );
+  x = ( ( x >> 8 ) & 0x00ff00ffu ) | ( ( x & 0x00ff00ffu ) << 8 );
+  return ( x >> 16 ) | ( x << 16 );
+}
+
+// on bit reversed input, each bit only depends on the bits below it - reversed back, that's an Owen scramble
+inline uint32_t laineKarrasPermutation( uint32_t x, uint32_t seed ) {
+  x += seed;
+  x ^= x * 0x6c50b47cu;
+  x ^= x * 0xb82f1e52u;
+  x ^= x * 0xc7afe638u;
+  x ^= x * 0x8d22f6e6u;
+  return x;
+}
+
+inline uint32_t nestedUniformScramble( uint32_t x, uint32_t seed ) {
+  return reverseBits( laineKarrasPermutation( reverseBits( x ), seed ) );
+}
+
+inline uint32_t sobol( uint32_t index, uint32_t dimension ) {
+  uint32_t x = 0;
+  for ( int bit = 0; index; bit++, index >>= 1 )
+    if ( index & 1u ) x ^= sobolDirections[ dimension ][ bit ];
+  return x;
+}
+
+// 24 bits, so the result is exactly representable and stays below 1
+inline float samplerFloat( uint32_t x ) {
+  return float( x >> 8 ) / 16777216.0f;
+}
+
+// one dimension of the shuffled, scrambled, padded sequence for the given seed
+inline float sobolSample( uint32_t index, uint32_t dimension, uint32_t seed ) {
+  uint32_t groupSeed = samplerHash( seed ^ samplerHash( dimension / 4u ) );
+  index = nestedUniformScramble( index, groupSeed );
+  return samplerFloat( nestedUniformScramble( sobol( index, dimension % 4u ), samplerHash( groupSeed + dimension % 4u ) ) );
+}
+
+inline uint32_t pixelSeed( int x, int y ) {
+  return samplerHash( uint32_t( x ) ^ samplerHash( uint32_t( y ) ) );
+}
+
+// ( pixel, sample index, dimension ) -> [0,1) for the two Sobol modes, and plain hashing for random -
+// blueNoise reads the noise bank on the GPU, it has no CPU side here. rank is the pixel's 8 bit blue
+// noise rank, only used by sobolRanked ( slice 0, red channel of the bank, see blue_noise.h )
+inline float sampleDimension( samplerMode mode, int x, int y, uint32_t sampleIndex, uint32_t dimension, uint32_t rank = 0 ) {
+  switch ( mode ) {
+    case samplerMode::sobol:
+      return sobolSample( sampleIndex, dimension, pixelSeed( x, y ) );
+    case samplerMode::sobolRanked:
+      return sobolSample( sampleIndex ^ ( rank >> 2 ), dimension, pixelSeed( x / 128, y / 128 ) );
+    default:
+      return samplerFloat( samplerHash( pixelSeed( x, y ) ^ samplerHash( sampleIndex ^ samplerHash( dimension ) ) ) );
+  }
+}
+
+#endif
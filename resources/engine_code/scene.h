@@ -0,0 +1,604 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+// scene files - camera, render settings, materials, asset references and an SDF node tree, as JSON
+//
+//  {
+//    "version": 1,
+//    "camera": { "position": [ 0, 1, -5 ], "rotation": [ 0, 0, 0 ], "fov": 0.152 }, // rotation in degrees
+//    "core": { "maxSteps": 200 }, "lens": { ... }, "post": { ... },               // partial, over the defaults
+//    "materials": { "red": { "albedo": [ 0.8, 0.1, 0.1 ], "roughness": 0.4 } },
+//    "assets": [ { "name": "terrain", "type": "vat", "path": "terrain.vat" } ],    // relative to the scene file
+//    "sdf": { "type": "union", "children": [
+//      { "type": "sphere", "radius": 1, "material": "red", "position": [ 0, 1, 0 ] },
+//      { "type": "plane" } ] }
+//  }
+//
+// every node takes "position", "rotation" ( degrees ) and "scale" ( uniform ), applied to its domain.
+//  primitives  - sphere radius, box size, roundBox size radius, torus radius thickness, cylinder radius
+//                height, capsule radius height, plane ( y up ) - sizes are half extents, plus "material"
+//  booleans    - union, intersect, subtract ( first child minus the rest ), and smoothUnion,
+//                smoothIntersect, smoothSubtract with a "blend" radius
+//  domain      - repeat, one child, "period" per axis ( 0 leaves an axis alone ), optional "count" of
+//                copies each side of the origin ( 0 is unbounded )
+//
+// loading validates everything and reports every problem with its JSON path, before anything is used.
+// A parsed scene is written next to the source as <file>.cache - a flat binary image of the loaded
+// structures, reused by later loads while the source's size and timestamp, the struct layouts and
+// the compiled in defaults all still match, so big procedural scenes skip the JSON entirely.
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "mapped_file.h"
+
+enum class sdfNodeType : uint32_t {
+  // primitives
+  sphere, box, roundBox, torus, cylinder, capsule, plane,
+  // booleans, over all children
+  unite, intersect, subtract, smoothUnite, smoothIntersect, smoothSubtract,
+  // domain
+  repeat,
+  count
+};
+
+struct sdfNodeInfo {
+  const char *name;
+  int minChildren, maxChildren; // -1 is unlimited
+};
+
+inline const sdfNodeInfo &nodeInfo( sdfNodeType type ) {
+  static const sdfNodeInfo table[] = {
+    { "sphere", 0, 0 }, { "box", 0, 0 }, { "roundBox", 0, 0 }, { "torus", 0, 0 },
+    { "cylinder", 0, 0 }, { "capsule", 0, 0 }, { "plane", 0, 0 },
+    { "union", 1, -1 }, { "intersect", 1, -1 }, { "subtract", 2, -1 },
+    { "smoothUnion", 1, -1 }, { "smoothIntersect", 1, -1 }, { "smoothSubtract", 2, -1 },
+    { "repeat", 1, 1 }
+  };
+  return table[ uint32_t( type ) ];
+}
+
+inline bool isPrimitive( sdfNodeType type ) { return type <= sdfNodeType::plane; }
+
+// flat, children of a node sit next to each other in the node array - nodes[ 0 ] is the root.
+// params by type: sphere radius / box, roundBox half size xyz ( roundBox radius in w ) / torus radius,
+// thickness / cylinder, capsule radius, half height / smooth booleans blend / repeat period xyz, count
+struct sdfNode {
+  uint32_t type;
+  int32_t material = -1;    // primitives only
+  uint32_t firstChild = 0;
+  uint32_t childCount = 0;
+  glm::vec4 params = glm::vec4( 0.0f );
+  glm::vec3 position = glm::vec3( 0.0f );
+  float scale = 1.0f;
+  glm::vec4 rotation = glm::vec4( 0.0f, 0.0f, 0.0f, 1.0f ); // quaternion, xyzw
+};
+static_assert( sizeof( sdfNode ) == 64, "sdfNode is part of the scene cache format" );
+
+struct sceneMaterial {
+  glm::vec3 albedo = glm::vec3( 0.5f );
+  float roughness = 1.0f;
+  glm::vec3 emission = glm::vec3( 0.0f );
+  float metallic = 0.0f;
+  float ior = 1.5f;
+  float padding[ 3 ] = { 0.0f, 0.0f, 0.0f };
+};
+static_assert( sizeof( sceneMaterial ) == 48, "sceneMaterial is part of the scene cache format" );
+
+// as the loaded structures, for the scene state sent to distributed workers - not the scene file format
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE( sdfNode, type, material, firstChild, childCount, params, position, scale, rotation )
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE( sceneMaterial, albedo, roughness, emission, metallic, ior )
+
+enum class sceneAssetType : uint32_t { obj, vat, heightmap, image, count };
+inline const char *assetTypeNames[] = { "obj", "vat", "heightmap", "image" };
+
+struct sceneAsset {
+  std::string name;
+  sceneAssetType type;
+  std::string path; // resolved against the scene file's directory
+};
+
+constexpr uint32_t sceneFormatVersion = 1;     // the JSON
+constexpr uint32_t sceneCacheVersion = 1;      // the binary sidecar
+constexpr char sceneCacheMagic[ 8 ] = { 'S', 'D', 'F', 'S', 'C', 'E', 'N', 'E' };
+
+// sections follow the header, each at its offset - settings are the three parameter structs back to
+// back, assets and material names are offsets into a string table of null terminated strings
+struct sceneCacheHeader {
+  char magic[ 8 ];
+  uint32_t version;
+  uint32_t headerSize;
+  uint64_t sourceSize;     // staleness - the source as it was when the cache was written
+  int64_t sourceTime;
+  uint64_t defaultsHash;   // the compiled in defaults the partial settings were applied over
+  uint32_t layoutSizes[ 5 ]; // core, lens, post, node, material - a changed struct invalidates the cache
+  uint32_t nodeCount;
+  uint32_t materialCount;
+  uint32_t assetCount;
+  uint64_t settingsOffset;
+  uint64_t nodeOffset;
+  uint64_t materialOffset;
+  uint64_t materialNameOffset; // uint32 string offset per material
+  uint64_t assetOffset;        // sceneCacheAsset per asset
+  uint64_t stringOffset;
+  uint64_t stringBytes;
+};
+
+struct sceneCacheAsset {
+  uint32_t type;
+  uint32_t name; // string table offsets
+  uint32_t path;
+};
+
+static_assert( std::is_trivially_copyable< coreParameters >::value &&
+  std::is_trivially_copyable< lensParameters >::value && std::is_trivially_copyable< postParameters >::value,
+  "parameter structs are copied into the scene cache as is" );
+
+class sceneDescription {
+public:
+  coreParameters core;
+  lensParameters lens;
+  postParameters post;
+  std::vector< sdfNode > nodes;
+  std::vector< sceneMaterial > materials;
+  std::vector< std::string > materialNames;
+  std::vector< sceneAsset > assets;
+
+  std::string source;               // path of the JSON
+  bool fromCache = false;           // last load skipped the JSON
+  std::vector< std::string > errors; // "path: problem", from the last load
+
+  // cache when it's current, JSON ( rewriting the cache ) otherwise - false with errors on failure,
+  // in which case the description is left as it was
+  bool load( const std::string &filename ) {
+    errors.clear();
+    sceneDescription loaded;
+    loaded.source = filename;
+    std::string cache = cacheName( filename );
+    if ( loaded.readCache( cache ) ) {
+      loaded.fromCache = true;
+      *this = std::move( loaded );
+      return true;
+    }
+
+    std::ifstream file( filename );
+    if ( !file ) { errors.push_back( filename + ": can't open" ); return false; }
+    json j;
+    try {
+      file >> j;
+    } catch ( json::parse_error &e ) {
+      errors.push_back( filename + ": " + e.what() );
+      return false;
+    }
+    if ( !loaded.parse( j ) ) { errors = loaded.errors; return false; }
+    loaded.writeCache( cache ); // best effort, a read only scene directory just means parsing every time
+    *this = std::move( loaded );
+    return true;
+  }
+
+  static std::string cacheName( const std::string &filename ) { return filename + ".cache"; }
+
+  // validates and loads a scene document, over the default settings - true when there were no errors
+  bool parse( const json &j ) {
+    errors.clear();
+    nodes.clear();
+    materials.clear();
+    materialNames.clear();
+    assets.clear();
+    if ( !j.is_object() ) { error( "", "a scene is a JSON object" ); return false; }
+    checkKeys( j, "", { "version", "camera", "core", "lens", "post", "materials", "assets", "sdf" } );
+    if ( j.contains( "version" ) && !( j[ "version" ].is_number_unsigned() && j[ "version" ].get< uint32_t >() <= sceneFormatVersion ) )
+      error( "/version", "expected a version up to " + std::to_string( sceneFormatVersion ) );
+
+    parseSettings( j, "core", core );
+    parseSettings( j, "lens", lens );
+    parseSettings( j, "post", post );
+    if ( j.contains( "camera" ) ) parseCamera( j[ "camera" ] );
+
+    // material 0 is always there, for primitives that don't name one
+    materials.push_back( sceneMaterial() );
+    materialNames.push_back( "default" );
+    if ( j.contains( "materials" ) ) parseMaterials( j[ "materials" ] );
+    if ( j.contains( "assets" ) ) parseAssets( j[ "assets" ] );
+
+    if ( j.contains( "sdf" ) ) {
+      nodes.resize( 1 );
+      parseNode( j[ "sdf" ], "/sdf", 0 );
+    }
+    return errors.empty();
+  }
+
+  // flat image of everything above, written to a temporary and renamed into place
+  bool writeCache( const std::string &filename ) const {
+    std::error_code ec;
+    auto sourceSize = std::filesystem::file_size( source, ec );
+    if ( ec ) return false;
+    auto sourceTime = std::filesystem::last_write_time( source, ec );
+    if ( ec ) return false;
+
+    std::string strings;
+    auto addString = [ & ]( const std::string &s ) {
+      uint32_t offset = strings.size();
+      strings.append( s ).push_back( '\0' );
+      return offset;
+    };
+    std::vector< uint32_t > nameOffsets;
+    for ( auto &name : materialNames ) nameOffsets.push_back( addString( name ) );
+    std::vector< sceneCacheAsset > cacheAssets;
+    for ( auto &a : assets ) cacheAssets.push_back( { uint32_t( a.type ), addString( a.name ), addString( a.path ) } );
+
+    sceneCacheHeader header = {};
+    std::memcpy( header.magic, sceneCacheMagic, sizeof( sceneCacheMagic ) );
+    header.version = sceneCacheVersion;
+    header.headerSize = sizeof( sceneCacheHeader );
+    header.sourceSize = sourceSize;
+    header.sourceTime = sourceTime.time_since_epoch().count();
+    header.defaultsHash = defaultsHash();
+    layoutSizes( header.layoutSizes );
+    header.nodeCount = nodes.size();
+    header.materialCount = materials.size();
+    header.assetCount = cacheAssets.size();
+
+    // sections 16 byte aligned, so the node array can be used from the mapping as is
+    uint64_t offset = sizeof( sceneCacheHeader );
+    auto place = [ & ]( uint64_t bytes ) { uint64_t at = ( offset + 15 ) & ~uint64_t( 15 ); offset = at + bytes; return at; };
+    header.settingsOffset = place( sizeof( coreParameters ) + sizeof( lensParameters ) + sizeof( postParameters ) );
+    header.nodeOffset = place( nodes.size() * sizeof( sdfNode ) );
+    header.materialOffset = place( materials.size() * sizeof( sceneMaterial ) );
+    header.materialNameOffset = place( nameOffsets.size() * sizeof( uint32_t ) );
+    header.assetOffset = place( cacheAssets.size() * sizeof( sceneCacheAsset ) );
+    header.stringOffset = place( strings.size() );
+    header.stringBytes = strings.size();
+
+    std::vector< uint8_t > image( offset, 0 );
+    auto put = [ & ]( uint64_t at, const void *data, size_t bytes ) { if ( bytes ) std::memcpy( image.data() + at, data, bytes ); };
+    put( 0, &header, sizeof( header ) );
+    put( header.settingsOffset, &core, sizeof( core ) );
+    put( header.settingsOffset + sizeof( core ), &lens, sizeof( lens ) );
+    put( header.settingsOffset + sizeof( core ) + sizeof( lens ), &post, sizeof( post ) );
+    put( header.nodeOffset, nodes.data(), nodes.size() * sizeof( sdfNode ) );
+    put( header.materialOffset, materials.data(), materials.size() * sizeof( sceneMaterial ) );
+    put( header.materialNameOffset, nameOffsets.data(), nameOffsets.size() * sizeof( uint32_t ) );
+    put( header.assetOffset, cacheAssets.data(), cacheAssets.size() * sizeof( sceneCacheAsset ) );
+    put( header.stringOffset, strings.data(), strings.size() );
+
+    std::string temporary = filename + ".tmp";
+    {
+      std::ofstream file( temporary, std::ios::binary );
+      file.write( ( const char * ) image.data(), image.size() );
+      if ( !file ) return false;
+    }
+    std::filesystem::rename( temporary, filename, ec );
+    return !ec;
+  }
+
+  // false when there's no cache, or it's stale or damaged - the caller falls back to the JSON
+  bool readCache( const std::string &filename ) {
+    mappedFile file;
+    if ( !file.open( filename ) || file.size < sizeof( sceneCacheHeader ) ) return false;
+    sceneCacheHeader header;
+    std::memcpy( &header, file.data, sizeof( header ) );
+    if ( std::memcmp( header.magic, sceneCacheMagic, sizeof( sceneCacheMagic ) ) != 0 ||
+         header.version != sceneCacheVersion || header.headerSize != sizeof( sceneCacheHeader ) )
+      return false;
+
+    std::error_code ec;
+    auto sourceSize = std::filesystem::file_size( source, ec );
+    if ( ec || sourceSize != header.sourceSize ) return false;
+    auto sourceTime = std::filesystem::last_write_time( source, ec );
+    if ( ec || int64_t( sourceTime.time_since_epoch().count() ) != header.sourceTime ) return false;
+    uint32_t sizes[ 5 ];
+    layoutSizes( sizes );
+    if ( std::memcmp( sizes, header.layoutSizes, sizeof( sizes ) ) != 0 || header.defaultsHash != defaultsHash() )
+      return false;
+
+    // every section inside the file, every string offset inside the table
+    auto inside = [ & ]( uint64_t at, uint64_t bytes ) { return at <= file.size && bytes <= file.size - at; };
+    if ( !inside( header.settingsOffset, sizeof( coreParameters ) + sizeof( lensParameters ) + sizeof( postParameters ) ) ||
+         !inside( header.nodeOffset, uint64_t( header.nodeCount ) * sizeof( sdfNode ) ) ||
+         !inside( header.materialOffset, uint64_t( header.materialCount ) * sizeof( sceneMaterial ) ) ||
+         !inside( header.materialNameOffset, uint64_t( header.materialCount ) * sizeof( uint32_t ) ) ||
+         !inside( header.assetOffset, uint64_t( header.assetCount ) * sizeof( sceneCacheAsset ) ) ||
+         !inside( header.stringOffset, header.stringBytes ) || header.materialCount == 0 )
+      return false;
+    const char *strings = ( const char * ) file.data + header.stringOffset;
+    auto string = [ & ]( uint32_t offset, std::string &out ) {
+      if ( offset >= header.stringBytes ) return false;
+      const char *end = ( const char * ) std::memchr( strings + offset, '\0', header.stringBytes - offset );
+      if ( !end ) return false;
+      out.assign( strings + offset, end );
+      return true;
+    };
+
+    const uint8_t *settings = file.data + header.settingsOffset;
+    std::memcpy( &core, settings, sizeof( core ) );
+    std::memcpy( &lens, settings + sizeof( core ), sizeof( lens ) );
+    std::memcpy( &post, settings + sizeof( core ) + sizeof( lens ), sizeof( post ) );
+    nodes.resize( header.nodeCount );
+    if ( header.nodeCount ) std::memcpy( nodes.data(), file.data + header.nodeOffset, nodes.size() * sizeof( sdfNode ) );
+    materials.resize( header.materialCount );
+    std::memcpy( materials.data(), file.data + header.materialOffset, materials.size() * sizeof( sceneMaterial ) );
+
+    materialNames.resize( header.materialCount );
+    for ( uint32_t i = 0; i < header.materialCount; i++ ) {
+      uint32_t offset;
+      std::memcpy( &offset, file.data + header.materialNameOffset + i * sizeof( uint32_t ), sizeof( offset ) );
+      if ( !string( offset, materialNames[ i ] ) ) return false;
+    }
+    assets.resize( header.assetCount );
+    for ( uint32_t i = 0; i < header.assetCount; i++ ) {
+      sceneCacheAsset a;
+      std::memcpy( &a, file.data + header.assetOffset + i * sizeof( sceneCacheAsset ), sizeof( a ) );
+      if ( a.type >= uint32_t( sceneAssetType::count ) || !string( a.name, assets[ i ].name ) || !string( a.path, assets[ i ].path ) )
+        return false;
+      assets[ i ].type = sceneAssetType( a.type );
+    }
+
+    return treeValid();
+  }
+
+  // the tree has to hold together - child counts each type takes, children in range and after their
+  // parent, materials that exist. For node arrays that didn't come through parse()
+  bool treeValid() const {
+    for ( uint32_t i = 0; i < nodes.size(); i++ ) {
+      const sdfNode &n = nodes[ i ];
+      if ( n.type >= uint32_t( sdfNodeType::count ) ) return false;
+      const sdfNodeInfo &info = nodeInfo( sdfNodeType( n.type ) );
+      if ( n.childCount < uint32_t( info.minChildren ) || ( info.maxChildren >= 0 && n.childCount > uint32_t( info.maxChildren ) ) ||
+           n.childCount > nodes.size() || ( n.childCount && ( n.firstChild <= i || n.firstChild > nodes.size() - n.childCount ) ) ||
+           ( isPrimitive( sdfNodeType( n.type ) ) && ( n.material < 0 || uint32_t( n.material ) >= materials.size() ) ) )
+        return false;
+    }
+    return true;
+  }
+
+private:
+  void error( const std::string &path, const std::string &message ) {
+    errors.push_back( ( path.empty() ? "/" : path ) + ": " + message );
+  }
+
+  void checkKeys( const json &j, const std::string &path, std::initializer_list< const char * > known ) {
+    for ( auto &item : j.items() ) {
+      bool found = false;
+      for ( const char *k : known ) found |= item.key() == k;
+      if ( !found ) error( path + "/" + item.key(), "unknown field" );
+    }
+  }
+
+  // partial settings, patched over the defaults - unknown fields and wrong types are errors
+  template < typename T >
+  void parseSettings( const json &j, const char *key, T &settings ) {
+    std::string path = std::string( "/" ) + key;
+    if ( !j.contains( key ) ) return;
+    const json &patch = j[ key ];
+    if ( !patch.is_object() ) { error( path, "expected an object" ); return; }
+    json merged = json( settings );
+    for ( auto &item : patch.items() ) {
+      if ( !merged.contains( item.key() ) ) { error( path + "/" + item.key(), "unknown field" ); continue; }
+      const json &current = merged[ item.key() ];
+      bool numeric = current.is_number() && item.value().is_number();
+      if ( !numeric && current.type() != item.value().type() ) { error( path + "/" + item.key(), std::string( "expected " ) + current.type_name() ); continue; }
+      merged[ item.key() ] = item.value();
+    }
+    try {
+      settings = merged.get< T >();
+    } catch ( json::exception &e ) {
+      error( path, e.what() );
+    }
+  }
+
+  bool readFloat( const json &j, const std::string &path, const char *key, float &value, bool positive = false ) {
+    if ( !j.contains( key ) ) return true;
+    if ( !j[ key ].is_number() ) { error( path + "/" + key, "expected a number" ); return false; }
+    value = j[ key ].get< float >();
+    if ( positive && !( value > 0.0f ) ) { error( path + "/" + key, "must be positive" ); return false; }
+    return true;
+  }
+
+  bool readVec3( const json &j, const std::string &path, const char *key, glm::vec3 &value, bool positive = false ) {
+    if ( !j.contains( key ) ) return true;
+    const json &v = j[ key ];
+    if ( !v.is_array() || v.size() != 3 || !v[ 0 ].is_number() || !v[ 1 ].is_number() || !v[ 2 ].is_number() ) {
+      error( path + "/" + key, "expected three numbers" );
+      return false;
+    }
+    value = glm::vec3( v[ 0 ].get< float >(), v[ 1 ].get< float >(), v[ 2 ].get< float >() );
+    if ( positive && !( value.x > 0.0f && value.y > 0.0f && value.z > 0.0f ) ) { error( path + "/" + key, "must be positive" ); return false; }
+    return true;
+  }
+
+  // a value the node can't do without
+  bool require( const json &j, const std::string &path, const char *key ) {
+    if ( j.contains( key ) ) return true;
+    error( path + "/" + key, "required" );
+    return false;
+  }
+
+  void parseCamera( const json &j ) {
+    if ( !j.is_object() ) { error( "/camera", "expected an object" ); return; }
+    checkKeys( j, "/camera", { "position", "rotation", "fov" } );
+    glm::vec3 rotation = glm::degrees( glm::vec3( core.rotationAboutX, core.rotationAboutY, core.rotationAboutZ ) );
+    readVec3( j, "/camera", "position", core.viewerPosition );
+    readVec3( j, "/camera", "rotation", rotation );
+    readFloat( j, "/camera", "fov", core.FoV, true );
+    core.rotationAboutX = glm::radians( rotation.x );
+    core.rotationAboutY = glm::radians( rotation.y );
+    core.rotationAboutZ = glm::radians( rotation.z );
+  }
+
+  void parseMaterials( const json &j ) {
+    if ( !j.is_object() ) { error( "/materials", "expected an object of named materials" ); return; }
+    for ( auto &item : j.items() ) {
+      std::string path = "/materials/" + item.key();
+      const json &m = item.value();
+      if ( !m.is_object() ) { error( path, "expected an object" ); continue; }
+      checkKeys( m, path, { "albedo", "roughness", "metallic", "emission", "ior" } );
+      sceneMaterial material;
+      readVec3( m, path, "albedo", material.albedo );
+      readFloat( m, path, "roughness", material.roughness );
+      readFloat( m, path, "metallic", material.metallic );
+      readVec3( m, path, "emission", material.emission );
+      readFloat( m, path, "ior", material.ior, true );
+      if ( material.roughness < 0.0f || material.roughness > 1.0f ) error( path + "/roughness", "must be in [0,1]" );
+      if ( material.metallic < 0.0f || material.metallic > 1.0f ) error( path + "/metallic", "must be in [0,1]" );
+      if ( item.key() == "default" ) { // overrides the built in one
+        materials[ 0 ] = material;
+      } else {
+        materials.push_back( material );
+        materialNames.push_back( item.key() );
+      }
+    }
+  }
+
+  void parseAssets( const json &j ) {
+    if ( !j.is_array() ) { error( "/assets", "expected an array" ); return; }
+    std::filesystem::path base = std::filesystem::path( source ).parent_path();
+    for ( size_t i = 0; i < j.size(); i++ ) {
+      std::string path = "/assets/" + std::to_string( i );
+      const json &a = j[ i ];
+      if ( !a.is_object() ) { error( path, "expected an object" ); continue; }
+      checkKeys( a, path, { "name", "type", "path" } );
+      if ( !require( a, path, "name" ) || !require( a, path, "type" ) || !require( a, path, "path" ) ) continue;
+      if ( !a[ "name" ].is_string() || !a[ "type" ].is_string() || !a[ "path" ].is_string() ) { error( path, "name, type and path are strings" ); continue; }
+
+      sceneAsset asset;
+      asset.name = a[ "name" ];
+      for ( auto &other : assets )
+        if ( other.name == asset.name ) error( path + "/name", "\"" + asset.name + "\" is already used" );
+      uint32_t type = 0;
+      while ( type < uint32_t( sceneAssetType::count ) && a[ "type" ] != assetTypeNames[ type ] ) type++;
+      if ( type == uint32_t( sceneAssetType::count ) ) { error( path + "/type", "unknown asset type \"" + a[ "type" ].get< std::string >() + "\"" ); continue; }
+      asset.type = sceneAssetType( type );
+      asset.path = ( base / a[ "path" ].get< std::string >() ).lexically_normal().string();
+      if ( !std::filesystem::exists( asset.path ) ) error( path + "/path", asset.path + " doesn't exist" );
+      assets.push_back( asset );
+    }
+  }
+
+  // fills nodes[ slot ], and reserves a contiguous block for the children before recursing into them
+  void parseNode( const json &j, const std::string &path, uint32_t slot ) {
+    if ( !j.is_object() ) { error( path, "expected an object" ); return; }
+    if ( !require( j, path, "type" ) ) return;
+    if ( !j[ "type" ].is_string() ) { error( path + "/type", "expected a string" ); return; }
+
+    uint32_t t = 0;
+    while ( t < uint32_t( sdfNodeType::count ) && j[ "type" ] != nodeInfo( sdfNodeType( t ) ).name ) t++;
+    if ( t == uint32_t( sdfNodeType::count ) ) { error( path + "/type", "unknown node type \"" + j[ "type" ].get< std::string >() + "\"" ); return; }
+    sdfNodeType type = sdfNodeType( t );
+
+    sdfNode node;
+    node.type = t;
+    readVec3( j, path, "position", node.position );
+    glm::vec3 rotation( 0.0f );
+    if ( readVec3( j, path, "rotation", rotation ) ) {
+      glm::quat q( glm::radians( rotation ) );
+      node.rotation = glm::vec4( q.x, q.y, q.z, q.w );
+    }
+    readFloat( j, path, "scale", node.scale, true );
+
+    // type specific values - names that don't belong to the type are errors
+    glm::vec3 size( 0.0f );
+    float count = 0.0f;
+    switch ( type ) {
+      case sdfNodeType::sphere:
+        checkKeys( j, path, { "type", "position", "rotation", "scale", "material", "radius" } );
+        if ( require( j, path, "radius" ) ) readFloat( j, path, "radius", node.params.x, true );
+        break;
+      case sdfNodeType::box:
+      case sdfNodeType::roundBox:
+        if ( type == sdfNodeType::box ) checkKeys( j, path, { "type", "position", "rotation", "scale", "material", "size" } );
+        else checkKeys( j, path, { "type", "position", "rotation", "scale", "material", "size", "radius" } );
+        if ( require( j, path, "size" ) && readVec3( j, path, "size", size, true ) ) node.params = glm::vec4( size, 0.0f );
+        if ( type == sdfNodeType::roundBox && require( j, path, "radius" ) ) readFloat( j, path, "radius", node.params.w, true );
+        break;
+      case sdfNodeType::torus:
+        checkKeys( j, path, { "type", "position", "rotation", "scale", "material", "radius", "thickness" } );
+        if ( require( j, path, "radius" ) ) readFloat( j, path, "radius", node.params.x, true );
+        if ( require( j, path, "thickness" ) ) readFloat( j, path, "thickness", node.params.y, true );
+        break;
+      case sdfNodeType::cylinder:
+      case sdfNodeType::capsule:
+        checkKeys( j, path, { "type", "position", "rotation", "scale", "material", "radius", "height" } );
+        if ( require( j, path, "radius" ) ) readFloat( j, path, "radius", node.params.x, true );
+        if ( require( j, path, "height" ) ) readFloat( j, path, "height", node.params.y, true );
+        break;
+      case sdfNodeType::plane:
+        checkKeys( j, path, { "type", "position", "rotation", "scale", "material" } );
+        break;
+      case sdfNodeType::unite:
+      case sdfNodeType::intersect:
+      case sdfNodeType::subtract:
+        checkKeys( j, path, { "type", "position", "rotation", "scale", "children" } );
+        break;
+      case sdfNodeType::smoothUnite:
+      case sdfNodeType::smoothIntersect:
+      case sdfNodeType::smoothSubtract:
+        checkKeys( j, path, { "type", "position", "rotation", "scale", "children", "blend" } );
+        if ( require( j, path, "blend" ) ) readFloat( j, path, "blend", node.params.x, true );
+        break;
+      case sdfNodeType::repeat:
+        checkKeys( j, path, { "type", "position", "rotation", "scale", "children", "period", "count" } );
+        if ( require( j, path, "period" ) && readVec3( j, path, "period", size ) ) {
+          if ( glm::any( glm::lessThan( size, glm::vec3( 0.0f ) ) ) ) error( path + "/period", "can't be negative" );
+          node.params = glm::vec4( size, 0.0f );
+        }
+        if ( readFloat( j, path, "count", count ) ) {
+          if ( count < 0.0f || count != std::floor( count ) ) error( path + "/count", "expected a whole number, zero or more" );
+          node.params.w = count;
+        }
+        break;
+      default:
+        break;
+    }
+
+    if ( isPrimitive( type ) ) {
+      node.material = 0;
+      if ( j.contains( "material" ) ) {
+        const json &m = j[ "material" ];
+        auto found = m.is_string() ? std::find( materialNames.begin(), materialNames.end(), m.get< std::string >() ) : materialNames.end();
+        if ( found == materialNames.end() ) error( path + "/material", "not a material name" );
+        else node.material = int32_t( found - materialNames.begin() );
+      }
+      nodes[ slot ] = node;
+      return;
+    }
+
+    // booleans and domain nodes
+    const sdfNodeInfo &info = nodeInfo( type );
+    if ( !require( j, path, "children" ) ) return;
+    const json &children = j[ "children" ];
+    if ( !children.is_array() ) { error( path + "/children", "expected an array" ); return; }
+    if ( int( children.size() ) < info.minChildren || ( info.maxChildren >= 0 && int( children.size() ) > info.maxChildren ) ) {
+      error( path + "/children", std::string( info.name ) + ( info.maxChildren == info.minChildren ? " takes exactly " : " needs at least " ) + std::to_string( info.minChildren ) );
+      return;
+    }
+    node.firstChild = nodes.size();
+    node.childCount = children.size();
+    nodes[ slot ] = node;
+    nodes.resize( nodes.size() + children.size() );
+    for ( uint32_t i = 0; i < children.size(); i++ )
+      parseNode( children[ i ], path + "/children/" + std::to_string( i ), node.firstChild + i );
+  }
+
+  static void layoutSizes( uint32_t sizes[ 5 ] ) {
+    sizes[ 0 ] = sizeof( coreParameters );
+    sizes[ 1 ] = sizeof( lensParameters );
+    sizes[ 2 ] = sizeof( postParameters );
+    sizes[ 3 ] = sizeof( sdfNode );
+    sizes[ 4 ] = sizeof( sceneMaterial );
+  }
+
+  // FNV-1a over the default settings, so a changed default in the code invalidates caches built on the old one
+  static uint64_t defaultsHash() {
+    std::string text = json( coreParameters() ).dump() + json( lensParameters() ).dump() + json( postParameters() ).dump();
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for ( unsigned char c : text ) { hash ^= c; hash *= 0x100000001b3ull; }
+    return hash;
+  }
+};
+
+#endif
@@ -0,0 +1,708 @@
+#ifndef SDF_COMPILER_H
+#define SDF_COMPILER_H
+
+// SDF node graph compiler - turns the node tree of a scene file ( see scene.h ) into GLSL for de() and
+// deMaterial(), substituted for shaders/scene_de.glsl when the path tracer is built
+//
+//  lowering   - node transforms are folded into each primitive at compile time: a rotation, a center
+//               and sizes pre-multiplied by the accumulated scale, so a primitive costs one matrix
+//               multiply at most ( none for spheres or unrotated primitives ). Repeat nodes start a new
+//               domain variable, everything under them is folded relative to that
+//  simplify   - booleans with one child become the child, nested unions / intersections flatten, smooth
+//               booleans with no blend become hard ones, repeats with no period disappear, subtracted
+//               shapes that can't reach the shape they're cut from are dropped
+//  bounds     - conservative boxes for every subtree, in the frame of its domain variable
+//  emission   - one statement per node; subtrees with a finite box and a few primitives in them first
+//               measure the distance to the box, and only evaluate the subtree when that's closer than
+//               the margin - the box distance is a lower bound, so far away that's all de() returns.
+//               Only where a smaller value is still a safe step, never under the cut side of a subtract
+//
+// distances come out in world units - sizes are in domain units, and each domain's scale multiplies in
+//
+// the same tree is also assembled into bytecode for shaders/sdf_interpreter.glsl, a postfix program over
+// a small stack of ( distance, material ) registers and a stack of domain points - editing the scene
+// only means uploading the program again, where the generated GLSL needs the path tracer rebuilt.
+//  primitives push a value, booleans pop two and push one, repeat pushes a domain point and pop domain
+//  drops it again, a bounds check pushes the box distance and skips the subtree it guards when that's
+//  past the margin, or falls through into it otherwise
+//
+// scenes that are a hard union of many objects get a BVH over the bounded ones ( shaders/sdf_bvh.glsl ),
+// so de() only evaluates objects whose boxes are near the point instead of all of them - a union is
+// the smallest of its children, so a node whose box is already further than the best distance so far
+// can't change it, and one past the margin stands in for everything under it with its box distance.
+// Each object becomes a case of sceneObject() in the generated GLSL, and a range of the bytecode
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// opcodes below count are the node types, see sdfNodeType
+constexpr uint32_t sdfOpPopDomain = uint32_t( sdfNodeType::count );
+constexpr uint32_t sdfOpBound = sdfOpPopDomain + 1;
+
+// the interpreter's fixed register stacks, shaders/sdf_interpreter.glsl has the same
+constexpr int sdfStackSize = 16;
+constexpr int sdfDomainStackSize = 8;
+
+// std430 layout, shaders/sdf_interpreter.glsl mirrors it
+struct sdfInstruction {
+  uint32_t op;
+  int32_t material = 0;       // primitives
+  uint32_t skip = 0;          // bounds, instructions in the subtree it guards
+  float scale = 1.0f;         // primitives, bounds: domain to world units / repeat: scale of its frame
+  glm::vec4 params = glm::vec4( 0.0f ); // primitive sizes / blend / repeat period, count / bounds center, margin
+  glm::vec4 transform[ 3 ];   // rows of the domain to local affine / bounds: half size in the first
+};
+static_assert( sizeof( sdfInstruction ) == 80, "sdfInstruction is shared with the interpreter, std430" );
+
+// std430, shaders/sdf_bvh.glsl mirrors it - children of an interior node sit next to each other
+struct sdfBVHNode {
+  glm::vec3 boundsMin;
+  uint32_t first;     // interior: left child, the right one follows / leaf: first object
+  glm::vec3 boundsMax;
+  uint32_t count = 0; // objects in a leaf, zero for interior nodes
+};
+static_assert( sizeof( sdfBVHNode ) == 32, "sdfBVHNode is shared with the shader, std430" );
+
+// bytecode of one BVH object
+struct sdfObjectRange {
+  uint32_t first;
+  uint32_t count;
+};
+
+constexpr int sdfBVHStackSize = 32; // traversal stack in shaders/sdf_bvh.glsl
+
+struct sdfCompileStats {
+  int sourceNodes = 0;      // in the scene
+  int primitives = 0;       // emitted
+  int operations = 0;       // booleans and repeats emitted
+  int nodesRemoved = 0;     // by simplification
+  int transformsFolded = 0; // node transforms that left no runtime cost
+  int boundsChecks = 0;
+  int lines = 0;            // of generated GLSL
+  int instructions = 0;     // of bytecode
+  int stackDepth = 0;       // registers the program needs
+  int domainDepth = 0;      // domain points the program needs
+  int bvhObjects = 0;       // in the BVH, zero without one
+  int bvhNodes = 0;
+  int bvhDepth = 0;
+  int unboundedObjects = 0; // evaluated outside the BVH, every call
+  float compileMs = 0.0f;
+};
+
+class sdfCompiler {
+public:
+  std::string code; // the generated scene_de.glsl
+  std::vector< sdfInstruction > program; // the same, as bytecode
+  uint32_t rootLength = 0;                // instructions run for every point, the rest are BVH objects
+  std::vector< sdfObjectRange > objectRanges;
+  std::vector< sdfBVHNode > bvh;          // empty when the scene doesn't use one
+  bool programFits = true; // within the interpreter's stacks
+  bool sceneBounded = false; // the whole scene fits in a box, world units
+  glm::vec3 sceneMin = glm::vec3( 0.0f ), sceneMax = glm::vec3( 0.0f );
+  sdfCompileStats stats;
+
+  // box distance under which a bounded subtree is evaluated for real, world units
+  float boundsMargin = 0.05f;
+  // bounded subtrees with fewer primitives than this aren't worth a check of their own
+  int boundsMinPrimitives = 2;
+  // bounded children of a root union it takes to build a BVH, and objects per leaf
+  int bvhMinObjects = 8;
+  int bvhLeafSize = 2;
+
+  void compile( const sceneDescription &scene ) {
+    auto start = std::chrono::steady_clock::now();
+    ir.clear();
+    program.clear();
+    objectRanges.clear();
+    objects.clear();
+    bvh.clear();
+    sceneBounded = false;
+    domains = 1;
+    stats = sdfCompileStats();
+    stats.sourceNodes = scene.nodes.size();
+
+    std::stringstream out;
+    out << "// generated from " << ( scene.source.empty() ? std::string( "an unnamed scene" ) : scene.source ) << " by sdf_compiler.h\n\n";
+    if ( scene.nodes.empty() ) {
+      out << "float de( vec3 p ) {\n  statDECalls++;\n  return 1e10;\n}\n\n";
+      out << "vec2 deMaterial( vec3 p ) {\n  return vec2( de( p ), 0. );\n}\n";
+    } else {
+      int root = lower( scene, 0, frame(), 0, 1.0f );
+      root = simplify( root );
+      measure( root );
+      sceneBounded = ir[ root ].bounded;
+      sceneMin = ir[ root ].boundsMin;
+      sceneMax = ir[ root ].boundsMax;
+      stats.nodesRemoved = stats.sourceNodes - reachable( root );
+
+      // a root union splits into objects with a box, for the BVH, and the rest
+      std::vector< int > bounded, unbounded;
+      if ( ir[ root ].type == sdfNodeType::unite )
+        for ( int child : ir[ root ].children )
+          ( ir[ child ].bounded ? bounded : unbounded ).push_back( child );
+      if ( int( bounded.size() ) >= bvhMinObjects )
+        buildBVH( bounded );
+
+      if ( bvh.empty() ) {
+        for ( int material = 0; material < 2; material++ ) {
+          std::stringstream body;
+          variables = 0;
+          counting = !material;
+          std::string result = emit( root, true, material, 1, body );
+          if ( material )
+            out << "vec2 deMaterial( vec3 p0 ) {\n" << body.str() << "  return " << result << ";\n}\n";
+          else
+            out << "float de( vec3 p0 ) {\n  statDECalls++;\n" << body.str() << "  return " << result << ";\n}\n\n";
+        }
+        assemble( root, true );
+        rootLength = program.size();
+      } else {
+        emitObjects( unbounded, out );
+        assembleObjects( unbounded );
+      }
+    }
+    code = out.str();
+    programDepth();
+
+    stats.lines = 0;
+    for ( char c : code ) stats.lines += ( c == '\n' );
+    stats.compileMs = std::chrono::duration< float, std::milli >( std::chrono::steady_clock::now() - start ).count();
+  }
+
+private:
+  // domain variable pN to local: local = transpose( rotation ) * ( pN - center ) / scale
+  struct frame {
+    glm::mat3 rotation = glm::mat3( 1.0f );
+    glm::vec3 center = glm::vec3( 0.0f );
+    float scale = 1.0f;
+
+    frame compose( const sdfNode &n ) const {
+      frame f;
+      glm::quat q( n.rotation.w, n.rotation.x, n.rotation.y, n.rotation.z );
+      f.rotation = rotation * glm::mat3_cast( q );
+      for ( int i = 0; i < 3; i++ ) // snap the float noise of right angles, so they print clean
+        for ( int j = 0; j < 3; j++ )
+          for ( float v : { -1.0f, 0.0f, 1.0f } )
+            if ( std::abs( f.rotation[ i ][ j ] - v ) < 1e-6f ) f.rotation[ i ][ j ] = v;
+      f.center = center + scale * ( rotation * n.position );
+      f.scale = scale * n.scale;
+      return f;
+    }
+
+    bool rotated() const {
+      for ( int i = 0; i < 3; i++ )
+        for ( int j = 0; j < 3; j++ )
+          if ( std::abs( rotation[ i ][ j ] - ( i == j ? 1.0f : 0.0f ) ) > 1e-6f ) return true;
+      return false;
+    }
+  };
+
+  struct irNode {
+    sdfNodeType type;
+    int material = 0;
+    glm::vec4 params = glm::vec4( 0.0f ); // primitives: sizes in domain units, repeat: period and count
+    frame local;                          // primitives: placement in the domain, repeat: frame it repeats in
+    float blend = 0.0f;                   // smooth booleans, domain units
+    int domain = 0;                       // domain variable the node reads
+    float domainScale = 1.0f;             // domain units to world units
+    int innerDomain = 0;                  // repeat only, the variable its child reads
+    std::vector< int > children;
+
+    bool bounded = false;
+    glm::vec3 boundsMin = glm::vec3( 0.0f ), boundsMax = glm::vec3( 0.0f ); // domain units
+    int primitiveCount = 0;
+  };
+
+  std::vector< irNode > ir;
+  int domains = 1;
+  int variables = 0;
+  bool counting = false;      // emission pass that adds to the stats
+  std::vector< int > objects; // BVH leaf order, IR indices
+
+  static bool isSmooth( sdfNodeType t ) { return t >= sdfNodeType::smoothUnite && t <= sdfNodeType::smoothSubtract; }
+
+  // the hard boolean a boolean behaves like, for bounds - smooth versions only differ by the blend
+  static sdfNodeType hardVersion( sdfNodeType t ) {
+    switch ( t ) {
+      case sdfNodeType::smoothUnite:     return sdfNodeType::unite;
+      case sdfNodeType::smoothIntersect: return sdfNodeType::intersect;
+      case sdfNodeType::smoothSubtract:  return sdfNodeType::subtract;
+      default:                           return t;
+    }
+  }
+
+  // node tree to IR, folding transforms down to the primitives
+  int lower( const sceneDescription &scene, int index, const frame &parent, int domain, float domainScale ) {
+    const sdfNode &n = scene.nodes[ index ];
+    const sdfNodeType type = sdfNodeType( n.type );
+    frame f = parent.compose( n );
+    if ( n.position != glm::vec3( 0.0f ) || n.rotation != glm::vec4( 0.0f, 0.0f, 0.0f, 1.0f ) || n.scale != 1.0f )
+      stats.transformsFolded++;
+
+    irNode node;
+    node.type = type;
+    node.domain = domain;
+    node.domainScale = domainScale;
+
+    if ( isPrimitive( type ) ) {
+      node.material = std::max( n.material, 0 );
+      node.local = f;
+      node.params = n.params * f.scale;
+      if ( type == sdfNodeType::sphere ) node.local.rotation = glm::mat3( 1.0f ); // symmetric
+      ir.push_back( node );
+      return ir.size() - 1;
+    }
+
+    if ( type == sdfNodeType::repeat ) {
+      glm::vec3 period = glm::vec3( n.params );
+      if ( period == glm::vec3( 0.0f ) ) // nothing repeats, the child just sees the repeat's frame
+        return lower( scene, n.firstChild, f, domain, domainScale );
+      node.local = f;
+      node.params = n.params;
+      node.innerDomain = domains++;
+      int child = lower( scene, n.firstChild, frame(), node.innerDomain, domainScale * f.scale );
+      node.children.push_back( child );
+      ir.push_back( node );
+      return ir.size() - 1;
+    }
+
+    // booleans
+    node.blend = n.params.x * f.scale;
+    if ( isSmooth( type ) && node.blend <= 0.0f ) node.type = hardVersion( type );
+    for ( uint32_t i = 0; i < n.childCount; i++ ) {
+      int child = lower( scene, n.firstChild + i, f, domain, domainScale );
+      node.children.push_back( child );
+    }
+    ir.push_back( node );
+    return ir.size() - 1;
+  }
+
+  // bottom up rewrites, returns the index standing in for the node
+  int simplify( int index ) {
+    for ( auto &child : ir[ index ].children )
+      child = simplify( child );
+    irNode &node = ir[ index ];
+    if ( isPrimitive( node.type ) || node.type == sdfNodeType::repeat ) return index;
+
+    // ( a ∪ ( b ∪ c ) ) -> ( a ∪ b ∪ c ), same for intersections
+    if ( node.type == sdfNodeType::unite || node.type == sdfNodeType::intersect ) {
+      std::vector< int > flat;
+      for ( int child : node.children ) {
+        if ( ir[ child ].type == node.type )
+          flat.insert( flat.end(), ir[ child ].children.begin(), ir[ child ].children.end() );
+        else
+          flat.push_back( child );
+      }
+      ir[ index ].children = flat;
+    }
+
+    // cuts that can't reach the base shape do nothing
+    if ( ir[ index ].type == sdfNodeType::subtract || ir[ index ].type == sdfNodeType::smoothSubtract ) {
+      measure( index );
+      const irNode &n = ir[ index ];
+      std::vector< int > kept = { n.children[ 0 ] };
+      const irNode &base = ir[ n.children[ 0 ] ];
+      for ( size_t i = 1; i < n.children.size(); i++ ) {
+        const irNode &cut = ir[ n.children[ i ] ];
+        bool disjoint = base.bounded && cut.bounded &&
+          glm::any( glm::greaterThan( base.boundsMin - n.blend, cut.boundsMax ) || glm::lessThan( base.boundsMax + n.blend, cut.boundsMin ) );
+        if ( !disjoint ) kept.push_back( n.children[ i ] );
+      }
+      ir[ index ].children = kept;
+    }
+
+    if ( ir[ index ].children.size() == 1 ) return ir[ index ].children[ 0 ];
+    return index;
+  }
+
+  // conservative bounds and primitive counts, bottom up
+  void measure( int index ) {
+    irNode &node = ir[ index ];
+    node.primitiveCount = 0;
+    if ( isPrimitive( node.type ) ) {
+      node.primitiveCount = 1;
+      glm::vec3 extent;
+      const glm::vec4 &s = node.params;
+      switch ( node.type ) {
+        case sdfNodeType::sphere:   extent = glm::vec3( s.x ); break;
+        case sdfNodeType::box:
+        case sdfNodeType::roundBox: extent = glm::vec3( s ); break;
+        case sdfNodeType::torus:    extent = glm::vec3( s.x + s.y, s.y, s.x + s.y ); break;
+        case sdfNodeType::cylinder: extent = glm::vec3( s.x, s.y, s.x ); break;
+        case sdfNodeType::capsule:  extent = glm::vec3( s.x, s.y + s.x, s.x ); break;
+        default: node.bounded = false; return; // plane
+      }
+      glm::mat3 a = node.local.rotation;
+      for ( int i = 0; i < 3; i++ ) a[ i ] = glm::abs( a[ i ] );
+      glm::vec3 half = a * extent;
+      node.bounded = true;
+      node.boundsMin = node.local.center - half;
+      node.boundsMax = node.local.center + half;
+      return;
+    }
+
+    for ( int child : node.children ) {
+      measure( child );
+      node.primitiveCount += ir[ child ].primitiveCount;
+    }
+
+    if ( node.type == sdfNodeType::repeat ) {
+      const irNode &child = ir[ node.children[ 0 ] ];
+      glm::vec3 period = glm::vec3( node.params );
+      node.bounded = child.bounded && node.params.w > 0.0f;
+      if ( !node.bounded ) return;
+      // the copies, in the repeat's frame, then out to the parent domain
+      glm::vec3 reach = period * node.params.w;
+      glm::vec3 center = 0.5f * ( child.boundsMin + child.boundsMax );
+      glm::vec3 half = 0.5f * ( child.boundsMax - child.boundsMin ) + reach;
+      glm::mat3 a = node.local.rotation;
+      for ( int i = 0; i < 3; i++ ) a[ i ] = glm::abs( a[ i ] );
+      center = node.local.center + node.local.scale * ( node.local.rotation * center );
+      half = node.local.scale * ( a * half );
+      node.boundsMin = center - half;
+      node.boundsMax = center + half;
+      return;
+    }
+
+    const irNode &first = ir[ node.children[ 0 ] ];
+    switch ( hardVersion( node.type ) ) {
+      case sdfNodeType::unite: // every child, grown by the blend
+        node.bounded = true;
+        node.boundsMin = glm::vec3( 1e30f );
+        node.boundsMax = glm::vec3( -1e30f );
+        for ( int child : node.children ) {
+          node.bounded = node.bounded && ir[ child ].bounded;
+          node.boundsMin = glm::min( node.boundsMin, ir[ child ].boundsMin - node.blend );
+          node.boundsMax = glm::max( node.boundsMax, ir[ child ].boundsMax + node.blend );
+        }
+        break;
+      case sdfNodeType::intersect: // overlap of the bounded children - smooth only takes away
+        node.bounded = false;
+        for ( int child : node.children ) {
+          if ( !ir[ child ].bounded ) continue;
+          node.boundsMin = node.bounded ? glm::max( node.boundsMin, ir[ child ].boundsMin ) : ir[ child ].boundsMin;
+          node.boundsMax = node.bounded ? glm::min( node.boundsMax, ir[ child ].boundsMax ) : ir[ child ].boundsMax;
+          node.bounded = true;
+        }
+        if ( node.bounded ) node.boundsMax = glm::max( node.boundsMax, node.boundsMin );
+        break;
+      default: // subtract, the base shape
+        node.bounded = first.bounded;
+        node.boundsMin = first.boundsMin;
+        node.boundsMax = first.boundsMax;
+        break;
+    }
+  }
+
+  int reachable( int index ) const {
+    int count = 1;
+    for ( int child : ir[ index ].children ) count += reachable( child );
+    return count;
+  }
+
+  static std::string number( float v ) {
+    std::stringstream s;
+    s.precision( 7 );
+    s << v;
+    std::string r = s.str();
+    if ( r.find_first_of( ".e" ) == std::string::npos ) r += ".";
+    return r;
+  }
+
+  static std::string vec( const glm::vec3 &v ) {
+    return "vec3( " + number( v.x ) + ", " + number( v.y ) + ", " + number( v.z ) + " )";
+  }
+
+  // local point of a primitive, from its domain variable
+  static std::string localPoint( const irNode &n ) {
+    std::string p = "p" + std::to_string( n.domain );
+    if ( n.local.center != glm::vec3( 0.0f ) ) p = "( " + p + " - " + vec( n.local.center ) + " )";
+    if ( n.local.rotated() ) {
+      const glm::mat3 t = glm::transpose( n.local.rotation );
+      p = "mat3( " + vec( t[ 0 ] ) + ", " + vec( t[ 1 ] ) + ", " + vec( t[ 2 ] ) + " ) * " + p;
+    }
+    return p;
+  }
+
+  std::string primitive( const irNode &n ) {
+    const glm::vec4 &s = n.params;
+    const std::string p = localPoint( n );
+    std::string d;
+    switch ( n.type ) {
+      case sdfNodeType::sphere:   d = "sdSphere( " + p + ", " + number( s.x ) + " )"; break;
+      case sdfNodeType::box:      d = "sdBox( " + p + ", " + vec( glm::vec3( s ) ) + " )"; break;
+      case sdfNodeType::roundBox: d = "sdRoundBox( " + p + ", " + vec( glm::vec3( s ) ) + ", " + number( s.w ) + " )"; break;
+      case sdfNodeType::torus:    d = "sdTorus( " + p + ", vec2( " + number( s.x ) + ", " + number( s.y ) + " ) )"; break;
+      case sdfNodeType::cylinder: d = "sdCylinder( " + p + ", " + number( s.x ) + ", " + number( s.y ) + " )"; break;
+      case sdfNodeType::capsule:  d = "sdCapsule( " + p + ", " + number( s.x ) + ", " + number( s.y ) + " )"; break;
+      default: { // plane, only the height along the rotated up axis
+        std::string q = "p" + std::to_string( n.domain );
+        if ( n.local.center != glm::vec3( 0.0f ) ) q = "( " + q + " - " + vec( n.local.center ) + " )";
+        d = n.local.rotated() ? "dot( " + q + ", " + vec( n.local.rotation[ 1 ] ) + " )" : "sdPlane( " + q + " )";
+        break;
+      }
+    }
+    if ( n.domainScale != 1.0f ) d += " * " + number( n.domainScale );
+    return d;
+  }
+
+  // rows of the affine from a domain point to the frame's local point - the scale is left to the caller
+  static void affineRows( const frame &f, glm::vec4 rows[ 3 ] ) {
+    const glm::vec3 offset = -( glm::transpose( f.rotation ) * f.center );
+    for ( int i = 0; i < 3; i++ ) // rows of the transpose are the columns
+      rows[ i ] = glm::vec4( f.rotation[ i ], offset[ i ] );
+  }
+
+  // postfix program for the node into program, bounds where emit() would put them
+  void assemble( int index, bool monotone ) {
+    const irNode &n = ir[ index ];
+    sdfInstruction i;
+    i.op = uint32_t( n.type );
+    for ( auto &row : i.transform ) row = glm::vec4( 0.0f );
+
+    if ( monotone && n.bounded && n.primitiveCount >= boundsMinPrimitives ) {
+      sdfInstruction bound = i;
+      bound.op = sdfOpBound;
+      bound.scale = n.domainScale;
+      bound.params = glm::vec4( 0.5f * ( n.boundsMin + n.boundsMax ), boundsMargin );
+      bound.transform[ 0 ] = glm::vec4( 0.5f * ( n.boundsMax - n.boundsMin ), 0.0f );
+      size_t slot = program.size();
+      program.push_back( bound );
+      assembleNode( index, true );
+      program[ slot ].skip = program.size() - slot - 1;
+      return;
+    }
+    assembleNode( index, monotone );
+  }
+
+  void assembleNode( int index, bool monotone ) {
+    const irNode &n = ir[ index ];
+    sdfInstruction i;
+    i.op = uint32_t( n.type );
+    for ( auto &row : i.transform ) row = glm::vec4( 0.0f );
+
+    if ( isPrimitive( n.type ) ) {
+      i.material = n.material;
+      i.scale = n.domainScale;
+      i.params = n.params;
+      affineRows( n.local, i.transform );
+      program.push_back( i );
+      return;
+    }
+
+    if ( n.type == sdfNodeType::repeat ) {
+      i.scale = n.local.scale;
+      i.params = n.params;
+      affineRows( n.local, i.transform );
+      program.push_back( i );
+      assemble( n.children[ 0 ], monotone );
+      sdfInstruction pop = i;
+      pop.op = sdfOpPopDomain;
+      program.push_back( pop );
+      return;
+    }
+
+    const bool cuts = n.type == sdfNodeType::subtract || n.type == sdfNodeType::smoothSubtract;
+    i.params.x = n.blend * n.domainScale;
+    assemble( n.children[ 0 ], monotone );
+    for ( size_t c = 1; c < n.children.size(); c++ ) {
+      assemble( n.children[ c ], monotone && !cuts );
+      program.push_back( i );
+    }
+  }
+
+  // deepest the two stacks get - walking the program without taking any skips is the worst case, a
+  // skip pushes one value where the subtree it skips would have pushed one in the end
+  // each range runs on its own stacks
+  void programDepth() {
+    stats.stackDepth = stats.domainDepth = 0;
+    std::vector< sdfObjectRange > ranges = objectRanges;
+    ranges.push_back( { 0, rootLength } );
+    for ( auto &range : ranges ) {
+      int depth = 0, domainDepth = 0;
+      for ( uint32_t pc = range.first; pc < range.first + range.count; pc++ ) {
+        const sdfInstruction &i = program[ pc ];
+        if ( i.op == sdfOpBound ) continue;
+        if ( i.op <= uint32_t( sdfNodeType::plane ) ) depth++;
+        else if ( i.op == uint32_t( sdfNodeType::repeat ) ) domainDepth++;
+        else if ( i.op == sdfOpPopDomain ) domainDepth--;
+        else depth--;
+        stats.stackDepth = std::max( stats.stackDepth, depth );
+        stats.domainDepth = std::max( stats.domainDepth, domainDepth );
+      }
+    }
+    stats.instructions = program.size();
+    programFits = stats.stackDepth <= sdfStackSize && stats.domainDepth < sdfDomainStackSize;
+  }
+
+  // median split on the longest axis of the centroids - objects end up in leaf order
+  void buildBVH( const std::vector< int > &bounded ) {
+    std::vector< int > items = bounded;
+    bvh.resize( 1 );
+    stats.bvhDepth = 0;
+    buildNode( 0, items, 0, items.size(), 1 );
+    if ( stats.bvhDepth >= sdfBVHStackSize ) { // too deep for the traversal stack, evaluate everything
+      bvh.clear();
+      objects.clear();
+      stats.bvhDepth = 0;
+      return;
+    }
+    stats.bvhObjects = objects.size();
+    stats.bvhNodes = bvh.size();
+  }
+
+  void buildNode( int slot, std::vector< int > &items, size_t begin, size_t end, int depth ) {
+    stats.bvhDepth = std::max( stats.bvhDepth, depth );
+    glm::vec3 boundsMin( 1e30f ), boundsMax( -1e30f ), centroidMin( 1e30f ), centroidMax( -1e30f );
+    for ( size_t i = begin; i < end; i++ ) {
+      const irNode &n = ir[ items[ i ] ];
+      boundsMin = glm::min( boundsMin, n.boundsMin );
+      boundsMax = glm::max( boundsMax, n.boundsMax );
+      centroidMin = glm::min( centroidMin, n.boundsMin + n.boundsMax );
+      centroidMax = glm::max( centroidMax, n.boundsMin + n.boundsMax );
+    }
+    bvh[ slot ].boundsMin = boundsMin;
+    bvh[ slot ].boundsMax = boundsMax;
+
+    if ( end - begin <= size_t( std::max( bvhLeafSize, 1 ) ) ) {
+      bvh[ slot ].first = objects.size();
+      bvh[ slot ].count = end - begin;
+      objects.insert( objects.end(), items.begin() + begin, items.begin() + end );
+      return;
+    }
+
+    const glm::vec3 extent = centroidMax - centroidMin;
+    const int axis = extent.x > extent.y ? ( extent.x > extent.z ? 0 : 2 ) : ( extent.y > extent.z ? 1 : 2 );
+    const size_t middle = ( begin + end ) / 2;
+    std::nth_element( items.begin() + begin, items.begin() + middle, items.begin() + end, [ & ]( int a, int b ) {
+      return ir[ a ].boundsMin[ axis ] + ir[ a ].boundsMax[ axis ] < ir[ b ].boundsMin[ axis ] + ir[ b ].boundsMax[ axis ];
+    } );
+    const int left = bvh.size();
+    bvh.resize( bvh.size() + 2 );
+    bvh[ slot ].first = left;
+    bvh[ slot ].count = 0;
+    buildNode( left, items, begin, middle, depth + 1 );
+    buildNode( left + 1, items, middle, end, depth + 1 );
+  }
+
+  // sceneObject() with a case per BVH object, sceneUnbounded() for the rest, and the traversal over both
+  void emitObjects( const std::vector< int > &unbounded, std::stringstream &out ) {
+    counting = true;
+    out << "vec2 sceneObject( uint id, vec3 p0 ) {\n  switch ( id ) {\n";
+    for ( size_t o = 0; o < objects.size(); o++ ) {
+      std::stringstream body;
+      variables = 0;
+      std::string result = emitNode( objects[ o ], true, true, 3, body ); // the leaf box stands in for its own check
+      out << "    case " << o << "u: {\n" << body.str() << "      return " << result << ";\n    }\n";
+    }
+    out << "  }\n  return vec2( 1e10, 0. );\n}\n\n";
+
+    std::stringstream body;
+    variables = 0;
+    std::string result = "vec2( 1e10, 0. )";
+    for ( size_t u = 0; u < unbounded.size(); u++ ) {
+      std::string d = emit( unbounded[ u ], true, true, 1, body );
+      if ( u ) body << "  " << result << " = opUnion( " << result << ", " << d << " );\n";
+      else result = d;
+    }
+    stats.unboundedObjects = unbounded.size();
+    out << "vec2 sceneUnbounded( vec3 p0 ) {\n" << body.str() << "  return " << result << ";\n}\n\n";
+    out << "#include \"sdf_bvh.glsl\"\n\n";
+    out << "float de( vec3 p ) {\n  statDECalls++;\n  return sceneTraverse( p ).x;\n}\n\n";
+    out << "vec2 deMaterial( vec3 p ) {\n  return sceneTraverse( p );\n}\n";
+    counting = false;
+  }
+
+  // the unbounded objects' union first, then a range per BVH object
+  void assembleObjects( const std::vector< int > &unbounded ) {
+    sdfInstruction unite;
+    unite.op = uint32_t( sdfNodeType::unite );
+    for ( auto &row : unite.transform ) row = glm::vec4( 0.0f );
+    for ( size_t u = 0; u < unbounded.size(); u++ ) {
+      assemble( unbounded[ u ], true );
+      if ( u ) program.push_back( unite );
+    }
+    rootLength = program.size();
+    for ( int object : objects ) {
+      sdfObjectRange range;
+      range.first = program.size();
+      assembleNode( object, true );
+      range.count = program.size() - range.first;
+      objectRanges.push_back( range );
+    }
+  }
+
+  static std::string opName( sdfNodeType t ) {
+    switch ( t ) {
+      case sdfNodeType::unite:           return "opUnion";
+      case sdfNodeType::intersect:       return "opIntersect";
+      case sdfNodeType::subtract:        return "opSubtract";
+      case sdfNodeType::smoothUnite:     return "opSmoothUnion";
+      case sdfNodeType::smoothIntersect: return "opSmoothIntersect";
+      default:                           return "opSmoothSubtract";
+    }
+  }
+
+  // statements for the node into body, returns the variable holding its result - monotone says a lower
+  // bound is a safe stand in for the node's value here
+  std::string emit( int index, bool monotone, bool material, int depth, std::stringstream &body ) {
+    const irNode &n = ir[ index ];
+    const std::string indent( depth * 2, ' ' ), type = material ? "vec2" : "float";
+
+    if ( monotone && n.bounded && n.primitiveCount >= boundsMinPrimitives ) {
+      const std::string name = "d" + std::to_string( variables++ );
+      glm::vec3 center = 0.5f * ( n.boundsMin + n.boundsMax ), half = 0.5f * ( n.boundsMax - n.boundsMin );
+      std::string box = "sdBound( p" + std::to_string( n.domain ) + ", " + vec( center ) + ", " + vec( half ) + " )";
+      if ( n.domainScale != 1.0f ) box += " * " + number( n.domainScale );
+      body << indent << type << " " << name << " = " << ( material ? "vec2( " + box + ", 0. )" : box ) << ";\n";
+      body << indent << "if ( " << name << ( material ? ".x" : "" ) << " < " << number( boundsMargin ) << " ) {\n";
+      std::string inner = emitNode( index, true, material, depth + 1, body );
+      body << indent << "  " << name << " = " << inner << ";\n";
+      body << indent << "}\n";
+      if ( counting ) stats.boundsChecks++;
+      return name;
+    }
+    return emitNode( index, monotone, material, depth, body );
+  }
+
+  std::string emitNode( int index, bool monotone, bool material, int depth, std::stringstream &body ) {
+    const irNode &n = ir[ index ];
+    const std::string indent( depth * 2, ' ' ), type = material ? "vec2" : "float";
+
+    if ( isPrimitive( n.type ) ) {
+      const std::string name = "d" + std::to_string( variables++ );
+      if ( counting ) stats.primitives++;
+      std::string d = primitive( n );
+      body << indent << type << " " << name << " = " << ( material ? "vec2( " + d + ", " + number( float( n.material ) ) + " )" : d ) << ";\n";
+      return name;
+    }
+
+    if ( counting ) stats.operations++;
+    if ( n.type == sdfNodeType::repeat ) {
+      irNode placement = n;
+      placement.type = sdfNodeType::box; // only for the local point
+      std::string p = localPoint( placement );
+      if ( n.local.scale != 1.0f ) p = "( " + p + " ) / " + number( n.local.scale );
+      body << indent << "vec3 p" << n.innerDomain << " = opRepeat( " << p << ", " << vec( glm::vec3( n.params ) ) << ", " << number( n.params.w ) << " );\n";
+      return emit( n.children[ 0 ], monotone, material, depth, body );
+    }
+
+    // booleans, accumulated into the first child's variable - the cut side of a subtract grows where
+    // its operand shrinks, so no bounds below it
+    const bool cuts = n.type == sdfNodeType::subtract || n.type == sdfNodeType::smoothSubtract;
+    const std::string name = emit( n.children[ 0 ], monotone, material, depth, body );
+    for ( size_t i = 1; i < n.children.size(); i++ ) {
+      std::string operand = emit( n.children[ i ], monotone && !cuts, material, depth, body );
+      body << indent << name << " = " << opName( n.type ) << "( " << name << ", " << operand;
+      if ( isSmooth( n.type ) ) body << ", " << number( n.blend * n.domainScale );
+      body << " );\n";
+    }
+    return name;
+  }
+};
+
+#endif
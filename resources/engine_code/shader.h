@@ -17,6 +17,7 @@
 #include <string>
 #include <sstream>
 #include <vector>
+#include <map>
 
 using std::cin;
 using std::cout;
@@ -25,6 +26,56 @@ using std::cerr;
 using std::flush;
 using std::endl;
 
+// GLSL has no include mechanism of its own - this replaces lines of the form #include "file" with the
+// contents of that file, resolved relative to the including file's directory
+inline std::string shaderDirectory( const std::string &path )
+{
+    size_t slash = path.find_last_of( '/' );
+    return slash == std::string::npos ? std::string( "" ) : path.substr( 0, slash + 1 );
+}
+
+// source generated at runtime, standing in for an include file - keyed by the name in the #include line,
+// and it can #include files of its own
+typedef std::map< std::string, std::string > shaderGenerated;
+
+inline std::string preprocessIncludes( const std::string &source, const std::string &directory, const shaderGenerated &generated = shaderGenerated( ), int depth = 0 )
+{
+    std::stringstream in( source ), out;
+    std::string line;
+    while ( std::getline( in, line ) )
+    {
+        size_t first = line.find_first_not_of( " \t" );
+        if ( first != std::string::npos && line.compare( first, 8, "#include" ) == 0 )
+        {
+            size_t open = line.find( '"' ), close = line.rfind( '"' );
+            if ( open != std::string::npos && close > open )
+            {
+                auto replacement = generated.find( line.substr( open + 1, close - open - 1 ) );
+                if ( replacement != generated.end( ) && depth <= 16 )
+                {
+                    out << preprocessIncludes( replacement->second, directory, generated, depth + 1 ) << "\n";
+                    continue;
+                }
+            }
+            std::string path = ( open != std::string::npos && close > open ) ? directory + line.substr( open + 1, close - open - 1 ) : "";
+            std::ifstream includeFile( path );
+            if ( path.empty( ) || !includeFile.good( ) || depth > 16 )
+            {
+                std::cout << "ERROR::SHADER::INCLUDE_FAILED " << line << std::endl;
+                continue;
+            }
+            std::stringstream includeStream;
+            includeStream << includeFile.rdbuf( );
+            out << preprocessIncludes( includeStream.str( ), shaderDirectory( path ), generated, depth + 1 ) << "\n";
+        }
+        else
+        {
+            out << line << "\n";
+        }
+    }
+    return out.str( );
+}
+
 class Shader
 {
   public:
@@ -54,8 +105,8 @@ class Shader
             vShaderFile.close( );
             fShaderFile.close( );
             // Convert stream into string
-            vertexCode = vShaderStream.str( );
-            fragmentCode = fShaderStream.str( );
+            vertexCode = preprocessIncludes( vShaderStream.str( ), shaderDirectory( vertexPath ) );
+            fragmentCode = preprocessIncludes( fShaderStream.str( ), shaderDirectory( fragmentPath ) );
         }
         catch ( std::ifstream::failure &e )
         {
@@ -134,7 +185,7 @@ class CShader //very similar to above, but for compute shader instead of vertex/
   public:
     GLuint Program;
     // Constructor generates the shader on the fly
-    CShader( const GLchar *Path, bool verbose=false)
+    CShader( const GLchar *Path, bool verbose=false, const shaderGenerated &generated = shaderGenerated( ) )
     {
 
         // 1. Retrieve the compute shader source code from Path
@@ -152,7 +203,7 @@ class CShader //very similar to above, but for compute shader instead of vertex/
             // close file handlers
             File.close( );
             // Convert stream into string
-            Code = ShaderStream.str( );
+            Code = preprocessIncludes( ShaderStream.str( ), shaderDirectory( Path ), generated );
         }
         catch ( std::ifstream::failure &e )
         {
@@ -1,10 +1,18 @@
 #version 430 core
-layout( binding = 0 ) uniform sampler2D current;
+layout( binding = 0 ) uniform sampler2D current;   // displayTexture, when the image was produced in compute
+layout( binding = 14 ) uniform sampler2D source;   // accumulator or denoised result, for the fused path
+
+#include "tonemap.glsl"
 
 uniform vec2 resolution;
+uniform bool fused;        // tonemap + dither here, straight from the float source
 out vec4 fragmentOutput;
 
 void main() {
   // fragmentOutput = vec4( vec3( int( gl_FragCoord.x ) ^ int( gl_FragCoord.y ) ) / 1023., 1.0 );
-	fragmentOutput = texture( current, gl_FragCoord.xy / resolution );
+  vec2 uv = gl_FragCoord.xy / resolution;
+  if ( fused )
+    fragmentOutput = vec4( present( texture( source, uv ).rgb, ivec2( gl_FragCoord.xy ) ), 1.0 );
+  else
+    fragmentOutput = texture( current, uv );
 }
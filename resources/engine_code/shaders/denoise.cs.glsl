@@ -0,0 +1,86 @@
+#version 430 core
+layout( local_size_x = 32, local_size_y = 32, local_size_z = 1 ) in;
+
+// edge-aware à-trous wavelet filter - one pass per dispatch, tap spacing doubles each pass
+
+layout( binding = 1, rgba32f ) uniform image2D accumulator; // color in rgb, sample count in a
+layout( binding = 4, rgba32f ) uniform image2D normalDepth; // normal in rgb, depth in a
+layout( binding = 5, rg32f )   uniform image2D moments;     // first and second luminance moments
+layout( binding = 6, rgba32f ) uniform image2D source;      // ping-pong input, color in rgb, variance in a
+layout( binding = 7, rgba32f ) uniform image2D destination; // ping-pong output, same layout
+
+uniform int   stepSize;         // spacing between taps, 1 << pass index
+uniform bool  firstPass;        // first pass reads the accumulator + moments instead of the source
+uniform float strength;         // base filter strength
+uniform float falloff;          // sample count at which the filter strength has halved
+uniform float sigmaNormal;      // exponent on the normal similarity term
+uniform float sigmaDepth;       // relative depth tolerance
+uniform float sigmaLuminance;   // luminance tolerance, in standard deviations
+
+// B3 spline kernel, 5 taps on each axis
+const float kernel[ 3 ] = float[ 3 ]( 3. / 8., 1. / 4., 1. / 16. );
+
+float luminance( vec3 c ) {
+  return dot( c, vec3( 0.2126, 0.7152, 0.0722 ) );
+}
+
+vec4 colorAndVariance( ivec2 location ) {
+  if ( firstPass ) {
+    vec4 accumulated = imageLoad( accumulator, location );
+    vec2 m = imageLoad( moments, location ).xy;
+    // variance of the running mean falls off as 1 / n
+    float variance = max( 0., m.y - m.x * m.x ) / max( accumulated.a, 1. );
+    return vec4( accumulated.rgb, variance );
+  } else {
+    return imageLoad( source, location );
+  }
+}
+
+void main() {
+  ivec2 location = ivec2( gl_GlobalInvocationID.xy );
+  ivec2 bounds = imageSize( accumulator );
+  if ( location.x >= bounds.x || location.y >= bounds.y ) return;
+
+  vec4 center = colorAndVariance( location );
+
+  // filter strength falls as the sample count rises
+  float sampleCount = imageLoad( accumulator, location ).a;
+  float s = strength / ( 1. + sampleCount / falloff );
+  if ( s < 0.001 ) { // converged enough that the filter would be a no-op
+    imageStore( destination, location, center );
+    return;
+  }
+
+  vec4 centerND = imageLoad( normalDepth, location );
+  float centerLum = luminance( center.rgb );
+  float lumTolerance = sigmaLuminance * s * sqrt( center.a ) + 1e-6;
+  float depthTolerance = sigmaDepth * max( centerND.a, 1e-3 ) * float( stepSize ) * 0.01 + 1e-6;
+
+  vec3  colorSum    = vec3( 0. );
+  float varianceSum = 0.;
+  float weightSum   = 0.;
+
+  for ( int y = -2; y <= 2; y++ ) {
+    for ( int x = -2; x <= 2; x++ ) {
+      ivec2 tap = clamp( location + ivec2( x, y ) * stepSize, ivec2( 0 ), bounds - ivec2( 1 ) );
+      vec4 tapCV = colorAndVariance( tap );
+      vec4 tapND = imageLoad( normalDepth, tap );
+
+      // edge stopping functions
+      float wN = pow( max( dot( centerND.rgb, tapND.rgb ), 0. ), sigmaNormal );
+      float wD = exp( -abs( centerND.a - tapND.a ) / depthTolerance );
+      float wL = exp( -abs( centerLum - luminance( tapCV.rgb ) ) / lumTolerance );
+
+      // a miss has a zero normal - fall back to depth + luminance only
+      if ( dot( centerND.rgb, centerND.rgb ) < 0.5 ) wN = 1.;
+
+      float w = kernel[ abs( x ) ] * kernel[ abs( y ) ] * wN * wD * wL;
+      colorSum    += w * tapCV.rgb;
+      varianceSum += w * w * tapCV.a;
+      weightSum   += w;
+    }
+  }
+
+  // the center tap always has full weight, so weightSum is never zero
+  imageStore( destination, location, vec4( colorSum / weightSum, varianceSum / ( weightSum * weightSum ) ) );
+}
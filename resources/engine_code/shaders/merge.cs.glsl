@@ -0,0 +1,33 @@
+#version 430 core
+layout( local_size_x = 32, local_size_y = 32, local_size_z = 1 ) in;
+
+// merge a tile rendered elsewhere into the local buffers - everything here is a running mean, so each
+// is combined weighted by the sample counts on either side
+
+layout( binding = 1, rgba32f ) uniform image2D accumulator;
+layout( binding = 4, rgba32f ) uniform image2D normalDepth;
+layout( binding = 5, rg32f )   uniform image2D moments;
+
+// the incoming tile, uploaded from a worker's result
+layout( binding = 15 ) uniform sampler2D tileAccumulator;
+layout( binding = 16 ) uniform sampler2D tileNormalDepth;
+layout( binding = 17 ) uniform sampler2D tileMoments;
+
+uniform ivec2 tileOffset;
+
+void main() {
+  ivec2 source = ivec2( gl_GlobalInvocationID.xy );
+  ivec2 location = source + tileOffset;
+  if ( any( greaterThanEqual( location, imageSize( accumulator ) ) ) ) return;
+
+  vec4 incoming = texelFetch( tileAccumulator, source, 0 );
+  if ( incoming.a <= 0. ) return;
+
+  vec4 current = imageLoad( accumulator, location );
+  float count = max( current.a, 0. ) + incoming.a;
+  float weight = incoming.a / count;
+
+  imageStore( accumulator, location, vec4( mix( current.rgb, incoming.rgb, weight ), count ) );
+  imageStore( normalDepth, location, mix( imageLoad( normalDepth, location ), texelFetch( tileNormalDepth, source, 0 ), weight ) );
+  imageStore( moments, location, mix( imageLoad( moments, location ), texelFetch( tileMoments, source, 0 ), weight ) );
+}
@@ -1,10 +1,43 @@
 #version 430 core
+#extension GL_KHR_shader_subgroup_basic : enable
+#extension GL_KHR_shader_subgroup_arithmetic : enable
 layout( local_size_x = 32, local_size_y = 32, local_size_z = 1 ) in;
 
 layout( binding = 1, rgba32f ) uniform image2D accumulator;
-// add another texture to hold normals in R, G, B and depth in A
-
-layout( binding = 3, rgba8ui ) uniform uimage2D blueNoise;
+layout( binding = 4, rgba32f ) uniform image2D normalDepth; // normals in R, G, B and depth in A
+layout( binding = 5, rg32f )   uniform image2D moments;     // luminance moments, for denoiser variance
+
+layout( binding = 2, rgba8ui ) readonly uniform uimage2DArray blueNoise; // see blue_noise.h
+
+// optional instrumentation - tallied per invocation, summed across the subgroup, one atomic per subgroup
+layout( binding = 2, std430 ) buffer pathtraceStats {
+  uint primaryRays;
+  uint bounceRays;
+  uint deCalls;
+  uint misses;
+  uint stepLimitHits;
+};
+uniform bool collectStats;
+uint statPrimaryRays = 0u;
+uint statBounceRays = 0u;
+uint statDECalls = 0u;
+uint statMisses = 0u;
+uint statStepLimitHits = 0u;
+
+#ifdef GL_KHR_shader_subgroup_arithmetic
+  #define STAT_ADD( counter, value ) { uint total = subgroupAdd( value ); if ( subgroupElect() && total > 0u ) atomicAdd( counter, total ); }
+#else
+  #define STAT_ADD( counter, value ) { if ( value > 0u ) atomicAdd( counter, value ); }
+#endif
+
+void flushStats() {
+  if ( !collectStats ) return;
+  STAT_ADD( primaryRays, statPrimaryRays );
+  STAT_ADD( bounceRays, statBounceRays );
+  STAT_ADD( deCalls, statDECalls );
+  STAT_ADD( misses, statMisses );
+  STAT_ADD( stepLimitHits, statStepLimitHits );
+}
 
 #define PI 3.1415926535897932384626433832795
 #define AA 2 // each sample is actually 2^2 = 4 offset samples
@@ -12,6 +45,9 @@ layout( binding = 3, rgba8ui ) uniform uimage2D blueNoise;
 // core rendering stuff
 uniform ivec2 tileOffset;       // tile renderer offset for the current tile
 uniform ivec2 noiseOffset;      // jitters the noise sample read locations
+uniform int   noiseSlice;       // blue noise slice for this sample index
+uniform uint  frameIndex;       // advances every dispatch, decorrelates the RNG across samples
+uniform uint  renderSeed;       // --seed, hashed into the RNG so separate renders don't share streams
 uniform int   maxSteps;         // max steps to hit
 uniform int   maxBounces;       // number of pathtrace bounces
 uniform float maxDistance;      // maximum ray travel
@@ -36,6 +72,7 @@ uniform float lensIOR;          // index of refraction for the lens
 
 // global state
 float sampleCount = 0.0;
+uint pixelSampleIndex = 0u; // this pixel's sample number, indexes its sample sequence
 
 
 bool boundsCheck( ivec2 loc ) { // used to abort off-image samples
@@ -44,13 +81,15 @@ bool boundsCheck( ivec2 loc ) { // used to abort off-image samples
 }
 
 
-vec4 blueNoiseReference( ivec2 location ) { // jitter source
-  location.x = location.x % imageSize( blueNoise ).x;
-  location.y = location.y % imageSize( blueNoise ).y;
-  return vec4( imageLoad( blueNoise, location ) / 255. );
+vec4 blueNoiseReference( ivec2 location ) { // jitter source, four independent channels in [0,1)
+  ivec2 noiseSize = imageSize( blueNoise ).xy;
+  location = ( location + noiseOffset ) % noiseSize;
+  return ( vec4( imageLoad( blueNoise, ivec3( location, noiseSlice ) ) ) + 0.5 ) / 256.;
 }
 
-// random utilites
+#include "sampler.glsl"
+
+// random utilites - plain hashing, for anything that isn't a sampled dimension
 uint seed = 0;
 uint wangHash() {
   seed = uint( seed ^ uint( 61 ) ) ^ uint( seed >> uint( 16 ) );
@@ -65,9 +104,10 @@ float randomFloat() {
   return float( wangHash() ) / 4294967296.0;
 }
 
-vec3 randomUnitVector() {
-  float z = randomFloat() * 2.0f - 1.0f;
-  float a = randomFloat() * 2. * PI;
+vec3 randomUnitVector() { // takes the next two sampler dimensions
+  vec2 u = nextSample2D();
+  float z = u.x * 2.0f - 1.0f;
+  float a = u.y * 2. * PI;
   float r = sqrt( 1.0f - z * z );
   float x = r * cos( a );
   float y = r * sin( a );
@@ -84,6 +124,7 @@ vec3 randomInUnitDisk() {
 
 // surface distance estimate for the lens
 float lensDE( vec3 p ) {
+  statDECalls++;
   return 0.; // currently placeholder
 }
 
@@ -114,9 +155,24 @@ vec3 lensNorm( vec3 p ) {
 
 
 
-// surface distance estimate for the whole scene
-float de( vec3 p ) {
-  return 0.; // currently placeholder
+// surface distance estimate for the whole scene - de() and deMaterial(), compiled from the scene file
+#include "sdf.glsl"
+#include "scene_de.glsl"
+
+// deCached() - de() from the distance cache where it's been baked, for marching, see engine_cache.cc
+#include "sdf_cache.glsl"
+#include "sdf_cache_lookup.glsl"
+
+// VAT terrain alongside the scene, see engine_vat.cc
+#include "vat_terrain.glsl"
+#include "vat_tree.glsl"
+
+float deScene( vec3 p ) {
+  return opUnion( de( p ), deTerrain( p ) );
+}
+
+vec2 deSceneMaterial( vec3 p ) {
+  return opUnion( deMaterial( p ), deTerrainMaterial( p ) );
 }
 
 // normalized gradient of the SDF - 3 different methods
@@ -126,17 +182,17 @@ vec3 norm( vec3 p ) {
 
     case 0: // tetrahedron version, unknown original source - 4 DE evaluations
       e = vec2( 1.0, -1.0 ) * epsilon;
-      return normalize( e.xyy * de( p + e.xyy ) + e.yyx * de( p + e.yyx ) + e.yxy * de( p + e.yxy ) + e.xxx * de( p + e.xxx ) );
+      return normalize( e.xyy * deScene( p + e.xyy ) + e.yyx * deScene( p + e.yyx ) + e.yxy * deScene( p + e.yxy ) + e.xxx * deScene( p + e.xxx ) );
       break;
 
     case 1: // from iq = more efficient, 4 DE evaluations
       e = vec2( epsilon, 0.0 );
-      return normalize( vec3( de( p ) ) - vec3( de( p - e.xyy ), de( p - e.yxy ), de( p - e.yyx ) ) );
+      return normalize( vec3( deScene( p ) ) - vec3( deScene( p - e.xyy ), deScene( p - e.yxy ), deScene( p - e.yyx ) ) );
       break;
 
     case 2: // from iq - less efficient, 6 DE evaluations
       e = vec2( epsilon, 0.0 );
-      return normalize( vec3( de( p + e.xyy ) - de( p - e.xyy ), de( p + e.yxy ) - de( p - e.yxy ), de( p + e.yyx ) - de( p - e.yyx ) ) );
+      return normalize( vec3( deScene( p + e.xyy ) - deScene( p - e.xyy ), deScene( p + e.yxy ) - deScene( p - e.yxy ), deScene( p + e.yyx ) - deScene( p - e.yyx ) ) );
       break;
 
     default:
@@ -147,25 +203,78 @@ vec3 norm( vec3 p ) {
 
 
 
+// set by raymarch() when the ray ended on the 64-tree terrain - its face normal and cell state
+bool hitTree = false;
+vec3 hitTreeNormal;
+uint hitTreeState;
+
+// sphere trace the scene, returns distance to the hit or maxDistance on a miss - with the 64-tree
+// terrain, the ray is cast against that first, and marching stops at its hit
+float raymarch( vec3 ro, vec3 rd ) {
+  float limit = maxDistance;
+  hitTree = false;
+  vatFieldFallback = false;
+  if ( vatActive != 0 && vatTraversal == 1 ) {
+    limit = vatTreeTrace( ro, rd, maxDistance, hitTreeNormal, hitTreeState );
+    hitTree = limit < maxDistance;
+  }
+
+  float dTotal = 0.;
+  for( int steps = 0; steps < maxSteps; steps++ ) {
+    vec3 p = ro + dTotal * rd;
+    float dStep = opUnion( deCached( p ), deTerrain( p ) );
+    if( dStep < epsilon ) {
+      hitTree = false;
+      return dTotal;
+    }
+    dTotal += dStep;
+    if( dTotal > limit ) {
+      if( hitTree ) return limit;
+      statMisses++;
+      return maxDistance;
+    }
+  }
+  hitTree = false;
+  statStepLimitHits++;
+  return maxDistance;
+}
+
 vec3 colorSample( vec3 ro, vec3 rd ) {
-  // loop to max bounces
+  // loop to max bounces - each traced bounce adds to statBounceRays
   return vec3( 0. );
 }
 
 
-void storeNormalAndDepth( vec3 normal, float depth ) {
+void storeNormalAndDepth( ivec2 location, vec3 normal, float depth ) {
   // blend with history and imageStore
+  vec4 prevResult = imageLoad( normalDepth, location );
+  imageStore( normalDepth, location, mix( prevResult, vec4( normal, depth ), 1. / sampleCount ) );
+}
+
+void storeMoments( ivec2 location, vec3 color ) {
+  // running mean of luminance and luminance squared, the denoiser derives variance from these
+  float luma = dot( color, vec3( 0.2126, 0.7152, 0.0722 ) );
+  vec2 prevResult = imageLoad( moments, location ).xy;
+  imageStore( moments, location, vec4( mix( prevResult, vec2( luma, luma * luma ), 1. / sampleCount ), 0., 0. ) );
 }
 
 vec3 pathtraceSample( ivec2 location ) {
   vec3  cResult = vec3( 0. );
   vec3  nResult = vec3( 0. );
   float dResult = 0.;
+  int   hits = 0;
 
   for( int x = 0; x < AA; x++ ) {
     for( int y = 0; y < AA; y++ ) {
-      // pixel offset + mapped position
-      vec2 offset = vec2( x + randomFloat(), y + randomFloat() ) / float( AA ) - 0.5;
+      // each subsample is its own point in the pixel's sequence
+      uint subsampleIndex = pixelSampleIndex * uint( AA * AA ) + uint( x * AA + y );
+      samplerBegin( location, subsampleIndex );
+      vec2 jitter = vec2( sampleDimension( location, subsampleIndex, DIMENSION_PIXEL ),
+                          sampleDimension( location, subsampleIndex, DIMENSION_PIXEL + 1u ) );
+
+      // pixel offset + mapped position - Sobol's aligned blocks of AA^2 points cover the subpixel grid
+      // by themselves, the other modes get stratified onto it here
+      vec2 offset = ( samplerMode >= 2 ? jitter : ( vec2( x, y ) + jitter ) / float( AA ) ) - 0.5;
       vec2 halfScreenCoord = vec2( imageSize( accumulator ) / 2. );
       vec2 mappedPosition = ( vec2( location + offset ) - halfScreenCoord ) / halfScreenCoord;
 
@@ -179,6 +288,13 @@ vec3 pathtraceSample( ivec2 location ) {
       // thin lens DoF
 
       // get depth and normals - think about special handling for refractive hits
+      float hitDistance = raymarch( rayOrigin, rayDirection );
+      statPrimaryRays++;
+      if( hitDistance < maxDistance ) { // misses contribute a zero normal, and no depth
+        dResult += hitDistance;
+        hits++;
+        nResult += hitTree ? hitTreeNormal : norm( rayOrigin + hitDistance * rayDirection );
+      }
 
       // get the result for a ray
       // cResult += colorSample( ro, rd );
@@ -186,7 +302,8 @@ vec3 pathtraceSample( ivec2 location ) {
   }
   float normalizeTerm = float( AA * AA );
 
-  storeNormalAndDepth( nResult / normalizeTerm, dResult / normalizeTerm );
+  float nLength = length( nResult );
+  storeNormalAndDepth( location, nLength > 0. ? nResult / nLength : vec3( 0. ), hits > 0 ? dResult / float( hits ) : maxDistance );
 
   return ( cResult / normalizeTerm ) * exposure;
 }
@@ -195,9 +312,17 @@ void main() {
   ivec2 location = ivec2( gl_GlobalInvocationID.xy ) + tileOffset;
   if( !boundsCheck( location ) ) return; // abort on out of bounds
 
+  seed = renderSeed;
+  seed = ( wangHash() ^ ( uint( location.x ) * 1973u + uint( location.y ) * 9277u + frameIndex * 26699u ) ) | 1u;
+
   vec4 prevResult = imageLoad( accumulator, location );
   sampleCount = prevResult.a + 1.0;
+  pixelSampleIndex = sampleIndexBase + uint( prevResult.a );
+
+  vec3 newSample = pathtraceSample( location );
+  storeMoments( location, newSample );
 
-  vec3 blendResult = mix( prevResult.rgb, pathtraceSample( location ), 1. / sampleCount );
+  vec3 blendResult = mix( prevResult.rgb, newSample, 1. / sampleCount );
   imageStore( accumulator, location, vec4( blendResult, sampleCount ) );
+  flushStats();
 }
@@ -1,18 +1,79 @@
 #version 430 core
 layout( local_size_x = 32, local_size_y = 32, local_size_z = 1 ) in;
 
-layout( binding = 0, rgba8ui ) uniform uimage2D display;
+layout( binding = 0, rgba8 )   uniform image2D display;
 layout( binding = 1, rgba32f ) uniform image2D accumulator;
+layout( binding = 6, rgba32f ) uniform image2D denoised; // final output of the denoiser passes
+
+// tiles pathtrace touched since the last postprocess, header doubles as the indirect dispatch args
+layout( binding = 1, std430 ) buffer dirtyTileList {
+  uint  dispatchGroups[ 3 ];
+  uint  tileCount;
+  ivec2 tileOffsets[];
+};
+
+uniform bool useDenoised;
+uniform bool tiled;             // one z slice of the dispatch per dirty tile
+uniform bool diffuseMode;       // error diffusion - one invocation walks each row of a 32x32 block
+
+#include "tonemap.glsl"
+
+vec3 source( ivec2 location ) {
+  vec4 color = useDenoised ? imageLoad( denoised, location ) : imageLoad( accumulator, location );
+  return linearToSRGB( tonemap( color.rgb ) );
+}
+
+void store( ivec2 location, vec3 sRGB ) {
+  imageStore( display, location, vec4( clamp( sRGB, 0., 1. ), 1. ) );
+}
+
+// error diffusion is serial along a row, so rows are cut into 32 pixel segments that run in parallel -
+// carry the full quantization error to the next pixel, alternating direction per row so the error
+// doesn't streak. Each segment starts from an ordered dither of its first pixel, so the segment ends
+// don't line up into columns
+void errorDiffuseSegment( ivec2 start ) {
+  ivec2 size = imageSize( accumulator );
+  if ( start.y >= size.y ) return;
+  int width = min( 32, size.x - start.x );
+  bool reverse = ( start.y & 1 ) == 1;
+  vec3 error = vec3( 0. );
+  for ( int i = 0; i < width; i++ ) {
+    ivec2 location = start + ivec2( reverse ? width - 1 - i : i, 0 );
+    vec3 sRGB = source( location );
+    if ( i == 0 ) {
+      vec3 quantized = ditherMode == 2 ? ditherPalette( sRGB, threshold( location ) ) : ditherChannels( sRGB, threshold( location ) );
+      error = ditherMode == 2 ? linearSRGBToOklab( sRGBToLinear( clamp( sRGB, 0., 1. ) ) ) - linearSRGBToOklab( sRGBToLinear( quantized ) ) : sRGB - quantized;
+      store( location, quantized );
+    } else if ( ditherMode == 2 ) {
+      // quantize to the closer of the two nearest palette entries, error is carried in Oklab
+      vec3 lab = linearSRGBToOklab( sRGBToLinear( sRGB ) ) + error;
+      uvec2 pair = nearestPair( linearToSRGB( max( oklabToLinearSRGB( lab ), vec3( 0. ) ) ) );
+      vec3 a = paletteOklab( pair.x ), b = paletteOklab( pair.y );
+      uint pick = distance( lab, a ) <= distance( lab, b ) ? pair.x : pair.y;
+      error = lab - paletteOklab( pick );
+      store( location, paletteSRGB( pick ) );
+    } else {
+      float steps = float( max( ditherLevels, 2 ) - 1 );
+      vec3 target = sRGB + error;
+      vec3 quantized = clamp( round( target * steps ) / steps, 0., 1. );
+      error = target - quantized;
+      store( location, quantized );
+    }
+  }
+}
 
 void main() {
   ivec2 location = ivec2( gl_GlobalInvocationID.xy );
-  vec4 toStore = imageLoad( accumulator, location );
+  if ( tiled ) location += tileOffsets[ gl_WorkGroupID.z ];
+  if ( diffuseMode ) { // the first 32 invocations take the block's rows, the rest have nothing to do
+    if ( gl_LocalInvocationID.y == 0 )
+      errorDiffuseSegment( location - ivec2( gl_LocalInvocationID.xy ) + ivec2( 0, gl_LocalInvocationID.x ) );
+    return;
+  }
+  if ( any( greaterThanEqual( location, imageSize( accumulator ) ) ) ) return;
+  vec4 color = useDenoised ? imageLoad( denoised, location ) : imageLoad( accumulator, location );
 
-  // do any postprocessing work, store back in display texture
-    // this is things like:
-    //  - depth fog
-    //  - tonemapping
-    //  - dithering
+  // depth fog goes here, when it's implemented
 
-  imageStore( display, location, uvec4( toStore.xyz * 255., 255 ) );
+  store( location, present( color.rgb, location ) );
 }
@@ -0,0 +1,155 @@
+#version 430 core
+layout( local_size_x = 32, local_size_y = 32, local_size_z = 1 ) in;
+
+// forward reprojection of the accumulator history into a new view, run when the camera moves
+//  pass 0 - clear the current buffers and the depth keys
+//  pass 1 - scatter history depths into the new view, closest surface wins via atomicMin
+//  pass 2 - history pixels at the winning depth claim the target, the first claim writes color, guide
+//           data and a clamped sample count - sources at bit identical depths would otherwise both write
+//  pass 3 - reject disocclusion leaks and surfaces that turned away from the new viewer
+// only history that saw one surface is carried - misses have no position to carry, and a pixel whose
+// samples disagree ( silhouettes, creases ) has a depth and normal that belong to neither surface. The
+// stored normal is the mean over samples of unit normals, zero for misses, so its length says how much
+// the samples agreed
+
+layout( binding = 1, rgba32f ) uniform image2D accumulator;
+layout( binding = 4, rgba32f ) uniform image2D normalDepth;
+layout( binding = 5, rg32f )   uniform image2D moments;
+
+// copies of the buffers from before the camera moved
+layout( binding = 8 )  uniform sampler2D accumulatorHistory;
+layout( binding = 9 )  uniform sampler2D normalDepthHistory;
+layout( binding = 10 ) uniform sampler2D momentsHistory;
+
+// per pixel depth of the closest reprojected surface, as float bits - positive floats sort as uints,
+// then per pixel the source that claimed it
+layout( binding = 0, std430 ) buffer depthKeys { uint depthKey[]; };
+
+uniform int   reprojectPass;
+uniform int   maxHistory;       // cap on carried over sample count, so new samples weigh in quickly
+uniform float depthRejection;   // relative depth difference considered a disocclusion
+uniform float maxDistance;      // miss depth
+uniform float FoV;
+uniform float previousFoV;
+uniform vec3  viewerPosition;
+uniform vec3  basisX;
+uniform vec3  basisY;
+uniform vec3  basisZ;
+uniform vec3  previousViewerPosition;
+uniform vec3  previousBasisX;
+uniform vec3  previousBasisY;
+uniform vec3  previousBasisZ;
+
+const uint emptyKey = 0xFFFFFFFFu;
+const float coherence = 0.95;   // history normal length below this is more than one surface
+
+ivec2 bounds;
+float aspectRatio;
+
+int keyIndex( ivec2 location ) {
+  return location.y * bounds.x + location.x;
+}
+
+int claimIndex( ivec2 location ) {
+  return bounds.x * bounds.y + keyIndex( location );
+}
+
+// same camera model as the pathtrace shader, without the subpixel jitter
+vec3 previousRayDirection( ivec2 location ) {
+  vec2 halfScreenCoord = vec2( bounds / 2. );
+  vec2 mappedPosition = ( vec2( location ) - halfScreenCoord ) / halfScreenCoord;
+  return normalize( aspectRatio * mappedPosition.x * previousBasisX + mappedPosition.y * previousBasisY + ( 1. / previousFoV ) * previousBasisZ );
+}
+
+// project a world space point into the new view - returns false if it's behind the viewer or off screen
+bool project( vec3 worldPosition, out ivec2 location, out float depth ) {
+  vec3 d = worldPosition - viewerPosition;
+  float s = dot( d, basisZ ) * FoV;
+  depth = length( d );
+  if ( s <= 0. ) return false;
+  vec2 mappedPosition = vec2( dot( d, basisX ) / ( aspectRatio * s ), dot( d, basisY ) / s );
+  vec2 halfScreenCoord = vec2( bounds / 2. );
+  location = ivec2( round( mappedPosition * halfScreenCoord + halfScreenCoord ) );
+  return all( greaterThanEqual( location, ivec2( 0 ) ) ) && all( lessThan( location, bounds ) );
+}
+
+// where a history pixel lands in the new view
+bool reprojectHistory( ivec2 source, out ivec2 location, out float depth ) {
+  vec4 historyND = texelFetch( normalDepthHistory, source, 0 );
+  if ( texelFetch( accumulatorHistory, source, 0 ).a < 1. ) return false; // nothing to carry over
+  if ( historyND.a >= maxDistance || length( historyND.rgb ) < coherence ) return false;
+  vec3 worldPosition = previousViewerPosition + historyND.a * previousRayDirection( source );
+  return project( worldPosition, location, depth );
+}
+
+void main() {
+  ivec2 location = ivec2( gl_GlobalInvocationID.xy );
+  bounds = imageSize( accumulator );
+  aspectRatio = float( bounds.x ) / float( bounds.y );
+  if ( location.x >= bounds.x || location.y >= bounds.y ) return;
+
+  ivec2 target;
+  float depth;
+
+  switch ( reprojectPass ) {
+    case 0:
+      depthKey[ keyIndex( location ) ] = emptyKey;
+      depthKey[ claimIndex( location ) ] = emptyKey;
+      imageStore( accumulator, location, vec4( 0. ) );
+      imageStore( normalDepth, location, vec4( 0. ) );
+      imageStore( moments, location, vec4( 0. ) );
+      break;
+
+    case 1:
+      if ( reprojectHistory( location, target, depth ) )
+        atomicMin( depthKey[ keyIndex( target ) ], floatBitsToUint( depth ) );
+      break;
+
+    case 2:
+      if ( reprojectHistory( location, target, depth ) && depthKey[ keyIndex( target ) ] == floatBitsToUint( depth ) &&
+           atomicCompSwap( depthKey[ claimIndex( target ) ], emptyKey, uint( keyIndex( location ) ) ) == emptyKey ) {
+        vec4 history = texelFetch( accumulatorHistory, location, 0 );
+        imageStore( accumulator, target, vec4( history.rgb, min( history.a, float( maxHistory ) ) ) );
+        imageStore( normalDepth, target, vec4( texelFetch( normalDepthHistory, location, 0 ).rgb, depth ) );
+        imageStore( moments, target, texelFetch( momentsHistory, location, 0 ) );
+      }
+      break;
+
+    case 3: {
+      uint key = depthKey[ keyIndex( location ) ];
+      if ( key == emptyKey ) break; // hole, already cleared
+
+      // depth - magnification leaves holes in near surfaces, which far surfaces leak through
+      float center = uintBitsToFloat( key );
+      float nearest = center;
+      for ( int y = -1; y <= 1; y++ ) {
+        for ( int x = -1; x <= 1; x++ ) {
+          ivec2 neighbor = clamp( location + ivec2( x, y ), ivec2( 0 ), bounds - ivec2( 1 ) );
+          uint neighborKey = depthKey[ keyIndex( neighbor ) ];
+          if ( neighborKey != emptyKey )
+            nearest = min( nearest, uintBitsToFloat( neighborKey ) );
+        }
+      }
+      bool reject = ( center - nearest ) > depthRejection * nearest;
+
+      // normal - a surface facing away from the new viewer can't have valid history
+      vec3 normal = imageLoad( normalDepth, location ).rgb;
+      if ( dot( normal, normal ) > 0.5 ) { // misses store a zero normal
+        vec2 halfScreenCoord = vec2( bounds / 2. );
+        vec2 mappedPosition = ( vec2( location ) - halfScreenCoord ) / halfScreenCoord;
+        vec3 rayDirection = normalize( aspectRatio * mappedPosition.x * basisX + mappedPosition.y * basisY + ( 1. / FoV ) * basisZ );
+        reject = reject || dot( normal, rayDirection ) > 0.;
+      }
+
+      if ( reject ) {
+        imageStore( accumulator, location, vec4( 0. ) );
+        imageStore( normalDepth, location, vec4( 0. ) );
+        imageStore( moments, location, vec4( 0. ) );
+      }
+      break;
+    }
+
+    default:
+      break;
+  }
+}
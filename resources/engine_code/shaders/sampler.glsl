@@ -0,0 +1,104 @@
+// sample generation for the path tracer - ( pixel, sample index, dimension ) -> [0,1)
+//  mirrored on the CPU by sampler.h, keep the two in sync - the notes on the method are there
+//  included by pathtrace.cs.glsl, after the blueNoise declaration
+
+uniform int  samplerMode;       // 0 random, 1 blue noise, 2 Owen scrambled Sobol, 3 Sobol with blue noise ranking
+uniform uint sampleIndexBase;   // added to each pixel's own count, distributed units start at their first sample
+
+// dimension layout, per camera subsample
+#define DIMENSION_PIXEL  0u     // 2D, subpixel position
+#define DIMENSION_LENS   2u     // 2D, thin lens aperture
+#define DIMENSION_BOUNCE 4u     // and up, handed out in order by nextSample()
+
+const uint sobolDirections[ 128 ] = uint[](
+  0x80000000u, 0x40000000u, 0x20000000u, 0x10000000u, 0x08000000u, 0x04000000u, 0x02000000u, 0x01000000u,
+  0x00800000u, 0x00400000u, 0x00200000u, 0x00100000u, 0x00080000u, 0x00040000u, 0x00020000u, 0x00010000u,
+  0x00008000u, 0x00004000u, 0x00002000u, 0x00001000u, 0x00000800u, 0x00000400u, 0x00000200u, 0x00000100u,
+  0x00000080u, 0x00000040u, 0x00000020u, 0x00000010u, 0x00000008u, 0x00000004u, 0x00000002u, 0x00000001u,
+  0x80000000u, 0xc0000000u, 0xa0000000u, 0xf0000000u, 0x88000000u, 0xcc000000u, 0xaa000000u, 0xff000000u,
+  0x80800000u, 0xc0c00000u, 0xa0a00000u, 0xf0f00000u, 0x88880000u, 0xcccc0000u, 0xaaaa0000u, 0xffff0000u,
+  0x80008000u, 0xc000c000u, 0xa000a000u, 0xf000f000u, 0x88008800u, 0xcc00cc00u, 0xaa00aa00u, 0xff00ff00u,
+  0x80808080u, 0xc0c0c0c0u, 0xa0a0a0a0u, 0xf0f0f0f0u, 0x88888888u, 0xccccccccu, 0xaaaaaaaau, 0xffffffffu,
+  0x80000000u, 0xc0000000u, 0x60000000u, 0x90000000u, 0xe8000000u, 0x5c000000u, 0x8e000000u, 0xc5000000u,
+  0x68800000u, 0x9cc00000u, 0xee600000u, 0x55900000u, 0x80680000u, 0xc09c0000u, 0x60ee0000u, 0x90550000u,
+  0xe8808000u, 0x5cc0c000u, 0x8e606000u, 0xc5909000u, 0x6868e800u, 0x9c9c5c00u, 0xeeee8e00u, 0x5555c500u,
+  0x8000e880u, 0xc0005cc0u, 0x60008e60u, 0x9000c590u, 0xe8006868u, 0x5c009c9cu, 0x8e00eeeeu, 0xc5005555u,
+  0x80000000u, 0xc0000000u, 0x20000000u, 0x50000000u, 0xf8000000u, 0x74000000u, 0xa2000000u, 0x93000000u,
+  0xd8800000u, 0x25400000u, 0x59e00000u, 0xe6d00000u, 0x78080000u, 0xb40c0000u, 0x82020000u, 0xc3050000u,
+  0x208f8000u, 0x51474000u, 0xfbea2000u, 0x75d93000u, 0xa0858800u, 0x914e5400u, 0xdbe79e00u, 0x25db6d00u,
+  0x58800080u, 0xe54000c0u, 0x79e00020u, 0xb6d00050u, 0x800800f8u, 0xc00c0074u, 0x200200a2u, 0x50050093u
+);
+
+uint samplerHash( uint x ) { // lowbias32, Chris Wellons
+  x ^= x >> 16; x *= 0x7feb352du;
+  x ^= x >> 15; x *= 0x846ca68bu;
+  x ^= x >> 16;
+  return x;
+}
+
+uint laineKarrasPermutation( uint x, uint seed ) {
+  x += seed;
+  x ^= x * 0x6c50b47cu;
+  x ^= x * 0xb82f1e52u;
+  x ^= x * 0xc7afe638u;
+  x ^= x * 0x8d22f6e6u;
+  return x;
+}
+
+uint nestedUniformScramble( uint x, uint seed ) {
+  return bitfieldReverse( laineKarrasPermutation( bitfieldReverse( x ), seed ) );
+}
+
+uint sobol( uint index, uint dimension ) {
+  uint x = 0u;
+  for ( int bit = 0; index != 0u; bit++, index >>= 1 )
+    if ( ( index & 1u ) != 0u ) x ^= sobolDirections[ dimension * 32u + uint( bit ) ];
+  return x;
+}
+
+float samplerFloat( uint x ) {
+  return float( x >> 8 ) / 16777216.0;
+}
+
+float sobolSample( uint index, uint dimension, uint seed ) {
+  uint groupSeed = samplerHash( seed ^ samplerHash( dimension / 4u ) );
+  index = nestedUniformScramble( index, groupSeed );
+  return samplerFloat( nestedUniformScramble( sobol( index, dimension % 4u ), samplerHash( groupSeed + dimension % 4u ) ) );
+}
+
+uint pixelSeed( ivec2 pixel ) {
+  return samplerHash( uint( pixel.x ) ^ samplerHash( uint( pixel.y ) ) );
+}
+
+float sampleDimension( ivec2 pixel, uint sampleIndex, uint dimension ) {
+  if ( samplerMode == 2 )
+    return sobolSample( sampleIndex, dimension, pixelSeed( pixel ) );
+  if ( samplerMode == 3 ) { // rank from the still slice, the same one the dither uses
+    uint rank = imageLoad( blueNoise, ivec3( pixel % imageSize( blueNoise ).xy, 0 ) ).r;
+    return sobolSample( sampleIndex ^ ( rank >> 2 ), dimension, pixelSeed( pixel / 128 ) );
+  }
+  if ( samplerMode == 1 && dimension < 4u ) { // this sample's noise slice, stepped along per index
+    const vec4 steps = vec4( 0.7548776662, 0.5698402910, 0.6180339887, 0.4142135624 );
+    return fract( blueNoiseReference( pixel )[ dimension ] + float( sampleIndex ) * steps[ dimension ] );
+  }
+  return samplerFloat( samplerHash( pixelSeed( pixel ) ^ samplerHash( sampleIndex ^ samplerHash( dimension ) ) ) );
+}
+
+// running state for one camera subsample, so path code just asks for the next number
+ivec2 samplerPixel;
+uint  samplerIndex;
+uint  samplerDimension;
+
+void samplerBegin( ivec2 pixel, uint sampleIndex ) {
+  samplerPixel = pixel;
+  samplerIndex = sampleIndex;
+  samplerDimension = DIMENSION_BOUNCE;
+}
+
+float nextSample() {
+  return sampleDimension( samplerPixel, samplerIndex, samplerDimension++ );
+}
+
+vec2 nextSample2D() {
+  return vec2( nextSample(), nextSample() );
+}
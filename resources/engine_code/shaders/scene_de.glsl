@@ -0,0 +1,13 @@
+// scene distance estimate - this file is the empty scene, a loaded scene file replaces it with code
+// compiled from its node tree ( see sdf_compiler.h ), through the same include name
+//  de()         - distance, for marching
+//  deMaterial() - distance and the index of the material at the nearest surface, for shading hits
+
+float de( vec3 p ) {
+  statDECalls++;
+  return 1e10;
+}
+
+vec2 deMaterial( vec3 p ) {
+  return vec2( de( p ), 0. );
+}
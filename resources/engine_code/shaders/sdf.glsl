@@ -0,0 +1,76 @@
+// SDF primitives and operators, for compiled scene code ( see sdf_compiler.h ) - sizes are half extents,
+// operators come in a float version ( distance ) and a vec2 version ( distance, material ), where the
+// material follows whichever side decides the distance
+
+// primitives
+float sdSphere( vec3 p, float r ) {
+  return length( p ) - r;
+}
+
+float sdBox( vec3 p, vec3 b ) {
+  vec3 q = abs( p ) - b;
+  return length( max( q, 0. ) ) + min( max( q.x, max( q.y, q.z ) ), 0. );
+}
+
+float sdRoundBox( vec3 p, vec3 b, float r ) { // rounded inside the half extents
+  vec3 q = abs( p ) - b + r;
+  return length( max( q, 0. ) ) + min( max( q.x, max( q.y, q.z ) ), 0. ) - r;
+}
+
+float sdTorus( vec3 p, vec2 t ) { // in the xz plane, major radius, thickness
+  vec2 q = vec2( length( p.xz ) - t.x, p.y );
+  return length( q ) - t.y;
+}
+
+float sdCylinder( vec3 p, float r, float h ) { // along y
+  vec2 d = abs( vec2( length( p.xz ), p.y ) ) - vec2( r, h );
+  return min( max( d.x, d.y ), 0. ) + length( max( d, 0. ) );
+}
+
+float sdCapsule( vec3 p, float r, float h ) { // segment from -h to h along y
+  p.y -= clamp( p.y, -h, h );
+  return length( p ) - r;
+}
+
+float sdPlane( vec3 p ) { // y up, through the origin
+  return p.y;
+}
+
+// lower bound on the distance to anything inside an axis aligned box - for early outs
+float sdBound( vec3 p, vec3 center, vec3 halfSize ) {
+  return sdBox( p - center, halfSize );
+}
+
+// domain repetition - zero period leaves an axis alone, count > 0 limits the copies on each side
+vec3 opRepeat( vec3 p, vec3 period, float count ) {
+  vec3 safe = max( period, vec3( 1e-6 ) );
+  vec3 cell = round( p / safe );
+  if ( count > 0. ) cell = clamp( cell, -count, count );
+  return mix( p, p - safe * cell, step( 1e-6, period ) );
+}
+
+// booleans - polynomial smooth min, k is the blend radius
+float opUnion( float a, float b ) { return min( a, b ); }
+float opIntersect( float a, float b ) { return max( a, b ); }
+float opSubtract( float a, float b ) { return max( a, -b ); }
+
+float opSmoothUnion( float a, float b, float k ) {
+  float h = clamp( 0.5 + 0.5 * ( b - a ) / k, 0., 1. );
+  return mix( b, a, h ) - k * h * ( 1. - h );
+}
+
+float opSmoothIntersect( float a, float b, float k ) {
+  float h = clamp( 0.5 - 0.5 * ( b - a ) / k, 0., 1. );
+  return mix( b, a, h ) + k * h * ( 1. - h );
+}
+
+float opSmoothSubtract( float a, float b, float k ) {
+  return opSmoothIntersect( a, -b, k );
+}
+
+vec2 opUnion( vec2 a, vec2 b ) { return a.x < b.x ? a : b; }
+vec2 opIntersect( vec2 a, vec2 b ) { return a.x > b.x ? a : b; }
+vec2 opSubtract( vec2 a, vec2 b ) { return a.x > -b.x ? a : vec2( -b.x, b.y ); }
+vec2 opSmoothUnion( vec2 a, vec2 b, float k ) { return vec2( opSmoothUnion( a.x, b.x, k ), a.x < b.x ? a.y : b.y ); }
+vec2 opSmoothIntersect( vec2 a, vec2 b, float k ) { return vec2( opSmoothIntersect( a.x, b.x, k ), a.x > b.x ? a.y : b.y ); }
+vec2 opSmoothSubtract( vec2 a, vec2 b, float k ) { return vec2( opSmoothSubtract( a.x, b.x, k ), a.x > -b.x ? a.y : b.y ); }
@@ -0,0 +1,58 @@
+// BVH traversal over the scene's bounded objects, see sdf_compiler.h - included after sceneObject( id, p ),
+// the distance and material of one object, and sceneUnbounded( p ), everything without a box
+//
+// a union is the smallest of its children, so boxes further than the best distance so far are skipped,
+// and one further than the margin stands in for all of its contents with its box distance - nearer
+// children go first, to bring the best distance down early
+
+#define SDF_BVH_STACK 32 // sdfBVHStackSize
+
+struct sdfBVHNode {
+  vec3 boundsMin;
+  uint first;
+  vec3 boundsMax;
+  uint count;
+};
+
+layout( binding = 4, std430 ) readonly buffer sdfBVHBuffer {
+  sdfBVHNode sdfBVH[];
+};
+uniform float sdfBoundsMargin;
+
+float sdfBVHDistance( uint node, vec3 p ) {
+  vec3 boundsMin = sdfBVH[ node ].boundsMin, boundsMax = sdfBVH[ node ].boundsMax;
+  return sdBound( p, 0.5 * ( boundsMin + boundsMax ), 0.5 * ( boundsMax - boundsMin ) );
+}
+
+vec2 sceneTraverse( vec3 p ) {
+  vec2 best = sceneUnbounded( p );
+  uint stack[ SDF_BVH_STACK ];
+  float stackDistance[ SDF_BVH_STACK ];
+  stack[ 0 ] = 0u;
+  stackDistance[ 0 ] = sdfBVHDistance( 0u, p );
+  int top = 1;
+
+  while ( top > 0 ) {
+    top--;
+    float d = stackDistance[ top ];
+    if ( d >= best.x ) continue; // nothing in there can be closer
+    if ( d >= sdfBoundsMargin ) { // far away, the box is a safe step
+      best = vec2( d, 0. );
+      continue;
+    }
+
+    sdfBVHNode node = sdfBVH[ stack[ top ] ];
+    if ( node.count > 0u ) {
+      for ( uint i = 0u; i < node.count; i++ )
+        best = opUnion( best, sceneObject( node.first + i, p ) );
+    } else {
+      float left = sdfBVHDistance( node.first, p ), right = sdfBVHDistance( node.first + 1u, p );
+      bool leftFirst = left < right;
+      stack[ top ] = leftFirst ? node.first + 1u : node.first;
+      stackDistance[ top++ ] = leftFirst ? right : left;
+      stack[ top ] = leftFirst ? node.first : node.first + 1u;
+      stackDistance[ top++ ] = leftFirst ? left : right;
+    }
+  }
+  return best;
+}
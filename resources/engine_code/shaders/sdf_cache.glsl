@@ -0,0 +1,41 @@
+// distance cache - a sparse brick map of de() around the surface, baked by sdf_cache_bake.cs.glsl, see
+// engine_cache.cc. The region is split into bricks of 8^3 cells, each brick has an entry in cacheBricks:
+//  narrow band bricks point into the atlas, 9^3 samples on the cell corners, read with trilinear filtering
+//  bricks away from the surface only keep de() at their center - minus the distance to the center, that
+//  bounds de() anywhere in the brick
+// interpolating samples is off by at most a cell diagonal, so the cached value less the diagonal is a
+// safe step - close to a surface, and outside the region or where the bake hasn't been, it's de() itself
+
+#define CACHE_PENDING   0xFFFFFFFFu // not classified yet
+#define CACHE_ALLOCATED 0xFFFFFFFEu // has an atlas slot, not filled yet
+#define CACHE_EMPTY     0u          // away from the surface, center distance only
+                                    // anything else is the atlas slot + 1
+
+struct cacheBrick {
+  uint slot;
+  float distance; // de() at the brick center
+};
+
+layout( binding = 6, std430 ) buffer cacheBrickBuffer {
+  cacheBrick cacheBricks[];
+};
+
+uniform int cacheActive;
+uniform vec3 cacheMin;       // region corner
+uniform float cacheCell;     // cell size
+uniform ivec3 cacheBrickCount; // bricks on each axis
+uniform int cacheAtlasBricks;  // on a side of the atlas
+uniform float cacheFallback;   // analytic de() below this
+
+vec3 cacheBrickCenter( ivec3 brick ) {
+  return cacheMin + ( vec3( brick ) + 0.5 ) * 8. * cacheCell;
+}
+
+uint cacheBrickIndex( ivec3 brick ) {
+  return uint( brick.x + cacheBrickCount.x * ( brick.y + cacheBrickCount.y * brick.z ) );
+}
+
+ivec3 cacheSlotOrigin( uint slot ) { // first texel of an atlas slot
+  uint a = uint( cacheAtlasBricks );
+  return 9 * ivec3( slot % a, ( slot / a ) % a, slot / ( a * a ) );
+}
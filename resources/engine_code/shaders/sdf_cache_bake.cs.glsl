@@ -0,0 +1,65 @@
+#version 430 core
+layout( local_size_x = 9, local_size_y = 9, local_size_z = 9 ) in; // one brick's samples per group
+
+// distance cache bake, see sdf_cache.glsl and engine_cache.cc - runs a slice of one pass per frame
+//  classify - de() at brick centers, narrow band bricks get an atlas slot and go on the work list
+//  fill     - a group per work list entry, de() at the 9^3 corners of the brick's cells
+
+layout( binding = 3, r32f ) writeonly uniform image3D cacheAtlas;
+
+layout( binding = 7, std430 ) buffer cacheWorkBuffer {
+  uint cacheAllocated; // can run past the capacity, the overflow bricks stay unclassified
+  uint cachePad[ 3 ];
+  uint cacheWork[];    // brick index, per atlas slot
+};
+
+uniform int cachePass;     // 0 classify, 1 fill
+uniform uint cacheOffset;  // first brick, or work list entry, of this dispatch
+uniform uint cacheCount;   // bricks in this dispatch, classify only
+uniform uint cacheCapacity; // atlas slots
+uniform float cacheBand;   // narrow band half width, world units
+
+uint statDECalls = 0u; // de() counts calls for the path tracer's stats, unused here
+
+#include "sdf.glsl"
+#include "scene_de.glsl"
+#include "sdf_cache.glsl"
+
+ivec3 brickCoord( uint index ) {
+  uvec3 count = uvec3( cacheBrickCount );
+  return ivec3( index % count.x, ( index / count.x ) % count.y, index / ( count.x * count.y ) );
+}
+
+void main() {
+  if ( cachePass == 0 ) {
+    uint local = gl_WorkGroupID.x * 729u + gl_LocalInvocationIndex;
+    if ( local >= cacheCount ) return;
+    uint index = cacheOffset + local;
+    float d = de( cacheBrickCenter( brickCoord( index ) ) );
+    cacheBricks[ index ].distance = d;
+
+    // nothing within the band anywhere in the brick - the center distance bounds all of it
+    if ( abs( d ) >= 4. * 1.7320508 * cacheCell + cacheBand ) {
+      cacheBricks[ index ].slot = CACHE_EMPTY;
+      return;
+    }
+    uint slot = atomicAdd( cacheAllocated, 1u );
+    if ( slot < cacheCapacity ) {
+      cacheWork[ slot ] = index;
+      cacheBricks[ index ].slot = CACHE_ALLOCATED;
+    }
+
+  } else {
+    uint slot = cacheOffset + gl_WorkGroupID.x;
+    uint index = cacheWork[ slot ];
+    ivec3 corner = ivec3( gl_LocalInvocationID );
+    vec3 p = cacheMin + vec3( brickCoord( index ) * 8 + corner ) * cacheCell;
+    imageStore( cacheAtlas, cacheSlotOrigin( slot ) + corner, vec4( de( p ) ) );
+
+    // the brick goes live once all of its samples are in
+    memoryBarrierImage();
+    barrier();
+    if ( gl_LocalInvocationIndex == 0u )
+      cacheBricks[ index ].slot = slot + 1u;
+  }
+}
@@ -0,0 +1,22 @@
+// cached distance for marching, see sdf_cache.glsl - de() wherever the cache can't vouch for a step
+
+layout( binding = 18 ) uniform sampler3D cacheAtlas;
+
+float deCached( vec3 p ) {
+  if ( cacheActive == 0 ) return de( p );
+  vec3 cell = ( p - cacheMin ) / cacheCell;
+  ivec3 brick = ivec3( floor( cell / 8. ) );
+  if ( any( lessThan( brick, ivec3( 0 ) ) ) || any( greaterThanEqual( brick, cacheBrickCount ) ) ) return de( p );
+
+  cacheBrick b = cacheBricks[ cacheBrickIndex( brick ) ];
+  float bound;
+  if ( b.slot == CACHE_PENDING || b.slot == CACHE_ALLOCATED ) {
+    return de( p );
+  } else if ( b.slot == CACHE_EMPTY ) {
+    bound = b.distance - distance( p, cacheBrickCenter( brick ) );
+  } else {
+    vec3 texel = vec3( cacheSlotOrigin( b.slot - 1u ) ) + ( cell - vec3( brick * 8 ) ) + 0.5;
+    bound = texture( cacheAtlas, texel / vec3( textureSize( cacheAtlas, 0 ) ) ).r - 1.7320508 * cacheCell;
+  }
+  return bound >= cacheFallback ? bound : de( p );
+}
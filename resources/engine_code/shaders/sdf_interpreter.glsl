@@ -0,0 +1,128 @@
+// SDF bytecode interpreter - de() and deMaterial() for a scene program in a buffer, so scene edits are
+// a buffer upload instead of a shader rebuild. The program and its layout come from sdf_compiler.h,
+// the primitives and operators from sdf.glsl. With a BVH, the program starts with the objects that are
+// always evaluated, and each BVH object is a range of it after that
+
+#define SDF_STACK          16 // sdfStackSize
+#define SDF_DOMAINS         8 // sdfDomainStackSize
+
+// opcodes - node types first, then the two the interpreter adds
+#define OP_SPHERE           0u
+#define OP_BOX              1u
+#define OP_ROUND_BOX        2u
+#define OP_TORUS            3u
+#define OP_CYLINDER         4u
+#define OP_CAPSULE          5u
+#define OP_PLANE            6u
+#define OP_UNION            7u
+#define OP_INTERSECT        8u
+#define OP_SUBTRACT         9u
+#define OP_SMOOTH_UNION    10u
+#define OP_SMOOTH_INTERSECT 11u
+#define OP_SMOOTH_SUBTRACT 12u
+#define OP_REPEAT          13u
+#define OP_POP_DOMAIN      14u
+#define OP_BOUND           15u
+
+struct sdfInstruction {
+  uint op;
+  int material;
+  uint skip;
+  float scale;
+  vec4 params;
+  vec4 transform[ 3 ];
+};
+
+layout( binding = 3, std430 ) readonly buffer sdfProgramBuffer {
+  sdfInstruction sdfProgram[];
+};
+layout( binding = 5, std430 ) readonly buffer sdfObjectBuffer {
+  uvec2 sdfObjects[]; // first instruction, count - per BVH object
+};
+uniform int sdfProgramLength; // instructions run for every point, zero is the empty scene
+uniform int sdfBVHNodeCount;  // zero without a BVH
+
+vec3 sdfAffine( sdfInstruction i, vec3 p ) {
+  return vec3( dot( i.transform[ 0 ].xyz, p ) + i.transform[ 0 ].w,
+               dot( i.transform[ 1 ].xyz, p ) + i.transform[ 1 ].w,
+               dot( i.transform[ 2 ].xyz, p ) + i.transform[ 2 ].w );
+}
+
+// runs count instructions from first, which leave one value on the stack
+vec2 sdfRun( int first, int count, vec3 p0 ) {
+  if ( count == 0 ) return vec2( 1e10, 0. );
+
+  vec2 stack[ SDF_STACK ];
+  vec3 domain[ SDF_DOMAINS ];
+  int top = 0, depth = 0;
+  domain[ 0 ] = p0;
+
+  for ( int pc = first; pc < first + count; pc++ ) {
+    sdfInstruction i = sdfProgram[ pc ];
+    vec3 p = domain[ depth ];
+
+    if ( i.op <= OP_PLANE ) {
+      vec3 q = sdfAffine( i, p );
+      float d;
+      switch ( i.op ) {
+        case OP_SPHERE:    d = sdSphere( q, i.params.x ); break;
+        case OP_BOX:       d = sdBox( q, i.params.xyz ); break;
+        case OP_ROUND_BOX: d = sdRoundBox( q, i.params.xyz, i.params.w ); break;
+        case OP_TORUS:     d = sdTorus( q, i.params.xy ); break;
+        case OP_CYLINDER:  d = sdCylinder( q, i.params.x, i.params.y ); break;
+        case OP_CAPSULE:   d = sdCapsule( q, i.params.x, i.params.y ); break;
+        default:           d = sdPlane( q ); break;
+      }
+      stack[ top++ ] = vec2( d * i.scale, float( i.material ) );
+
+    } else if ( i.op <= OP_SMOOTH_SUBTRACT ) {
+      vec2 b = stack[ --top ], a = stack[ top - 1 ];
+      switch ( i.op ) {
+        case OP_UNION:            a = opUnion( a, b ); break;
+        case OP_INTERSECT:        a = opIntersect( a, b ); break;
+        case OP_SUBTRACT:         a = opSubtract( a, b ); break;
+        case OP_SMOOTH_UNION:     a = opSmoothUnion( a, b, i.params.x ); break;
+        case OP_SMOOTH_INTERSECT: a = opSmoothIntersect( a, b, i.params.x ); break;
+        default:                  a = opSmoothSubtract( a, b, i.params.x ); break;
+      }
+      stack[ top - 1 ] = a;
+
+    } else if ( i.op == OP_REPEAT ) {
+      domain[ ++depth ] = opRepeat( sdfAffine( i, p ) / i.scale, i.params.xyz, i.params.w );
+
+    } else if ( i.op == OP_POP_DOMAIN ) {
+      depth--;
+
+    } else { // OP_BOUND - far from the box, its distance stands in for the subtree
+      float d = sdBound( p, i.params.xyz, i.transform[ 0 ].xyz ) * i.scale;
+      if ( d >= i.params.w ) {
+        stack[ top++ ] = vec2( d, 0. );
+        pc += int( i.skip );
+      }
+    }
+  }
+  return stack[ 0 ];
+}
+
+vec2 sceneObject( uint id, vec3 p ) {
+  return sdfRun( int( sdfObjects[ id ].x ), int( sdfObjects[ id ].y ), p );
+}
+
+vec2 sceneUnbounded( vec3 p ) {
+  return sdfRun( 0, sdfProgramLength, p );
+}
+
+#include "sdf_bvh.glsl"
+
+vec2 deInterpreted( vec3 p ) {
+  return sdfBVHNodeCount > 0 ? sceneTraverse( p ) : sceneUnbounded( p );
+}
+
+float de( vec3 p ) {
+  statDECalls++;
+  return deInterpreted( p ).x;
+}
+
+vec2 deMaterial( vec3 p ) {
+  return deInterpreted( p );
+}
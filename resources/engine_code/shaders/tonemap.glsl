@@ -0,0 +1,124 @@
+// tonemapping + dithering shared by postprocess.cs.glsl and the fused present path in blit.fs.glsl
+//  included by the shader loader, see preprocessIncludes() in shader.h
+
+layout( binding = 2, rgba8ui ) readonly uniform uimage2DArray blueNoise; // dither reads slice 0 only, so it holds still
+
+// baked lookup tables, see tonemap.h
+layout( binding = 11 ) uniform sampler2D tonemapLUT;  // per channel curves, one row per operator
+layout( binding = 12 ) uniform usampler3D paletteLUT; // two nearest palette indices for an sRGB cell
+layout( binding = 13 ) uniform sampler2D palette;     // Oklab in row 0, sRGB in row 1
+
+uniform int  tonemapMode;       // 0 none, 1 ACES, 2 AgX, 3 Reinhard
+uniform vec2 tonemapDomain;     // log2 input range covered by the LUT row
+uniform int  ditherMode;        // 0 none, 1 per channel quantize, 2 Oklab palette
+uniform int  ditherMethod;      // 0 ordered, 1 blue noise, 2 error diffusion
+uniform int  ditherPattern;     // Bayer matrix is 2^( pattern + 1 ) on a side
+uniform int  ditherLevels;      // levels per channel, for per channel quantize
+uniform int  paletteSize;
+
+// tonemapping
+float curve( float v ) {
+  float u = clamp( ( log2( max( v, 1e-10 ) ) - tonemapDomain.x ) / ( tonemapDomain.y - tonemapDomain.x ), 0., 1. );
+  float lutSize = float( textureSize( tonemapLUT, 0 ).x );
+  float row = ( float( tonemapMode - 1 ) + 0.5 ) / float( textureSize( tonemapLUT, 0 ).y );
+  return texture( tonemapLUT, vec2( ( u * ( lutSize - 1. ) + 0.5 ) / lutSize, row ) ).r;
+}
+
+vec3 curve( vec3 v ) {
+  return vec3( curve( v.r ), curve( v.g ), curve( v.b ) );
+}
+
+vec3 tonemap( vec3 c ) {
+  c = max( c, vec3( 0. ) );
+  switch ( tonemapMode ) {
+    case 1: { // ACES, Stephen Hill's fit
+      const mat3 inputMat  = mat3( 0.59719, 0.07600, 0.02840, 0.35458, 0.90834, 0.13383, 0.04823, 0.01566, 0.83777 );
+      const mat3 outputMat = mat3( 1.60475, -0.10208, -0.00327, -0.53108, 1.10813, -0.07276, -0.07367, -0.00605, 1.07602 );
+      return clamp( outputMat * curve( inputMat * c ), 0., 1. );
+    }
+    case 2: { // AgX, default contrast
+      const mat3 agxMat = mat3( 0.842479062253094, 0.0423282422610123, 0.0423756549057051, 0.0784335999999992, 0.878468636469772, 0.0784336, 0.0792237451477643, 0.0791661274605434, 0.879142973793104 );
+      const mat3 agxMatInv = mat3( 1.19687900512017, -0.0528968517574562, -0.0529716355144438, -0.0980208811401368, 1.15190312990417, -0.0980434501171241, -0.0990297440797205, -0.0989611768448433, 1.15107367264116 );
+      return clamp( pow( max( agxMatInv * curve( agxMat * c ), vec3( 0. ) ), vec3( 2.2 ) ), 0., 1. );
+    }
+    case 3: // Reinhard
+      return curve( c );
+    default:
+      return clamp( c, 0., 1. );
+  }
+}
+
+// color spaces
+vec3 linearToSRGB( vec3 c ) {
+  return mix( 12.92 * c, 1.055 * pow( c, vec3( 1. / 2.4 ) ) - 0.055, greaterThan( c, vec3( 0.0031308 ) ) );
+}
+
+vec3 sRGBToLinear( vec3 c ) {
+  return mix( c / 12.92, pow( ( c + 0.055 ) / 1.055, vec3( 2.4 ) ), greaterThan( c, vec3( 0.04045 ) ) );
+}
+
+vec3 linearSRGBToOklab( vec3 c ) {
+  vec3 lms = mat3( 0.4122214708, 0.2119034982, 0.0883024619, 0.5363325363, 0.6806995451, 0.2817188376, 0.0514459929, 0.1073969566, 0.6299787005 ) * c;
+  lms = sign( lms ) * pow( abs( lms ), vec3( 1. / 3. ) );
+  return mat3( 0.2104542553, 1.9779984951, 0.0259040371, 0.7936177850, -2.4285922050, 0.7827717662, -0.0040720468, 0.4505937099, -0.8086757660 ) * lms;
+}
+
+vec3 oklabToLinearSRGB( vec3 c ) {
+  vec3 lms = mat3( 1., 1., 1., 0.3963377774, -0.1055613458, -0.0894841775, 0.2158037573, -0.0638541728, -1.2914855480 ) * c;
+  lms = lms * lms * lms;
+  return mat3( 4.0767416621, -1.2684380046, -0.0041960863, -3.3077115913, 2.6097574011, -0.7034186147, 0.2309699292, -0.3413193965, 1.7076147010 ) * lms;
+}
+
+// dither thresholds
+float bayer( ivec2 p ) {
+  int levels = clamp( ditherPattern + 1, 1, 4 );
+  int value = 0;
+  for ( int i = 0; i < levels; i++ ) { // low bits of the position are high bits of the threshold
+    int bx = ( p.x >> i ) & 1;
+    int by = ( p.y >> i ) & 1;
+    value |= ( ( ( bx ^ by ) << 1 ) | by ) << ( 2 * ( levels - 1 - i ) );
+  }
+  return ( float( value ) + 0.5 ) / float( 1 << ( 2 * levels ) );
+}
+
+float threshold( ivec2 location ) {
+  if ( ditherMethod == 1 ) {
+    ivec2 noiseSize = imageSize( blueNoise ).xy;
+    return ( float( imageLoad( blueNoise, ivec3( location % noiseSize, 0 ) ).r ) + 0.5 ) / 256.;
+  }
+  return bayer( location );
+}
+
+// palette helpers
+uvec2 nearestPair( vec3 sRGB ) {
+  ivec3 cell = ivec3( clamp( sRGB, 0., 1. ) * float( textureSize( paletteLUT, 0 ).x - 1 ) + 0.5 );
+  return texelFetch( paletteLUT, cell, 0 ).xy;
+}
+
+vec3 paletteOklab( uint index ) { return texelFetch( palette, ivec2( index, 0 ), 0 ).rgb; }
+vec3 paletteSRGB( uint index )  { return texelFetch( palette, ivec2( index, 1 ), 0 ).rgb; }
+
+// ordered / blue noise - pick between the two nearest entries, weighted by position along the segment
+vec3 ditherPalette( vec3 sRGB, float t ) {
+  uvec2 pair = nearestPair( sRGB );
+  vec3 lab = linearSRGBToOklab( sRGBToLinear( clamp( sRGB, 0., 1. ) ) );
+  vec3 a = paletteOklab( pair.x );
+  vec3 segment = paletteOklab( pair.y ) - a;
+  float blend = dot( segment, segment ) > 0. ? clamp( dot( lab - a, segment ) / dot( segment, segment ), 0., 1. ) : 0.;
+  return paletteSRGB( t < blend ? pair.y : pair.x );
+}
+
+vec3 ditherChannels( vec3 sRGB, float t ) {
+  float steps = float( max( ditherLevels, 2 ) - 1 );
+  return floor( clamp( sRGB, 0., 1. ) * steps + t ) / steps;
+}
+
+// tonemap, encode to sRGB, then dither with a per pixel threshold - error diffusion is handled separately
+vec3 present( vec3 color, ivec2 pixel ) {
+  vec3 sRGB = linearToSRGB( tonemap( color ) );
+  switch ( ditherMode ) {
+    case 1: return ditherChannels( sRGB, threshold( pixel ) );
+    case 2: return ditherPalette( sRGB, threshold( pixel ) );
+    default: return sRGB;
+  }
+}
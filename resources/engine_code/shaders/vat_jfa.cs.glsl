@@ -0,0 +1,77 @@
+#version 430 core
+layout( local_size_x = 8, local_size_y = 8, local_size_z = 8 ) in;
+
+// VAT distance field by jump flooding - the field is described in vat_field.h, which has the exact CPU
+// version. Seeds are surface cells, packed 10 bits per axis, and the passes are
+//  0 seed    - surface cells are their own seed, everything else has none
+//  1 flood   - each cell keeps the nearest of the seeds held jfaStep cells away on each axis, the host
+//              halves the step every pass and finishes with an extra pass at step 1 ( 1+JFA )
+//  2 resolve - seed distance to the signed field, in cells
+
+layout( binding = 19 ) uniform usampler3D vatCells;
+layout( binding = 20 ) uniform usampler3D seedsIn;
+layout( binding = 6, r32ui ) writeonly uniform uimage3D seedsOut;
+layout( binding = 7, r32f ) writeonly uniform image3D fieldOut;
+
+uniform int jfaPass;
+uniform int jfaStep;
+uniform int vatSize; // cells on a side
+
+#define NO_SEED 0xFFFFFFFFu
+
+uint packSeed( ivec3 c ) { return uint( c.x ) | ( uint( c.y ) << 10 ) | ( uint( c.z ) << 20 ); }
+ivec3 unpackSeed( uint s ) { return ivec3( s & 1023u, ( s >> 10 ) & 1023u, s >> 20 ); }
+
+bool inside( ivec3 c ) { return all( greaterThanEqual( c, ivec3( 0 ) ) ) && all( lessThan( c, ivec3( vatSize ) ) ); }
+bool solid( ivec3 c ) { return texelFetch( vatCells, c, 0 ).r != 0u; }
+
+bool surface( ivec3 c ) { // solid with an empty face neighbour inside the volume
+  if ( !solid( c ) ) return false;
+  for ( int axis = 0; axis < 3; axis++ )
+    for ( int side = -1; side <= 1; side += 2 ) {
+      ivec3 n = c;
+      n[ axis ] += side;
+      if ( inside( n ) && !solid( n ) ) return true;
+    }
+  return false;
+}
+
+float seedDistance( ivec3 c, uint s ) {
+  return s == NO_SEED ? 1e30 : distance( vec3( c ), vec3( unpackSeed( s ) ) );
+}
+
+void main() {
+  ivec3 c = ivec3( gl_GlobalInvocationID );
+  if ( !inside( c ) ) return;
+
+  if ( jfaPass == 0 ) {
+    imageStore( seedsOut, c, uvec4( surface( c ) ? packSeed( c ) : NO_SEED ) );
+
+  } else if ( jfaPass == 1 ) {
+    uint best = NO_SEED;
+    float bestDistance = 1e30;
+    for ( int z = -1; z <= 1; z++ )
+      for ( int y = -1; y <= 1; y++ )
+        for ( int x = -1; x <= 1; x++ ) {
+          ivec3 n = c + ivec3( x, y, z ) * jfaStep;
+          if ( !inside( n ) ) continue;
+          uint s = texelFetch( seedsIn, n, 0 ).r;
+          float d = seedDistance( c, s );
+          if ( d < bestDistance ) {
+            bestDistance = d;
+            best = s;
+          }
+        }
+    imageStore( seedsOut, c, uvec4( best ) );
+
+  } else {
+    uint s = texelFetch( seedsIn, c, 0 ).r;
+    bool s0 = solid( c );
+    float d = seedDistance( c, s );
+    if ( s == NO_SEED )
+      d = s0 ? -float( vatSize ) : float( vatSize );
+    else // a lower bound outside, see vat_field.h - center to corner of a cell is sqrt( 3 ) / 2
+      d = s0 ? -( d + 0.5 ) : max( d - 0.8660254, 0.5 );
+    imageStore( fieldOut, c, vec4( d ) );
+  }
+}
@@ -0,0 +1,75 @@
+// VAT terrain - the distance field from vat_jfa.cs.glsl ( or vat_field.h on the CPU ), placed in the
+// world as a box of cells. Away from the box, its distance stands in for the terrain; inside, the field
+// is read at the nearest cell center, less the way to that center, so marching takes full steps through
+// the empty space instead of stepping every cell. Within a cell of the surface it's the exact distance
+// to the boxes of the cells around
+
+layout( binding = 19 ) uniform usampler3D vatCells;
+layout( binding = 21 ) uniform sampler3D vatField;
+
+uniform int vatActive;
+uniform vec3 vatMin;         // world position of the volume's corner
+uniform float vatCellSize;   // world units
+uniform int vatSize;         // cells on a side
+uniform ivec2 vatMaterials;  // scene material for states 1 and 2
+uniform int vatTraversal;    // 0 marches the distance field, 1 casts rays against the 64-tree, vat_tree.glsl
+
+// set for a ray whose tree walk ran out of steps - it marches the field instead, see vatTreeTrace()
+bool vatFieldFallback = false;
+
+bool vatSolid( ivec3 c ) { // past the edges is empty
+  return all( greaterThanEqual( c, ivec3( 0 ) ) ) && all( lessThan( c, ivec3( vatSize ) ) ) && texelFetch( vatCells, c, 0 ).r != 0u;
+}
+
+// exact, in cells, against the 3^3 cells around the one q holds - inside a solid cell it's the distance
+// out to the empty ones, negated. Anything further off is at least a cell away, so it's capped there
+float vatLocalDistance( vec3 q ) {
+  ivec3 home = ivec3( floor( q ) );
+  bool inside = vatSolid( home );
+  float nearest = 1.;
+  for ( int z = -1; z <= 1; z++ )
+    for ( int y = -1; y <= 1; y++ )
+      for ( int x = -1; x <= 1; x++ ) {
+        ivec3 c = home + ivec3( x, y, z );
+        if ( vatSolid( c ) != inside )
+          nearest = min( nearest, length( max( abs( q - vec3( c ) - 0.5 ) - 0.5, vec3( 0. ) ) ) );
+      }
+  return inside ? -nearest : nearest;
+}
+
+float deTerrain( vec3 p ) {
+  if ( vatActive == 0 || ( vatTraversal != 0 && !vatFieldFallback ) ) return 1e10;
+  vec3 halfSize = 0.5 * vatCellSize * vec3( vatSize );
+  float box = sdBound( p, vatMin + halfSize, halfSize );
+  if ( box > vatCellSize ) return box;
+
+  // the field holds lower bounds at cell centers, and the distance can't drop faster than the way from
+  // the nearest one
+  vec3 q = ( p - vatMin ) / vatCellSize;
+  ivec3 c = clamp( ivec3( floor( q ) ), ivec3( 0 ), ivec3( vatSize - 1 ) );
+  float d = texelFetch( vatField, c, 0 ).r - distance( q, vec3( c ) + 0.5 );
+  if ( d < 1. )
+    d = vatLocalDistance( q );
+  return max( box, d * vatCellSize );
+}
+
+// material of the nearest solid cell around p
+vec2 deTerrainMaterial( vec3 p ) {
+  float d = deTerrain( p );
+  if ( d > vatCellSize ) return vec2( d, 0. );
+  vec3 cell = ( p - vatMin ) / vatCellSize - 0.5;
+  uint state = 0u;
+  float nearest = 1e30;
+  for ( int z = 0; z <= 1; z++ )
+    for ( int y = 0; y <= 1; y++ )
+      for ( int x = 0; x <= 1; x++ ) {
+        ivec3 c = clamp( ivec3( floor( cell ) ) + ivec3( x, y, z ), ivec3( 0 ), ivec3( vatSize - 1 ) );
+        uint s = texelFetch( vatCells, c, 0 ).r;
+        float dc = distance( vec3( c ), cell );
+        if ( s != 0u && dc < nearest ) {
+          nearest = dc;
+          state = s;
+        }
+      }
+  return vec2( d, float( state == 2u ? vatMaterials.y : vatMaterials.x ) );
+}
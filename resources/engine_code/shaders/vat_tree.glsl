@@ -0,0 +1,103 @@
+// VAT terrain as a 64-tree, see vat_tree.h - rays walk the tree top down, and an empty child is crossed
+// in one step at whatever level it turns up, so the cost follows the number of blocks a ray passes
+// rather than the number of cells. Included after vat_terrain.glsl, for the volume's placement
+//
+// tools/microbench.cc checks a line for line CPU copy of vatTreeTrace() against a per cell walk - keep
+// the two in step
+
+#define VAT_TREE_MAX_DEPTH 6 // vatTreeMaxDepth
+
+struct vatTreeNode {
+  uvec2 nodeMask;
+  uvec2 solidMask;
+  uvec2 twoMask;
+  uint firstChild;
+  uint pad;
+};
+
+// binding 7 is shared with the distance cache bake's work list, see vatUniforms()
+layout( binding = 7, std430 ) readonly buffer vatTreeBuffer {
+  vatTreeNode vatTreeNodes[];
+};
+uniform uint vatTreeRoot;
+uniform int vatTreeDepth;  // the tree covers 4^vatTreeDepth cells on a side
+
+bool vatTreeBit( uvec2 mask, uint i ) {
+  return ( mask[ i >> 5 ] & ( 1u << ( i & 31u ) ) ) != 0u;
+}
+
+uint vatTreeRank( uvec2 mask, uint i ) { // set bits below i
+  return uint( i < 32u ? bitCount( mask.x & ( ( 1u << i ) - 1u ) ) : bitCount( mask.x ) + bitCount( mask.y & ( ( 1u << ( i - 32u ) ) - 1u ) ) );
+}
+
+// distance to the first solid cell along the ray, or tMax - world units. normal is the face the ray came
+// through, state the cell's VAT state. A ray crosses at most 3 * 4^depth leaf blocks, each after at most
+// depth steps down, so the walk is bounded by that - if rounding still keeps it going past there, the ray
+// gives up on the tree and sets vatFieldFallback to march the distance field instead
+float vatTreeTrace( vec3 ro, vec3 rd, float tMax, out vec3 normal, out uint state ) {
+  normal = vec3( 0. );
+  state = 0u;
+  vatFieldFallback = false;
+
+  // cell units from here on, the tree's corner at the origin
+  const float nudge = 1e-3;
+  float size = float( 1 << ( 2 * vatTreeDepth ) );
+  vec3 o = ( ro - vatMin ) / vatCellSize;
+  vec3 d = rd + vec3( equal( rd, vec3( 0. ) ) ) * 1e-8;
+  vec3 invD = 1. / d;
+  vec3 tNear = min( -o * invD, ( size - o ) * invD );
+  vec3 tFar = max( -o * invD, ( size - o ) * invD );
+  float tEnter = max( max( tNear.x, tNear.y ), tNear.z );
+  float tExit = min( min( tFar.x, tFar.y ), tFar.z );
+  float t = max( tEnter, 0. );
+  if ( tExit <= t || t * vatCellSize >= tMax ) return tMax;
+  normal = tEnter > 0. ? -sign( d ) * vec3( equal( tNear, vec3( tEnter ) ) ) : -rd;
+
+  uint stack[ VAT_TREE_MAX_DEPTH ];
+  int level = vatTreeDepth - 1;
+  stack[ level ] = vatTreeRoot;
+  vec3 p = clamp( o + d * t, vec3( 0. ), vec3( size - nudge ) );
+
+  int stepLimit = ( 3 * ( 1 << ( 2 * vatTreeDepth ) ) + 1 ) * vatTreeDepth;
+  for ( int i = 0; i < stepLimit; i++ ) {
+    float childSize = float( 1 << ( 2 * level ) );
+    vec3 childMin = floor( p / childSize ) * childSize;
+    ivec3 c = ivec3( childMin / childSize ) & 3;
+    uint index = uint( c.x + 4 * c.y + 16 * c.z );
+    vatTreeNode node = vatTreeNodes[ stack[ level ] ];
+
+    if ( vatTreeBit( node.nodeMask, index ) ) { // mixed, look inside
+      stack[ level - 1 ] = node.firstChild + vatTreeRank( node.nodeMask, index );
+      level--;
+      continue;
+    }
+    if ( vatTreeBit( node.solidMask, index ) ) {
+      state = vatTreeBit( node.twoMask, index ) ? 2u : 1u;
+      return t * vatCellSize;
+    }
+
+    // empty - out through the nearest face of the child block
+    vec3 tFace = ( childMin + step( 0., d ) * childSize - o ) * invD;
+    float tNext = min( min( tFace.x, tFace.y ), tFace.z );
+    vec3 axis = vec3( equal( tFace, vec3( tNext ) ) );
+    t = max( t, tNext );
+    if ( t >= tExit || t * vatCellSize >= tMax ) return tMax;
+    normal = -sign( d ) * axis;
+
+    // just past the face on the way out, and inside the block on the other axes
+    vec3 previous = p;
+    p = clamp( o + d * t, childMin, childMin + childSize - nudge );
+    p = mix( p, mix( childMin - nudge, childMin + childSize, step( 0., d ) ), axis );
+    if ( any( lessThan( p, vec3( 0. ) ) ) || any( greaterThanEqual( p, vec3( size ) ) ) ) return tMax;
+
+    // back up to the node that holds the new position
+    float nodeSize = childSize * 4.;
+    while ( level < vatTreeDepth - 1 && any( notEqual( floor( p / nodeSize ), floor( previous / nodeSize ) ) ) ) {
+      level++;
+      nodeSize *= 4.;
+    }
+  }
+  normal = vec3( 0. );
+  vatFieldFallback = true;
+  return tMax;
+}
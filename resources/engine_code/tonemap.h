@@ -0,0 +1,167 @@
+#ifndef TONEMAP_H
+#define TONEMAP_H
+
+// CPU side color math - used to bake the postprocess LUTs, mirrors the GLSL in postprocess.cs.glsl
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "../glm/glm.hpp"
+
+// tonemap curves are baked over log2 of the input, each with its own domain
+enum tonemapOperator { TONEMAP_NONE = 0, TONEMAP_ACES = 1, TONEMAP_AGX = 2, TONEMAP_REINHARD = 3 };
+constexpr int tonemapLUTSize = 1024;
+constexpr int tonemapCurveCount = 3; // rows in the LUT, one per operator, ACES / AgX / Reinhard
+
+// log2 input range for each operator
+inline glm::vec2 tonemapDomain( int mode ) {
+  switch ( mode ) {
+    case TONEMAP_AGX: return glm::vec2( -12.47393, 4.026069 );
+    default:          return glm::vec2( -14.0, 8.0 );
+  }
+}
+
+// Stephen Hill's fit of the ACES RRT + ODT, applied per channel between the input and output matrices
+inline float acesCurve( float v ) {
+  float a = v * ( v + 0.0245786f ) - 0.000090537f;
+  float b = v * ( 0.983729f * v + 0.4329510f ) + 0.238081f;
+  return a / b;
+}
+
+// polynomial fit of the default AgX contrast curve, input is already log encoded to [0,1]
+inline float agxCurve( float x ) {
+  float x2 = x * x;
+  float x4 = x2 * x2;
+  return 15.5f * x4 * x2 - 40.14f * x4 * x + 31.96f * x4 - 6.868f * x2 * x + 0.4298f * x2 + 0.1191f * x - 0.00232f;
+}
+
+inline float reinhardCurve( float v ) {
+  return v / ( 1.0f + v );
+}
+
+// full operator, for CPU consumers that don't go through the LUT
+inline glm::vec3 tonemapColor( glm::vec3 c, int mode ) {
+  c = glm::max( c, glm::vec3( 0.0f ) );
+  switch ( mode ) {
+    case TONEMAP_ACES: {
+      const glm::mat3 inputMat  = glm::mat3( 0.59719, 0.07600, 0.02840, 0.35458, 0.90834, 0.13383, 0.04823, 0.01566, 0.83777 );
+      const glm::mat3 outputMat = glm::mat3( 1.60475, -0.10208, -0.00327, -0.53108, 1.10813, -0.07276, -0.07367, -0.00605, 1.07602 );
+      c = inputMat * c;
+      c = glm::vec3( acesCurve( c.r ), acesCurve( c.g ), acesCurve( c.b ) );
+      return glm::clamp( outputMat * c, 0.0f, 1.0f );
+    }
+    case TONEMAP_AGX: {
+      const glm::mat3 agxMat = glm::mat3( 0.842479062253094, 0.0423282422610123, 0.0423756549057051, 0.0784335999999992, 0.878468636469772, 0.0784336, 0.0792237451477643, 0.0791661274605434, 0.879142973793104 );
+      const glm::mat3 agxMatInv = glm::mat3( 1.19687900512017, -0.0528968517574562, -0.0529716355144438, -0.0980208811401368, 1.15190312990417, -0.0980434501171241, -0.0990297440797205, -0.0989611768448433, 1.15107367264116 );
+      glm::vec2 d = tonemapDomain( TONEMAP_AGX );
+      c = agxMat * c;
+      c = glm::clamp( ( glm::log2( glm::max( c, glm::vec3( 1e-10f ) ) ) - d.x ) / ( d.y - d.x ), 0.0f, 1.0f );
+      c = glm::vec3( agxCurve( c.r ), agxCurve( c.g ), agxCurve( c.b ) );
+      return glm::clamp( glm::pow( glm::max( agxMatInv * c, glm::vec3( 0.0f ) ), glm::vec3( 2.2f ) ), 0.0f, 1.0f );
+    }
+    case TONEMAP_REINHARD:
+      return glm::vec3( reinhardCurve( c.r ), reinhardCurve( c.g ), reinhardCurve( c.b ) );
+    default:
+      return glm::clamp( c, 0.0f, 1.0f );
+  }
+}
+
+// bake the per channel curves, one row per operator - the matrices stay in the shader
+inline std::vector< float > bakeTonemapLUT() {
+  std::vector< float > lut( tonemapLUTSize * tonemapCurveCount );
+  for ( int row = 0; row < tonemapCurveCount; row++ ) {
+    int mode = row + 1;
+    glm::vec2 d = tonemapDomain( mode );
+    for ( int i = 0; i < tonemapLUTSize; i++ ) {
+      float u = float( i ) / float( tonemapLUTSize - 1 );
+      float v = std::exp2( d.x + u * ( d.y - d.x ) );
+      float result = 0.0f;
+      switch ( mode ) {
+        case TONEMAP_ACES:     result = acesCurve( v ); break;
+        case TONEMAP_AGX:      result = agxCurve( u ); break;
+        case TONEMAP_REINHARD: result = reinhardCurve( v ); break;
+      }
+      lut[ row * tonemapLUTSize + i ] = result;
+    }
+  }
+  return lut;
+}
+
+// sRGB transfer functions
+inline float linearToSRGB( float c ) {
+  return c <= 0.0031308f ? 12.92f * c : 1.055f * std::pow( c, 1.0f / 2.4f ) - 0.055f;
+}
+
+inline float sRGBToLinear( float c ) {
+  return c <= 0.04045f ? c / 12.92f : std::pow( ( c + 0.055f ) / 1.055f, 2.4f );
+}
+
+inline glm::vec3 linearToSRGB( glm::vec3 c ) {
+  return glm::vec3( linearToSRGB( c.r ), linearToSRGB( c.g ), linearToSRGB( c.b ) );
+}
+
+inline glm::vec3 sRGBToLinear( glm::vec3 c ) {
+  return glm::vec3( sRGBToLinear( c.r ), sRGBToLinear( c.g ), sRGBToLinear( c.b ) );
+}
+
+// Björn Ottosson's Oklab - https://bottosson.github.io/posts/oklab/
+inline glm::vec3 linearSRGBToOklab( glm::vec3 c ) {
+  float l = std::cbrt( 0.4122214708f * c.r + 0.5363325363f * c.g + 0.0514459929f * c.b );
+  float m = std::cbrt( 0.2119034982f * c.r + 0.6806995451f * c.g + 0.1073969566f * c.b );
+  float s = std::cbrt( 0.0883024619f * c.r + 0.2817188376f * c.g + 0.6299787005f * c.b );
+  return glm::vec3(
+    0.2104542553f * l + 0.7936177850f * m - 0.0040720468f * s,
+    1.9779984951f * l - 2.4285922050f * m + 0.4505937099f * s,
+    0.0259040371f * l + 0.7827717662f * m - 0.8086757660f * s );
+}
+
+inline glm::vec3 oklabToLinearSRGB( glm::vec3 c ) {
+  float l = c.x + 0.3963377774f * c.y + 0.2158037573f * c.z;
+  float m = c.x - 0.1055613458f * c.y - 0.0638541728f * c.z;
+  float s = c.x - 0.0894841775f * c.y - 1.2914855480f * c.z;
+  l = l * l * l; m = m * m * m; s = s * s * s;
+  return glm::vec3(
+    +4.0767416621f * l - 3.3077115913f * m + 0.2309699292f * s,
+    -1.2684380046f * l + 2.6097574011f * m - 0.3413193965f * s,
+    -0.0041960863f * l - 0.7034186147f * m + 1.7076147010f * s );
+}
+
+// palette LUT - for each point of an sRGB grid, the two nearest palette entries in Oklab. Texel i is
+// the color i / ( size - 1 ), shaders/tonemap.glsl nearestPair() rounds to the nearest one
+constexpr int paletteLUTSize = 32;
+
+inline std::vector< uint8_t > bakePaletteLUT( const std::vector< glm::vec3 > &paletteSRGB ) {
+  std::vector< glm::vec3 > paletteOklab;
+  for ( auto &p : paletteSRGB )
+    paletteOklab.push_back( linearSRGBToOklab( sRGBToLinear( p ) ) );
+
+  std::vector< uint8_t > lut( paletteLUTSize * paletteLUTSize * paletteLUTSize * 4, 0 );
+  for ( int b = 0; b < paletteLUTSize; b++ )
+  for ( int g = 0; g < paletteLUTSize; g++ )
+  for ( int r = 0; r < paletteLUTSize; r++ ) {
+    glm::vec3 cell = glm::vec3( r, g, b ) / float( paletteLUTSize - 1 );
+    glm::vec3 lab = linearSRGBToOklab( sRGBToLinear( cell ) );
+
+    // two smallest distances
+    int nearest = 0, second = 0;
+    float dNearest = 1e30f, dSecond = 1e30f;
+    for ( size_t i = 0; i < paletteOklab.size(); i++ ) {
+      glm::vec3 delta = lab - paletteOklab[ i ];
+      float d = glm::dot( delta, delta );
+      if ( d < dNearest ) {
+        second = nearest; dSecond = dNearest;
+        nearest = i; dNearest = d;
+      } else if ( d < dSecond ) {
+        second = i; dSecond = d;
+      }
+    }
+    if ( paletteOklab.size() < 2 ) second = nearest;
+
+    int index = 4 * ( ( b * paletteLUTSize + g ) * paletteLUTSize + r );
+    lut[ index + 0 ] = nearest;
+    lut[ index + 1 ] = second;
+  }
+  return lut;
+}
+
+#endif
@@ -0,0 +1,164 @@
+// blueNoiseBake - bakes the blue noise bank the engine maps at startup, see blue_noise.h
+//  each channel gets a void-and-cluster rank mask ( Ulichney 1993 ), toroidal gaussian energy - slice t
+//  shows the mask offset by t times the golden ratio, so it stays blue in space, and each pixel walks a
+//  low discrepancy sequence through time
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../blue_noise.h"
+#include "../colors.h"
+#include "../arguments.h"
+
+using std::cout;
+using std::endl;
+
+// energy of every pixel from the set pixels around it, updated incrementally as pixels are set / cleared
+class energyField {
+public:
+  energyField( int size, float sigma ) : size( size ), kernel( size * size ), energy( size * size, 0.0f ) {
+    for ( int y = 0; y < size; y++ )
+      for ( int x = 0; x < size; x++ ) {
+        float dx = std::min( x, size - x ), dy = std::min( y, size - y ); // wraps around
+        kernel[ y * size + x ] = std::exp( -( dx * dx + dy * dy ) / ( 2.0f * sigma * sigma ) );
+      }
+  }
+
+  void splat( int p, float sign ) {
+    int px = p % size, py = p / size;
+    for ( int y = 0; y < size; y++ ) {
+      const float *k = &kernel[ ( ( y - py + size ) % size ) * size ];
+      float *e = &energy[ y * size ];
+      for ( int x = 0; x < size; x++ )
+        e[ x ] += sign * k[ ( x - px + size ) % size ];
+    }
+  }
+
+  // among pixels whose state matches, the highest ( tightest cluster ) or lowest ( largest void ) energy,
+  // -1 when none do
+  int extreme( const std::vector< uint8_t > &set, uint8_t state, bool highest ) const {
+    int best = -1;
+    for ( int i = 0; i < size * size; i++ ) {
+      if ( set[ i ] != state ) continue;
+      if ( best < 0 || ( highest ? energy[ i ] > energy[ best ] : energy[ i ] < energy[ best ] ) )
+        best = i;
+    }
+    return best;
+  }
+
+private:
+  int size;
+  std::vector< float > kernel;
+  std::vector< float > energy;
+};
+
+// ranks 0..size^2-1, spread so any threshold gives a blue noise point set
+static std::vector< uint32_t > voidAndCluster( int size, uint32_t seed ) {
+  const int pixels = size * size;
+  const float sigma = 1.5f;
+  std::mt19937 gen( seed );
+
+  // random initial pattern, then relax - move the tightest cluster into the largest void until stable
+  std::vector< uint8_t > pattern( pixels, 0 );
+  energyField field( size, sigma );
+  int ones = pixels / 10;
+  for ( int placed = 0; placed < ones; ) {
+    int p = std::uniform_int_distribution< int >( 0, pixels - 1 )( gen );
+    if ( pattern[ p ] ) continue;
+    pattern[ p ] = 1;
+    field.splat( p, 1.0f );
+    placed++;
+  }
+  while ( true ) {
+    int cluster = field.extreme( pattern, 1, true );
+    if ( cluster < 0 ) break;
+    pattern[ cluster ] = 0;
+    field.splat( cluster, -1.0f );
+    int largestVoid = field.extreme( pattern, 0, false );
+    if ( largestVoid < 0 ) break;
+    pattern[ largestVoid ] = 1;
+    field.splat( largestVoid, 1.0f );
+    if ( largestVoid == cluster ) break;
+  }
+
+  std::vector< uint32_t > rank( pixels );
+
+  // phase 1 - take points out of the initial pattern, tightest first, ranks counting down
+  {
+    std::vector< uint8_t > remaining = pattern;
+    energyField removal = field;
+    for ( int r = ones - 1; r >= 0; r-- ) {
+      int cluster = removal.extreme( remaining, 1, true );
+      if ( cluster < 0 ) break;
+      remaining[ cluster ] = 0;
+      removal.splat( cluster, -1.0f );
+      rank[ cluster ] = r;
+    }
+  }
+
+  // phase 2 - fill the largest void until every pixel has a rank
+  for ( int r = ones; r < pixels; r++ ) {
+    int largestVoid = field.extreme( pattern, 0, false );
+    if ( largestVoid < 0 ) break;
+    pattern[ largestVoid ] = 1;
+    field.splat( largestVoid, 1.0f );
+    rank[ largestVoid ] = r;
+  }
+  return rank;
+}
+
+static void usage() {
+  cout << "usage: blueNoiseBake [options]" << endl
+       << "  -o <path>           output bank ( default resources/blueNoise.bank )" << endl
+       << "  --size <n>          slice width and height, 8 to 1024 ( default 128 )" << endl
+       << "  --slices <n>        slices in the stack ( default 64 )" << endl
+       << "  --seed <n>          generator seed ( default 1 )" << endl;
+}
+
+int main( int argc, char *argv[] ) {
+  std::string outputName = "resources/blueNoise.bank";
+  int size = 128, slices = 64;
+  uint32_t seed = 1;
+  for ( int i = 1; i < argc; i++ ) {
+    std::string argument = argv[ i ];
+    bool hasValue = i + 1 < argc;
+    if ( argument == "-o" && hasValue ) outputName = argv[ ++i ];
+    else if ( argument == "--size" && hasValue ) size = numericArgument( argument, argv[ ++i ], 8, 1024, usage );
+    else if ( argument == "--slices" && hasValue ) slices = numericArgument( argument, argv[ ++i ], 1, 4096, usage );
+    else if ( argument == "--seed" && hasValue ) seed = numericArgument( argument, argv[ ++i ], 0u, 0xFFFFFFFFu / 4, usage ); // four channel seeds each
+    else if ( argument == "-h" || argument == "--help" ) { usage(); return 0; }
+    else { usage(); return 1; }
+  }
+
+  // the four channels are independent, bake them side by side
+  auto start = std::chrono::steady_clock::now();
+  std::vector< uint32_t > ranks[ 4 ];
+  std::vector< std::thread > workers;
+  for ( int c = 0; c < 4; c++ )
+    workers.emplace_back( [ &, c ] { ranks[ c ] = voidAndCluster( size, seed * 4 + c ); } );
+  for ( auto &w : workers ) w.join();
+
+  const int pixels = size * size;
+  const double goldenRatio = 0.61803398874989484820;
+  std::vector< uint8_t > data( size_t( pixels ) * slices * 4 );
+  for ( int t = 0; t < slices; t++ )
+    for ( int p = 0; p < pixels; p++ )
+      for ( int c = 0; c < 4; c++ ) {
+        double v = ( ranks[ c ][ p ] + 0.5 ) / pixels + t * goldenRatio;
+        data[ ( size_t( t ) * pixels + p ) * 4 + c ] = uint8_t( ( v - std::floor( v ) ) * 256.0 );
+      }
+
+  if ( !writeBlueNoiseBank( outputName, size, size, slices, data.data() ) ) {
+    cout << T_RED << "can't write " << outputName << RESET << endl;
+    return 1;
+  }
+  float seconds = std::chrono::duration< float >( std::chrono::steady_clock::now() - start ).count();
+  cout << T_GREEN << "baked " << outputName << RESET << ", " << slices << " slices of " << size << "x" << size << ", " << seconds << "s" << endl;
+  return 0;
+}
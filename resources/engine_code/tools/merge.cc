@@ -0,0 +1,191 @@
+// merge - combine accumulator dumps of the same view into one, weighted by per pixel sample count
+//  inputs are the float exports from the engine ( EXR, or PFM with its .samples.pfm companion ) -
+//  they're streamed a strip of scanlines at a time, so only one strip per input is ever in memory
+//  writes the merged accumulator as <name>.exr and a tonemapped <name>.png
+//
+// samples are a function of ( pixel, sample index, dimension ) alone, so two renders of the same view
+// are the same render unless their sample indices differ - give each one its own --seed, which starts
+// its indices seedStride further on and feeds the hash RNG for everything else. Coordinator runs hand
+// out distinct ranges already
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#if defined( __SSE2__ )
+#include <emmintrin.h>
+#endif
+
+#include "../float_image.h"
+#include "../png_parallel.h"
+#include "../tonemap.h"
+#include "../colors.h"
+#include "../arguments.h"
+
+using std::cout;
+using std::endl;
+
+// sum.rgb += input.rgb * n, sum.a += n - pixels with no samples, or garbage counts, contribute nothing
+static void accumulateWeighted( float *sum, const float *input, size_t pixels ) {
+#if defined( __SSE2__ )
+  const __m128 rgbMask = _mm_castsi128_ps( _mm_set_epi32( 0, -1, -1, -1 ) );
+  const __m128 oneInAlpha = _mm_set_ps( 1.0f, 0.0f, 0.0f, 0.0f );
+  const __m128 zero = _mm_setzero_ps();
+  for ( size_t i = 0; i < pixels; i++ ) {
+    __m128 v = _mm_loadu_ps( input + i * 4 );
+    __m128 n = _mm_shuffle_ps( v, v, _MM_SHUFFLE( 3, 3, 3, 3 ) );
+    __m128 valid = _mm_cmpgt_ps( n, zero ); // false for NaN too
+    __m128 weight = _mm_or_ps( _mm_and_ps( n, rgbMask ), oneInAlpha );
+    __m128 contribution = _mm_and_ps( _mm_mul_ps( v, weight ), valid );
+    _mm_storeu_ps( sum + i * 4, _mm_add_ps( _mm_loadu_ps( sum + i * 4 ), contribution ) );
+  }
+#else
+  for ( size_t i = 0; i < pixels; i++ ) {
+    const float *v = input + i * 4;
+    if ( !( v[ 3 ] > 0.0f ) ) continue;
+    sum[ i * 4 + 0 ] += v[ 0 ] * v[ 3 ];
+    sum[ i * 4 + 1 ] += v[ 1 ] * v[ 3 ];
+    sum[ i * 4 + 2 ] += v[ 2 ] * v[ 3 ];
+    sum[ i * 4 + 3 ] += v[ 3 ];
+  }
+#endif
+}
+
+// back from weighted sums to means, total count stays in alpha
+static void resolveWeighted( float *sum, size_t pixels ) {
+#if defined( __SSE2__ )
+  const __m128 rgbMask = _mm_castsi128_ps( _mm_set_epi32( 0, -1, -1, -1 ) );
+  const __m128 oneInAlpha = _mm_set_ps( 1.0f, 0.0f, 0.0f, 0.0f );
+  const __m128 zero = _mm_setzero_ps();
+  for ( size_t i = 0; i < pixels; i++ ) {
+    __m128 s = _mm_loadu_ps( sum + i * 4 );
+    __m128 n = _mm_shuffle_ps( s, s, _MM_SHUFFLE( 3, 3, 3, 3 ) );
+    __m128 divisor = _mm_or_ps( _mm_and_ps( n, rgbMask ), oneInAlpha );
+    __m128 mean = _mm_and_ps( _mm_div_ps( s, divisor ), _mm_cmpgt_ps( n, zero ) );
+    _mm_storeu_ps( sum + i * 4, mean );
+  }
+#else
+  for ( size_t i = 0; i < pixels; i++ ) {
+    float *s = sum + i * 4;
+    float n = s[ 3 ];
+    for ( int c = 0; c < 3; c++ )
+      s[ c ] = n > 0.0f ? s[ c ] / n : 0.0f;
+  }
+#endif
+}
+
+static void usage() {
+  cout << "usage: merge [options] <dump.exr|dump.pfm> ..." << endl
+       << "  -o <name>           output basename, writes <name>.exr and <name>.png ( default merged )" << endl
+       << "  --half              half float radiance in the merged EXR" << endl
+       << "  --no-zip            uncompressed merged EXR" << endl
+       << "  --tonemap <mode>    none, aces, agx or reinhard for the PNG ( default aces )" << endl
+       << "  --exposure <x>      scale applied before tonemapping ( default 1 )" << endl
+       << "  --strip <rows>      scanlines held per input at once ( default 64 )" << endl
+       << "inputs need distinct sample indices - render each with its own --seed, or split one render with --coordinator" << endl;
+}
+
+int main( int argc, char *argv[] ) {
+  std::string outputName = "merged";
+  bool halfFloat = false, zip = true;
+  int tonemapMode = TONEMAP_ACES;
+  float exposure = 1.0f;
+  int stripRows = 64;
+  std::vector< std::string > inputNames;
+
+  for ( int i = 1; i < argc; i++ ) {
+    std::string argument = argv[ i ];
+    bool hasValue = i + 1 < argc;
+    if ( argument == "-o" && hasValue ) outputName = argv[ ++i ];
+    else if ( argument == "--half" ) halfFloat = true;
+    else if ( argument == "--no-zip" ) zip = false;
+    else if ( argument == "--exposure" && hasValue ) exposure = numericArgument( argument, argv[ ++i ], 0.0f, 1e6f, usage );
+    else if ( argument == "--strip" && hasValue ) stripRows = numericArgument( argument, argv[ ++i ], 1, 1 << 16, usage );
+    else if ( argument == "--tonemap" && hasValue ) {
+      std::string mode = argv[ ++i ];
+      if ( mode == "none" ) tonemapMode = TONEMAP_NONE;
+      else if ( mode == "aces" ) tonemapMode = TONEMAP_ACES;
+      else if ( mode == "agx" ) tonemapMode = TONEMAP_AGX;
+      else if ( mode == "reinhard" ) tonemapMode = TONEMAP_REINHARD;
+      else { usage(); return 1; }
+    }
+    else if ( argument == "-h" || argument == "--help" ) { usage(); return 0; }
+    else if ( argument[ 0 ] == '-' ) { usage(); return 1; }
+    else inputNames.push_back( argument );
+  }
+  if ( inputNames.empty() ) { usage(); return 1; }
+
+  // open everything up front, so a bad input fails before any work is done
+  std::vector< std::unique_ptr< floatImageReader > > inputs;
+  for ( auto &name : inputNames ) {
+    std::string error;
+    auto reader = openFloatImage( name, error );
+    if ( !reader ) {
+      cout << T_RED << error << RESET << endl;
+      return 1;
+    }
+    if ( !inputs.empty() && ( reader->width != inputs[ 0 ]->width || reader->height != inputs[ 0 ]->height ) ) {
+      cout << T_RED << name << " is " << reader->width << "x" << reader->height << ", expected "
+           << inputs[ 0 ]->width << "x" << inputs[ 0 ]->height << RESET << endl;
+      return 1;
+    }
+    inputs.push_back( std::move( reader ) );
+  }
+  const int width = inputs[ 0 ]->width, height = inputs[ 0 ]->height;
+
+  exrWriter exr;
+  if ( !exr.open( outputName + ".exr", width, height, halfFloat, zip ) ) {
+    cout << T_RED << "can't write " << outputName << ".exr" << RESET << endl;
+    return 1;
+  }
+  // strips are whole EXR chunks
+  stripRows = ( ( stripRows + exr.linesPerChunk - 1 ) / exr.linesPerChunk ) * exr.linesPerChunk;
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector< float > sum( size_t( width ) * stripRows * 4 ), strip( sum.size() );
+  std::vector< uint8_t > png( size_t( width ) * height * 4 );
+  double totalSamples = 0.0;
+  for ( int y = 0; y < height; y += stripRows ) {
+    int rows = std::min( stripRows, height - y );
+    size_t pixels = size_t( width ) * rows;
+    std::fill( sum.begin(), sum.begin() + pixels * 4, 0.0f );
+    for ( size_t i = 0; i < inputs.size(); i++ ) {
+      if ( !inputs[ i ]->readLines( y, rows, strip.data() ) ) {
+        cout << T_RED << inputNames[ i ] << " - " << inputs[ i ]->error << RESET << endl;
+        return 1;
+      }
+      accumulateWeighted( sum.data(), strip.data(), pixels );
+    }
+    resolveWeighted( sum.data(), pixels );
+
+    for ( int line = 0; line < rows; line += exr.linesPerChunk )
+      exr.writeChunk( sum.data() + size_t( line ) * width * 4, ptrdiff_t( width ) * 4 );
+
+    for ( size_t i = 0; i < pixels; i++ ) {
+      const float *s = &sum[ i * 4 ];
+      totalSamples += s[ 3 ];
+      glm::vec3 c = linearToSRGB( tonemapColor( glm::vec3( s[ 0 ], s[ 1 ], s[ 2 ] ) * exposure, tonemapMode ) );
+      uint8_t *p = &png[ ( size_t( y ) * width + i ) * 4 ];
+      p[ 0 ] = uint8_t( glm::clamp( c.r, 0.0f, 1.0f ) * 255.0f + 0.5f );
+      p[ 1 ] = uint8_t( glm::clamp( c.g, 0.0f, 1.0f ) * 255.0f + 0.5f );
+      p[ 2 ] = uint8_t( glm::clamp( c.b, 0.0f, 1.0f ) * 255.0f + 0.5f );
+      p[ 3 ] = 255;
+    }
+  }
+
+  if ( !exr.close() ) {
+    cout << T_RED << "failed writing " << outputName << ".exr" << RESET << endl;
+    return 1;
+  }
+  if ( !encodePNGParallel( outputName + ".png", png.data(), width, height, PNG_FAST ) ) {
+    cout << T_RED << "failed writing " << outputName << ".png" << RESET << endl;
+    return 1;
+  }
+
+  float seconds = std::chrono::duration< float >( std::chrono::steady_clock::now() - start ).count();
+  cout << T_GREEN << "merged " << inputs.size() << " dumps" << RESET << ", " << width << "x" << height
+       << ", mean " << totalSamples / ( double( width ) * height ) << " spp, " << seconds << "s" << endl;
+  return 0;
+}
@@ -0,0 +1,504 @@
+// microbench - timing for the CPU side generators and loaders that run at startup
+//  each case runs once to warm up, then a set number of timed repetitions - reported as the median
+//  with min and relative standard deviation, and throughput at the median
+//  cases: VAT generation at several depths, diamond-square heightfields, OBJ loading of generated
+//  meshes, PNG encode / decode, the VAT short rule codec, and the CPU mirror of the path tracer's sampler
+//  round trip and stratification checks run alongside, the VAT distance field against brute force, and
+//  a CPU copy of the 64-tree traversal against a per cell walk - any of them failing makes the exit
+//  status 1
+
+#include <bitset>
+
+#include "../includes.h"
+
+using std::cout;
+using std::endl;
+
+struct benchResult {
+  std::string name;
+  std::string unit;     // what throughput is counted in
+  double perRun;        // units of work in one repetition
+  std::vector< double > seconds;
+};
+
+// runs setup outside the timing, then work - returns the per repetition times
+template < typename S, typename W >
+static std::vector< double > repeat( int repetitions, S &&setup, W &&work ) {
+  std::vector< double > seconds;
+  for ( int i = -1; i < repetitions; i++ ) { // -1 is the warmup
+    setup();
+    auto start = std::chrono::steady_clock::now();
+    work();
+    double elapsed = std::chrono::duration< double >( std::chrono::steady_clock::now() - start ).count();
+    if ( i >= 0 ) seconds.push_back( elapsed );
+  }
+  return seconds;
+}
+
+static double median( std::vector< double > v ) {
+  std::sort( v.begin(), v.end() );
+  size_t n = v.size();
+  return n % 2 ? v[ n / 2 ] : 0.5 * ( v[ n / 2 - 1 ] + v[ n / 2 ] );
+}
+
+static double mean( const std::vector< double > &v ) {
+  return std::accumulate( v.begin(), v.end(), 0.0 ) / v.size();
+}
+
+static double standardDeviation( const std::vector< double > &v ) {
+  double m = mean( v ), sum = 0.0;
+  for ( double x : v ) sum += ( x - m ) * ( x - m );
+  return v.size() > 1 ? std::sqrt( sum / ( v.size() - 1 ) ) : 0.0;
+}
+
+// 1234567 -> "1.23 M"
+static std::string siPrefixed( double value ) {
+  const char *prefixes[] = { "", "k", "M", "G", "T" };
+  int p = 0;
+  while ( value >= 1000.0 && p < 4 ) { value /= 1000.0; p++; }
+  std::stringstream s;
+  s << std::fixed << std::setprecision( 2 ) << value << " " << prefixes[ p ];
+  return s.str();
+}
+
+static void report( const benchResult &r ) {
+  double m = median( r.seconds );
+  double spread = standardDeviation( r.seconds ) / mean( r.seconds ) * 100.0;
+  cout << "  " << std::left << std::setw( 36 ) << r.name << std::right
+       << std::setw( 11 ) << std::fixed << std::setprecision( 3 ) << m * 1e3 << " ms"
+       << "  min " << std::setw( 9 ) << *std::min_element( r.seconds.begin(), r.seconds.end() ) * 1e3 << " ms"
+       << "  +/- " << std::setw( 5 ) << std::setprecision( 1 ) << spread << "%"
+       << "  " << std::setw( 12 ) << siPrefixed( r.perRun / m ) << r.unit << "/s" << std::defaultfloat << endl;
+}
+
+// suppress objLoader's summary printout while it's being timed
+struct quietCout {
+  std::stringstream sink;
+  std::streambuf *previous;
+  quietCout() : previous( cout.rdbuf( sink.rdbuf() ) ) {}
+  ~quietCout() { cout.rdbuf( previous ); }
+};
+
+// a UV sphere with position, texcoord and normal per vertex - 2 * rings * segments triangles
+static std::string generateOBJ( int rings, int segments ) {
+  std::stringstream obj;
+  obj << std::fixed << std::setprecision( 6 );
+  for ( int r = 0; r <= rings; r++ ) {
+    float theta = float( r ) / rings * glm::pi< float >();
+    for ( int s = 0; s <= segments; s++ ) {
+      float phi = float( s ) / segments * 2.0f * glm::pi< float >();
+      glm::vec3 n( std::sin( theta ) * std::cos( phi ), std::cos( theta ), std::sin( theta ) * std::sin( phi ) );
+      obj << "v " << n.x << " " << n.y << " " << n.z << "\n";
+      obj << "vt " << float( s ) / segments << " " << float( r ) / rings << "\n";
+      obj << "vn " << n.x << " " << n.y << " " << n.z << "\n";
+    }
+  }
+  auto index = [ & ]( int r, int s ) { return r * ( segments + 1 ) + s + 1; }; // OBJ indices start at 1
+  for ( int r = 0; r < rings; r++ ) {
+    for ( int s = 0; s < segments; s++ ) {
+      int a = index( r, s ), b = index( r + 1, s ), c = index( r + 1, s + 1 ), d = index( r, s + 1 );
+      obj << "f " << a << "/" << a << "/" << a << " " << b << "/" << b << "/" << b << " " << c << "/" << c << "/" << c << "\n";
+      obj << "f " << a << "/" << a << "/" << a << " " << c << "/" << c << "/" << c << " " << d << "/" << d << "/" << d << "\n";
+    }
+  }
+  return obj.str();
+}
+
+// smooth gradients plus some noise, so the encoder has something between trivial and incompressible
+static std::vector< uint8_t > generateImage( int size ) {
+  std::vector< uint8_t > image( size_t( size ) * size * 4 );
+  std::mt19937 gen( 42 );
+  std::uniform_int_distribution< int > noise( -8, 8 );
+  for ( int y = 0; y < size; y++ )
+    for ( int x = 0; x < size; x++ ) {
+      uint8_t *p = &image[ ( size_t( y ) * size + x ) * 4 ];
+      p[ 0 ] = uint8_t( glm::clamp( x * 255 / size + noise( gen ), 0, 255 ) );
+      p[ 1 ] = uint8_t( glm::clamp( y * 255 / size + noise( gen ), 0, 255 ) );
+      p[ 2 ] = uint8_t( glm::clamp( ( x ^ y ) & 255, 0, 255 ) );
+      p[ 3 ] = 255;
+    }
+  return image;
+}
+
+// overlapping spheres of states 1 and 2 - a few surfaces, concave places between them, and empty space
+static std::vector< uint8_t > generateBlobs( int size, int count, unsigned seed ) {
+  std::mt19937 gen( seed );
+  std::uniform_real_distribution< float > unit( 0.0f, 1.0f );
+  std::vector< glm::vec4 > blobs;
+  for ( int i = 0; i < count; i++ )
+    blobs.push_back( glm::vec4( unit( gen ) * size, unit( gen ) * size, unit( gen ) * size, 1.0f + unit( gen ) * size / 5.0f ) );
+  std::vector< uint8_t > cells( size_t( size ) * size * size );
+  for ( int z = 0; z < size; z++ )
+    for ( int y = 0; y < size; y++ )
+      for ( int x = 0; x < size; x++ )
+        for ( int i = 0; i < count; i++ )
+          if ( glm::distance( glm::vec3( x, y, z ), glm::vec3( blobs[ i ] ) ) < blobs[ i ].w ) {
+            cells[ x + size_t( size ) * ( y + size_t( size ) * z ) ] = uint8_t( 1 + i % 2 );
+            break;
+          }
+  return cells;
+}
+
+// exact distance field against brute force over every surface cell, and the outside values against the
+// true distance to the solid cells' boxes, which they have to stay under for sphere tracing
+static int checkDistanceField( const std::vector< uint8_t > &cells, int size ) {
+  const size_t n = size;
+  std::vector< glm::ivec3 > surface, solid;
+  for ( int z = 0; z < size; z++ )
+    for ( int y = 0; y < size; y++ )
+      for ( int x = 0; x < size; x++ ) {
+        if ( vatSurfaceCell( cells, size, x, y, z ) ) surface.push_back( glm::ivec3( x, y, z ) );
+        if ( cells[ x + n * ( y + n * z ) ] ) solid.push_back( glm::ivec3( x, y, z ) );
+      }
+  std::vector< float > field = vatDistanceField( cells, size );
+  int mismatched = 0, overestimated = 0;
+  for ( int z = 0; z < size; z++ )
+    for ( int y = 0; y < size; y++ )
+      for ( int x = 0; x < size; x++ ) {
+        const size_t i = x + n * ( y + n * z );
+        const glm::vec3 p( x, y, z );
+        float nearest = 1e30f;
+        for ( auto &s : surface )
+          nearest = std::min( nearest, glm::distance( p, glm::vec3( s ) ) );
+        float expected = cells[ i ] ? -( nearest + 0.5f ) : std::max( nearest - vatCornerDistance, 0.5f );
+        if ( surface.empty() ) expected = cells[ i ] ? -float( size ) : float( size );
+        if ( std::abs( field[ i ] - expected ) > 1e-4f * std::max( 1.0f, std::abs( expected ) ) ) mismatched++;
+        if ( !cells[ i ] && !solid.empty() ) {
+          float box = 1e30f;
+          for ( auto &s : solid )
+            box = std::min( box, glm::length( glm::max( glm::abs( p - glm::vec3( s ) ) - 0.5f, glm::vec3( 0.0f ) ) ) );
+          if ( field[ i ] > box + 1e-4f ) overestimated++;
+        }
+      }
+  int failures = 0;
+  if ( mismatched ) {
+    cout << T_RED << "  vatDistanceField " << size << "^3 differs from brute force in " << mismatched << " cells" << RESET << endl;
+    failures++;
+  }
+  if ( overestimated ) {
+    cout << T_RED << "  vatDistanceField " << size << "^3 overestimates the distance to the cells in " << overestimated << " cells" << RESET << endl;
+    failures++;
+  }
+  return failures;
+}
+
+struct vatRayHit {
+  float t;           // cells along the ray, tMax for a miss
+  glm::vec3 normal;  // face the ray came through
+  uint32_t state;
+  bool exhausted;    // the tree walk ran out of steps
+  float graze;       // the cell walk's closest call between two face crossings, in t
+};
+
+static bool vatTreeBit( const uint32_t mask[ 2 ], uint32_t i ) {
+  return ( mask[ i >> 5 ] & ( 1u << ( i & 31u ) ) ) != 0u;
+}
+
+static uint32_t vatTreeRank( const uint32_t mask[ 2 ], uint32_t i ) {
+  return i < 32u ? std::bitset< 32 >( mask[ 0 ] & ( ( 1u << i ) - 1u ) ).count()
+                 : std::bitset< 32 >( mask[ 0 ] ).count() + std::bitset< 32 >( mask[ 1 ] & ( ( 1u << ( i - 32u ) ) - 1u ) ).count();
+}
+
+// shaders/vat_tree.glsl vatTreeTrace(), line for line, in cell units with the volume at the origin
+static vatRayHit vatTreeTraceCPU( const vatTree &tree, glm::vec3 o, glm::vec3 rd, float tMax ) {
+  vatRayHit hit = { tMax, glm::vec3( 0.0f ), 0u, false, 1e30f };
+  const float nudge = 1e-3f;
+  const float size = float( tree.cells );
+  const glm::vec3 d = rd + glm::vec3( glm::equal( rd, glm::vec3( 0.0f ) ) ) * 1e-8f;
+  const glm::vec3 invD = 1.0f / d;
+  const glm::vec3 tNear = glm::min( -o * invD, ( size - o ) * invD );
+  const glm::vec3 tFar = glm::max( -o * invD, ( size - o ) * invD );
+  const float tEnter = std::max( std::max( tNear.x, tNear.y ), tNear.z );
+  const float tExit = std::min( std::min( tFar.x, tFar.y ), tFar.z );
+  float t = std::max( tEnter, 0.0f );
+  if ( tExit <= t || t >= tMax ) return hit;
+  glm::vec3 normal = tEnter > 0.0f ? -glm::sign( d ) * glm::vec3( glm::equal( tNear, glm::vec3( tEnter ) ) ) : -rd;
+
+  uint32_t stack[ vatTreeMaxDepth ];
+  int level = tree.depth - 1;
+  stack[ level ] = tree.root;
+  glm::vec3 p = glm::clamp( o + d * t, glm::vec3( 0.0f ), glm::vec3( size - nudge ) );
+
+  const int stepLimit = ( 3 * tree.cells + 1 ) * tree.depth;
+  for ( int i = 0; i < stepLimit; i++ ) {
+    const float childSize = float( 1 << ( 2 * level ) );
+    const glm::vec3 childMin = glm::floor( p / childSize ) * childSize;
+    const glm::ivec3 c = glm::ivec3( childMin / childSize ) & 3;
+    const uint32_t index = uint32_t( c.x + 4 * c.y + 16 * c.z );
+    const vatTreeNode &node = tree.nodes[ stack[ level ] ];
+
+    if ( vatTreeBit( node.nodeMask, index ) ) {
+      stack[ level - 1 ] = node.firstChild + vatTreeRank( node.nodeMask, index );
+      level--;
+      continue;
+    }
+    if ( vatTreeBit( node.solidMask, index ) ) {
+      hit.t = t;
+      hit.normal = normal;
+      hit.state = vatTreeBit( node.twoMask, index ) ? 2u : 1u;
+      return hit;
+    }
+
+    const glm::vec3 tFace = ( childMin + glm::step( glm::vec3( 0.0f ), d ) * childSize - o ) * invD;
+    const float tNext = std::min( std::min( tFace.x, tFace.y ), tFace.z );
+    const glm::vec3 axis = glm::vec3( glm::equal( tFace, glm::vec3( tNext ) ) );
+    t = std::max( t, tNext );
+    if ( t >= tExit || t >= tMax ) return hit;
+    normal = -glm::sign( d ) * axis;
+
+    const glm::vec3 previous = p;
+    p = glm::clamp( o + d * t, childMin, childMin + childSize - nudge );
+    p = glm::mix( p, glm::mix( childMin - nudge, childMin + childSize, glm::step( glm::vec3( 0.0f ), d ) ), axis );
+    if ( glm::any( glm::lessThan( p, glm::vec3( 0.0f ) ) ) || glm::any( glm::greaterThanEqual( p, glm::vec3( size ) ) ) ) return hit;
+
+    float nodeSize = childSize * 4.0f;
+    while ( level < tree.depth - 1 && glm::any( glm::notEqual( glm::floor( p / nodeSize ), glm::floor( previous / nodeSize ) ) ) ) {
+      level++;
+      nodeSize *= 4.0f;
+    }
+  }
+  hit.exhausted = true;
+  return hit;
+}
+
+// reference - one cell at a time ( Amanatides and Woo ), same conventions
+static vatRayHit vatCellTrace( const std::vector< uint8_t > &cells, int size, glm::vec3 o, glm::vec3 rd, float tMax ) {
+  vatRayHit hit = { tMax, glm::vec3( 0.0f ), 0u, false, 1e30f };
+  const glm::vec3 d = rd + glm::vec3( glm::equal( rd, glm::vec3( 0.0f ) ) ) * 1e-8f;
+  const glm::vec3 invD = 1.0f / d;
+  const glm::vec3 tNear = glm::min( -o * invD, ( float( size ) - o ) * invD );
+  const glm::vec3 tFar = glm::max( -o * invD, ( float( size ) - o ) * invD );
+  const float tEnter = std::max( std::max( tNear.x, tNear.y ), tNear.z );
+  const float tExit = std::min( std::min( tFar.x, tFar.y ), tFar.z );
+  float t = std::max( tEnter, 0.0f );
+  if ( tExit <= t || t >= tMax ) return hit;
+  glm::vec3 normal = tEnter > 0.0f ? -glm::sign( d ) * glm::vec3( glm::equal( tNear, glm::vec3( tEnter ) ) ) : -rd;
+
+  const glm::ivec3 step = glm::ivec3( glm::sign( d ) );
+  glm::ivec3 c = glm::clamp( glm::ivec3( glm::floor( o + d * t ) ), glm::ivec3( 0 ), glm::ivec3( size - 1 ) );
+  glm::vec3 tNext = ( glm::vec3( c ) + glm::step( glm::vec3( 0.0f ), d ) - o ) * invD;
+  const glm::vec3 tDelta = glm::abs( invD );
+  while ( true ) {
+    const uint8_t state = cells[ c.x + size_t( size ) * ( c.y + size_t( size ) * c.z ) ];
+    if ( state ) {
+      hit.t = t;
+      hit.normal = normal;
+      hit.state = state;
+      return hit;
+    }
+    const int axis = tNext.x <= tNext.y && tNext.x <= tNext.z ? 0 : tNext.y <= tNext.z ? 1 : 2;
+    const float runnerUp = std::min( tNext[ ( axis + 1 ) % 3 ], tNext[ ( axis + 2 ) % 3 ] );
+    hit.graze = std::min( hit.graze, runnerUp - tNext[ axis ] );
+    t = tNext[ axis ];
+    tNext[ axis ] += tDelta[ axis ];
+    c[ axis ] += step[ axis ];
+    normal = glm::vec3( 0.0f );
+    normal[ axis ] = -float( step[ axis ] );
+    if ( c[ axis ] < 0 || c[ axis ] >= size || t >= tMax ) return hit;
+  }
+}
+
+// rays from outside the volume toward points inside it, tree against the cell walk - a ray that passes
+// within the traversal's nudge of a cell edge can take either side of it, so those don't count
+static int checkTreeTraversal( const std::vector< uint8_t > &cells, int size, int rays ) {
+  const vatTree tree = vatBuildTree( cells, size );
+  std::mt19937 gen( 7 );
+  std::uniform_real_distribution< float > unit( 0.0f, 1.0f );
+  std::normal_distribution< float > gaussian;
+  const float tMax = 1e4f;
+  int mismatched = 0, exhausted = 0;
+  for ( int r = 0; r < rays; r++ ) {
+    const glm::vec3 target = glm::vec3( unit( gen ), unit( gen ), unit( gen ) ) * float( size );
+    const glm::vec3 direction = glm::normalize( glm::vec3( gaussian( gen ), gaussian( gen ), gaussian( gen ) ) );
+    const glm::vec3 origin = target - direction * ( 2.0f * size );
+    const vatRayHit a = vatTreeTraceCPU( tree, origin, direction, tMax );
+    const vatRayHit b = vatCellTrace( cells, size, origin, direction, tMax );
+    if ( a.exhausted ) exhausted++;
+    else if ( b.graze >= 2e-3f && ( std::abs( a.t - b.t ) > 1e-3f * std::max( 1.0f, b.t ) || a.state != b.state || a.normal != b.normal ) ) mismatched++;
+  }
+  int failures = 0;
+  if ( mismatched ) {
+    cout << T_RED << "  vatTreeTrace " << size << "^3 differs from the cell walk on " << mismatched << " of " << rays << " rays" << RESET << endl;
+    failures++;
+  }
+  if ( exhausted ) {
+    cout << T_RED << "  vatTreeTrace " << size << "^3 ran out of steps on " << exhausted << " of " << rays << " rays" << RESET << endl;
+    failures++;
+  }
+  return failures;
+}
+static void usage() {
+  cout << "usage: microbench [options]" << endl
+       << "  --reps <n>          timed repetitions per case, at least 2 ( default 15 )" << endl
+       << "  --filter <text>     only cases whose name contains text" << endl
+       << "  --json <path>       also write the results as JSON" << endl;
+}
+
+int main( int argc, char *argv[] ) {
+  int repetitions = 15;
+  std::string filter, jsonPath;
+  for ( int i = 1; i < argc; i++ ) {
+    std::string argument = argv[ i ];
+    bool hasValue = i + 1 < argc;
+    if ( argument == "--reps" && hasValue ) repetitions = numericArgument( argument, argv[ ++i ], 2, 100000, usage );
+    else if ( argument == "--filter" && hasValue ) filter = argv[ ++i ];
+    else if ( argument == "--json" && hasValue ) jsonPath = argv[ ++i ];
+    else if ( argument == "-h" || argument == "--help" ) { usage(); return 0; }
+    else { usage(); return 1; }
+  }
+
+  std::vector< benchResult > results;
+  int failures = 0; // correctness checks that tripped
+  auto run = [ & ]( std::string name, std::string unit, double perRun, auto &&setup, auto &&work ) {
+    if ( !filter.empty() && name.find( filter ) == std::string::npos ) return;
+    results.push_back( { name, unit, perRun, repeat( repetitions, setup, work ) } );
+    report( results.back() );
+  };
+  auto noSetup = [] {};
+
+  cout << T_BLUE << "microbench" << RESET << ", " << repetitions << " repetitions, median / min / relative stddev / throughput" << endl;
+
+  // VAT - one fixed random rule, so every depth evaluates the same automaton
+  std::string rule = voxel_automata_terrain( 2, 0.0f, "r", 3, 0.35f, 0.5f, 0.0f, glm::bvec3( false, true, false ), glm::bvec3( false ) ).makeShortRule();
+  for ( int levels : { 5, 6, 7, 8 } ) {
+    double cells = std::pow( double( ( 1 << levels ) + 1 ), 3.0 );
+    run( "VAT levels_deep " + std::to_string( levels ), "cells", cells, noSetup, [ & ] {
+      voxel_automata_terrain v( levels, 0.0f, rule, 3, 0.35f, 0.5f, 0.0f, glm::bvec3( false, true, false ), glm::bvec3( false ) );
+    } );
+  }
+
+  // diamond-square, tileable version, into a flat float array
+  for ( int size : { 256, 1024, 4096 } ) { // the wrapping version wants powers of two
+    std::vector< float > heights( size_t( size ) * size );
+    std::mt19937 gen( 1 );
+    run( "diamond_square_wrap " + std::to_string( size ), "cells", double( size ) * size,
+      [ & ] { std::fill( heights.begin(), heights.end(), 0.0f ); gen.seed( 1 ); },
+      [ & ] {
+        heightfield::diamond_square_wrap( size,
+          [ & ]( float limit ) { std::uniform_real_distribution< float > d( 0.0f, limit ); return d( gen ); },
+          []( int level ) { return 64.0f * std::pow( 0.5f, level ); },
+          [ & ]( int x, int y ) -> float & { return heights[ size_t( y ) * size + x ]; } );
+      } );
+  }
+
+  // OBJ loading - generated spheres written to the temp directory
+  for ( int rings : { 64, 256, 512 } ) {
+    std::filesystem::path path = std::filesystem::temp_directory_path() / ( "microbench_" + std::to_string( rings ) + ".obj" );
+    std::string text = generateOBJ( rings, rings * 2 );
+    std::ofstream( path ) << text;
+    int triangles = 2 * rings * rings * 2;
+    run( "load_OBJ " + std::to_string( triangles ) + " tris", "B", double( text.size() ), noSetup, [ & ] {
+      quietCout quiet;
+      objLoader o;
+      o.load_OBJ( path.string() );
+    } );
+    std::filesystem::remove( path );
+  }
+
+  // PNG - throughput counted in raw RGBA bytes either way
+  for ( int size : { 256, 1024, 2048 } ) {
+    std::vector< uint8_t > image = generateImage( size );
+    std::vector< unsigned char > encoded;
+    std::string label = std::to_string( size ) + "x" + std::to_string( size );
+    run( "lodepng encode " + label, "B", double( image.size() ), [ & ] { encoded.clear(); }, [ & ] {
+      lodepng::encode( encoded, image.data(), size, size );
+    } );
+    if ( encoded.empty() ) lodepng::encode( encoded, image.data(), size, size );
+    std::vector< unsigned char > decoded;
+    run( "lodepng decode " + label, "B", double( image.size() ), [ & ] { decoded.clear(); }, [ & ] {
+      unsigned w, h;
+      lodepng::decode( decoded, w, h, encoded );
+    } );
+    if ( !decoded.empty() && decoded != image ) {
+      cout << T_RED << "  lodepng round trip mismatch at " << label << RESET << endl;
+      failures++;
+    }
+
+    std::filesystem::path path = std::filesystem::temp_directory_path() / "microbench.png";
+    run( "encodePNGParallel " + label, "B", double( image.size() ), noSetup, [ & ] {
+      encodePNGParallel( path.string(), image.data(), size, size, PNG_FAST );
+    } );
+    std::filesystem::remove( path );
+  }
+
+  // VAT short rule codec - base 3 digits packed into a base 62 string through BigInteger
+  {
+    voxel_automata_terrain v( 1, 0.0f, rule, 3, 0.35f, 0.5f, 0.0f, glm::bvec3( false ), glm::bvec3( false ) );
+    const int rules = 200;
+    std::string encoded;
+    run( "makeShortRule", "rules", rules, noSetup, [ & ] {
+      for ( int i = 0; i < rules; i++ ) encoded = v.makeShortRule();
+    } );
+    run( "readShortRule", "rules", rules, noSetup, [ & ] {
+      for ( int i = 0; i < rules; i++ ) v.readShortRule( rule );
+    } );
+    if ( v.makeShortRule() != rule ) {
+      cout << T_RED << "  short rule round trip mismatch" << RESET << endl;
+      failures++;
+    }
+  }
+
+  // sampler - a tile's worth of pixels, 16 samples of 8 dimensions each
+  for ( samplerMode mode : { samplerMode::random, samplerMode::sobol, samplerMode::sobolRanked } ) {
+    const char *names[] = { "random", "blue noise", "sobol", "sobol ranked" };
+    const int tile = 128, samples = 16, dimensions = 8;
+    float sum = 0.0f;
+    run( std::string( "sampleDimension " ) + names[ int( mode ) ], "samples", double( tile ) * tile * samples * dimensions, noSetup, [ & ] {
+      for ( int y = 0; y < tile; y++ )
+        for ( int x = 0; x < tile; x++ )
+          for ( int s = 0; s < samples; s++ )
+            for ( int d = 0; d < dimensions; d++ )
+              sum += sampleDimension( mode, x, y, s, d, ( x * 37 + y * 101 ) & 0xff );
+    } );
+    if ( sum < 0.0f ) cout << sum; // keeps the loop from being optimized out
+  }
+
+  // any 16 samples of one pixel should hit all 16 cells of every 2D elementary interval grid
+  for ( samplerMode mode : { samplerMode::sobol, samplerMode::sobolRanked } ) {
+    for ( int ax = 1; ax <= 16; ax *= 2 ) {
+      std::vector< bool > hit( 16, false );
+      for ( int s = 0; s < 16; s++ )
+        hit[ int( sampleDimension( mode, 5, 9, s, 0, 77 ) * ax ) * ( 16 / ax ) + int( sampleDimension( mode, 5, 9, s, 1, 77 ) * ( 16 / ax ) ) ] = true;
+      if ( std::count( hit.begin(), hit.end(), true ) != 16 ) {
+        cout << T_RED << "  sampler mode " << int( mode ) << " not stratified on " << ax << "x" << 16 / ax << RESET << endl;
+        failures++;
+      }
+    }
+  }
+
+  // VAT distance field - blobs at sizes either side of a power of two, and a small automaton
+  for ( int size : { 17, 24, 33 } )
+    failures += checkDistanceField( generateBlobs( size, 12, size ), size );
+  {
+    voxel_automata_terrain v( 4, 0.0f, rule, 3, 0.35f, 0.5f, 0.0f, glm::bvec3( false, true, false ), glm::bvec3( false ) );
+    failures += checkDistanceField( vatPack( v.state ), v.state.size() );
+  }
+
+  // VAT 64-tree traversal - padded and exact power of four sizes, several levels deep
+  for ( int size : { 17, 64, 129 } )
+    failures += checkTreeTraversal( generateBlobs( size, 24, size ), size, 20000 );
+  {
+    voxel_automata_terrain v( 6, 0.0f, rule, 3, 0.35f, 0.5f, 0.0f, glm::bvec3( false, true, false ), glm::bvec3( false ) );
+    failures += checkTreeTraversal( vatPack( v.state ), v.state.size(), 20000 );
+  }
+
+  if ( !jsonPath.empty() ) {
+    json out = json::array();
+    for ( auto &r : results ) {
+      double m = median( r.seconds );
+      out.push_back( {
+        { "name", r.name }, { "unit", r.unit }, { "perRun", r.perRun },
+        { "medianSeconds", m }, { "minSeconds", *std::min_element( r.seconds.begin(), r.seconds.end() ) },
+        { "meanSeconds", mean( r.seconds ) }, { "stddevSeconds", standardDeviation( r.seconds ) },
+        { "throughput", r.perRun / m }, { "seconds", r.seconds }
+      } );
+    }
+    std::ofstream( jsonPath ) << out.dump( 2 ) << endl;
+  }
+
+  if ( failures ) {
+    cout << T_RED << failures << " check" << ( failures == 1 ? "" : "s" ) << " failed" << RESET << endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,138 @@
+#ifndef VAT_FIELD_H
+#define VAT_FIELD_H
+
+// VAT voxels as a signed distance field, for sphere tracing terrain instead of stepping every voxel
+//  - vatPack flattens voxel_automata_terrain::state into bytes, x fastest, for the R8UI cell texture
+//  - vatDistanceField is the CPU version of the field, an exact separable EDT ( Felzenszwalb and
+//    Huttenlocher ) - the GPU approximates the same thing with a jump flood, shaders/vat_jfa.cs.glsl
+//
+// a cell is solid for states 1 and 2, and a surface cell if it's solid with an empty face neighbour.
+// The field at a cell center is in cells, and has to be a lower bound for sphere tracing. Outside, it's
+// the distance to the nearest surface cell center less sqrt(3)/2, the furthest a cube's corner sits from
+// its center, and never less than the half cell between any empty center and the next cell over. That's
+// below the distance to the solid cells' boxes, by up to 0.366 of a cell along the faces and nothing
+// along the diagonals - shaders/vat_terrain.glsl takes the exact box distance within a cell of the
+// surface. Inside, it's the distance to the nearest surface cell center plus half a cell, negated.
+// Without any surface cells it's the edge length, with its sign
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+// run fn( index ) for index in [0,count) on every hardware thread, indices handed out dynamically
+template < typename T >
+inline void vatParallelFor( int count, T fn ) {
+  std::atomic< int > next( 0 );
+  auto work = [ & ]() {
+    for ( int i = next++; i < count; i = next++ )
+      fn( i );
+  };
+  std::vector< std::thread > pool;
+  for ( unsigned t = 1; t < std::max( 1u, std::thread::hardware_concurrency() ); t++ )
+    pool.emplace_back( work );
+  work();
+  for ( auto &t : pool )
+    t.join();
+}
+
+inline std::vector< uint8_t > vatPack( const std::vector< std::vector< std::vector< int > > > &state ) {
+  const size_t size = state.size();
+  std::vector< uint8_t > cells( size * size * size );
+  for ( size_t x = 0; x < size; x++ )
+    for ( size_t y = 0; y < size; y++ )
+      for ( size_t z = 0; z < size; z++ )
+        cells[ x + size * ( y + size * z ) ] = uint8_t( state[ x ][ y ][ z ] );
+  return cells;
+}
+
+// squared distance transform of one line in place, f is zero on the sites and huge elsewhere - lower
+// envelope of the parabolas rooted at each sample, then read back off it
+struct vatEDTScratch {
+  std::vector< float > f, z;
+  std::vector< int > v;
+  void resize( int n ) { f.resize( n ); z.resize( n + 1 ); v.resize( n ); }
+};
+
+inline void vatEDT1D( float *data, int n, size_t stride, vatEDTScratch &s ) {
+  for ( int q = 0; q < n; q++ )
+    s.f[ q ] = data[ q * stride ];
+  int k = 0;
+  s.v[ 0 ] = 0;
+  s.z[ 0 ] = -INFINITY;
+  s.z[ 1 ] = INFINITY;
+  auto intersect = [ & ]( int q, int p ) {
+    return ( ( s.f[ q ] + float( q ) * q ) - ( s.f[ p ] + float( p ) * p ) ) / ( 2.0f * ( q - p ) );
+  };
+  for ( int q = 1; q < n; q++ ) {
+    float intersection = intersect( q, s.v[ k ] );
+    while ( intersection <= s.z[ k ] ) // z[ 0 ] is -inf, so this stops at the first parabola
+      intersection = intersect( q, s.v[ --k ] );
+    s.v[ ++k ] = q;
+    s.z[ k ] = intersection;
+    s.z[ k + 1 ] = INFINITY;
+  }
+  k = 0;
+  for ( int q = 0; q < n; q++ ) {
+    while ( s.z[ k + 1 ] < q ) k++;
+    const float d = float( q - s.v[ k ] );
+    data[ q * stride ] = d * d + s.f[ s.v[ k ] ];
+  }
+}
+
+// squared distance to the nearest site, sites are the zeroes of grid - one pass along each axis
+inline void vatEDT3D( std::vector< float > &grid, int size ) {
+  const size_t n = size;
+  for ( int axis = 0; axis < 3; axis++ ) {
+    const size_t stride = axis == 0 ? 1 : axis == 1 ? n : n * n;
+    vatParallelFor( size, [ & ]( int a ) {
+      vatEDTScratch s;
+      s.resize( size );
+      for ( size_t b = 0; b < n; b++ ) { // the two axes other than this one
+        size_t first;
+        switch ( axis ) {
+          case 0:  first = n * ( a + n * b ); break;
+          case 1:  first = a + n * n * b; break;
+          default: first = a + n * b; break;
+        }
+        vatEDT1D( &grid[ first ], size, stride, s );
+      }
+    } );
+  }
+}
+
+inline bool vatSurfaceCell( const std::vector< uint8_t > &cells, int size, int x, int y, int z ) {
+  const size_t n = size, i = x + n * ( y + n * z );
+  if ( !cells[ i ] ) return false;
+  return ( x > 0 && !cells[ i - 1 ] ) || ( x < size - 1 && !cells[ i + 1 ] ) ||
+         ( y > 0 && !cells[ i - n ] ) || ( y < size - 1 && !cells[ i + n ] ) ||
+         ( z > 0 && !cells[ i - n * n ] ) || ( z < size - 1 && !cells[ i + n * n ] );
+}
+
+constexpr float vatCornerDistance = 0.8660254f; // sqrt( 3 ) / 2, center to corner of a cell
+
+// signed, in cells - size is the edge length of the cube of cells
+inline std::vector< float > vatDistanceField( const std::vector< uint8_t > &cells, int size ) {
+  const float huge = 1e20f;
+  const size_t n = size;
+  std::vector< float > field( cells.size() );
+  vatParallelFor( size, [ & ]( int z ) {
+    for ( int y = 0; y < size; y++ )
+      for ( int x = 0; x < size; x++ )
+        field[ x + n * ( y + n * z ) ] = vatSurfaceCell( cells, size, x, y, z ) ? 0.0f : huge;
+  } );
+  vatEDT3D( field, size );
+
+  for ( size_t i = 0; i < cells.size(); i++ ) {
+    const float d = std::sqrt( field[ i ] );
+    if ( field[ i ] >= huge )
+      field[ i ] = cells[ i ] ? -float( size ) : float( size );
+    else
+      field[ i ] = cells[ i ] ? -( d + 0.5f ) : std::max( d - vatCornerDistance, 0.5f );
+  }
+  return field;
+}
+
+#endif
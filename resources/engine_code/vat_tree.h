@@ -0,0 +1,135 @@
+#ifndef VAT_TREE_H
+#define VAT_TREE_H
+
+// VAT cells as a sparse 64-tree - every node splits its cube 4x4x4, and holds three 64 bit masks over
+// its children:
+//  nodeMask  - mixed children, which have a node of their own
+//  solidMask - children that are solid throughout, one cell at the bottom level or a uniform block above
+//  twoMask   - which of the solid children are state 2, the rest are state 1
+// children that are in neither mask are empty. The nodes of a node's mixed children are contiguous from
+// firstChild, in bit order, so child i is at firstChild + the number of nodeMask bits below i. Empty and
+// uniformly filled blocks cost nothing past a bit in their parent, and shaders/vat_tree.glsl skips empty
+// space a whole block at a time
+//
+// the tree covers 4^depth cells on a side from the corner of the grid, the cells past the grid are empty.
+// Nodes go in the array children first, the root is the last one
+
+#include <cstdint>
+#include <vector>
+
+struct vatTreeNode {
+  uint32_t nodeMask[ 2 ];  // low 32 children, high 32 - child index is x + 4 * y + 16 * z
+  uint32_t solidMask[ 2 ];
+  uint32_t twoMask[ 2 ];
+  uint32_t firstChild;
+  uint32_t pad;
+};
+static_assert( sizeof( vatTreeNode ) == 32, "vatTreeNode is mirrored in shaders/vat_tree.glsl" );
+
+constexpr int vatTreeMaxDepth = 6; // 4096 cells on a side, matches the traversal stack
+
+struct vatTree {
+  std::vector< vatTreeNode > nodes;
+  uint32_t root = 0;
+  int depth = 0; // levels of nodes, the root's children are 4^( depth - 1 ) cells on a side
+  int cells = 0; // 4^depth, on a side
+  bool empty = true;
+
+  size_t bytes() const { return nodes.size() * sizeof( vatTreeNode ); }
+};
+
+namespace vatTreeDetail {
+
+  // what a block turned out to be - a node is only placed by its parent, with its siblings
+  struct block {
+    enum { empty, solid, mixed } kind = empty;
+    uint8_t state = 0;
+    vatTreeNode node = {};
+  };
+
+  struct builder {
+    const std::vector< uint8_t > &cells;
+    int size;
+    std::vector< vatTreeNode > &nodes;
+
+    uint8_t cell( int x, int y, int z ) const {
+      if ( x >= size || y >= size || z >= size ) return 0;
+      return cells[ x + size_t( size ) * ( y + size_t( size ) * z ) ];
+    }
+
+    // the block of side 4^( level + 1 ) cells at origin
+    block build( int level, int x0, int y0, int z0 ) {
+      block result;
+      if ( x0 >= size || y0 >= size || z0 >= size ) return result; // wholly past the grid
+
+      const int childSize = 1 << ( 2 * level );
+      block children[ 64 ];
+      for ( int i = 0; i < 64; i++ ) {
+        const int x = x0 + ( i & 3 ) * childSize, y = y0 + ( ( i >> 2 ) & 3 ) * childSize, z = z0 + ( i >> 4 ) * childSize;
+        if ( level == 0 ) {
+          const uint8_t state = cell( x, y, z );
+          children[ i ].kind = state ? block::solid : block::empty;
+          children[ i ].state = state;
+        } else {
+          children[ i ] = build( level - 1, x, y, z );
+        }
+      }
+
+      // uniform blocks collapse into a bit in the parent
+      bool uniform = children[ 0 ].kind != block::mixed;
+      for ( int i = 1; i < 64 && uniform; i++ )
+        uniform = children[ i ].kind == children[ 0 ].kind && children[ i ].state == children[ 0 ].state;
+      if ( uniform ) {
+        result.kind = children[ 0 ].kind;
+        result.state = children[ 0 ].state;
+        return result;
+      }
+
+      result.kind = block::mixed;
+      result.node.firstChild = nodes.size();
+      for ( int i = 0; i < 64; i++ ) {
+        const uint32_t bit = 1u << ( i & 31 );
+        switch ( children[ i ].kind ) {
+          case block::mixed:
+            result.node.nodeMask[ i >> 5 ] |= bit;
+            nodes.push_back( children[ i ].node );
+            break;
+          case block::solid:
+            result.node.solidMask[ i >> 5 ] |= bit;
+            if ( children[ i ].state == 2 ) result.node.twoMask[ i >> 5 ] |= bit;
+            break;
+          default:
+            break;
+        }
+      }
+      return result;
+    }
+  };
+
+}
+
+// cells are size^3 VAT states, x fastest, as vatPack lays them out
+inline vatTree vatBuildTree( const std::vector< uint8_t > &cells, int size ) {
+  vatTree tree;
+  tree.depth = 1;
+  while ( ( 1 << ( 2 * tree.depth ) ) < size ) tree.depth++;
+  tree.cells = 1 << ( 2 * tree.depth );
+
+  vatTreeDetail::builder b{ cells, size, tree.nodes };
+  vatTreeDetail::block root = b.build( tree.depth - 1, 0, 0, 0 );
+
+  // the root is always a node, even when the whole volume is one block, so traversal has one case
+  if ( root.kind != vatTreeDetail::block::mixed ) {
+    root.node = {};
+    if ( root.kind == vatTreeDetail::block::solid ) {
+      root.node.solidMask[ 0 ] = root.node.solidMask[ 1 ] = ~0u;
+      if ( root.state == 2 ) root.node.twoMask[ 0 ] = root.node.twoMask[ 1 ] = ~0u;
+    }
+  }
+  tree.empty = root.kind == vatTreeDetail::block::empty;
+  tree.root = tree.nodes.size();
+  tree.nodes.push_back( root.node );
+  return tree;
+}
+
+#endif